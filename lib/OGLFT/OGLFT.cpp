@@ -19,6 +19,7 @@
  *
  */
 
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 #ifdef HAVE_CONFIG_H
@@ -151,6 +152,8 @@ namespace OGLFT {
     rotation_reference_glyph_ = 0;
     rotation_reference_face_ = 0;
     rotation_offset_y_ = 0.;
+
+    memset( mLatinState, 0, sizeof( mLatinState ) );
   }
 
   Face::~Face ( void )
@@ -628,52 +631,71 @@ namespace OGLFT {
   OGLFT::BBox Face::measureRaw( const std::wstring &s )
   {
     BBox bbox;
+    BBox char_bbox;
 
     unsigned stringSize = s.size();
     for ( unsigned int i = 0; i < stringSize; i++ ) {
-      
-      auto found = mBBoxes.find(s[i]);
-      if (found != mBBoxes.end()) {
-        bbox += found->second;
-        continue;
-      }
+      if ( measureRawChar( s[i], char_bbox ) )
+        bbox += char_bbox;
+    }
 
-      BBox char_bbox;
+    return bbox;
+  }
 
-      unsigned int f;
-      FT_UInt glyph_index = 0;
+  bool Face::measureRawChar( const wchar_t c, BBox& bbox )
+  {
+    const bool latin = static_cast<unsigned>( c ) < 256;
+    if ( latin && mLatinState[c] != 0 ) {
+      if ( mLatinState[c] != 1 ) return false;
+      bbox = mLatinBBoxes[c];
+      return true;
+    }
 
-      unsigned facesSize = faces_.size();
-      for ( f = 0; f < facesSize; f++ ) {
-        glyph_index = FT_Get_Char_Index( faces_[f].face_, s[i] );
-        if ( glyph_index != 0 ) break;
-      }
+    auto found = mBBoxes.find(c);
+    if (found != mBBoxes.end()) {
+      bbox = found->second;
+      return true;
+    }
+    if (mMissing.find(c) != mMissing.end()) return false;
 
-      if ( glyph_index == 0 ) {
-        continue;
-      }
+    unsigned int f;
+    FT_UInt glyph_index = 0;
 
-      FT_Error error = FT_Load_Glyph( faces_[f].face_, glyph_index,
-        FT_LOAD_DEFAULT );
-      if ( error != 0 ) continue;
+    unsigned facesSize = faces_.size();
+    for ( f = 0; f < facesSize; f++ ) {
+      glyph_index = FT_Get_Char_Index( faces_[f].face_, c );
+      if ( glyph_index != 0 ) break;
+    }
 
-      FT_Glyph glyph;
-      error = FT_Get_Glyph( faces_[f].face_->glyph, &glyph );
-      if ( error != 0 ) continue;
+    if ( glyph_index == 0 ) {
+      mMissing[c] = true;
+      if ( latin ) mLatinState[c] = 2;
+      return false;
+    }
 
-      FT_BBox ft_bbox;
-      FT_Glyph_Get_CBox( glyph, ft_glyph_bbox_unscaled, &ft_bbox );
+    // Load errors aren't remembered, the same as before the table.
+    FT_Error error = FT_Load_Glyph( faces_[f].face_, glyph_index,
+      FT_LOAD_DEFAULT );
+    if ( error != 0 ) return false;
 
-      FT_Done_Glyph( glyph );
+    FT_Glyph glyph;
+    error = FT_Get_Glyph( faces_[f].face_->glyph, &glyph );
+    if ( error != 0 ) return false;
 
-      char_bbox = ft_bbox;
-      char_bbox.advance_ = faces_[f].face_->glyph->advance;
+    FT_BBox ft_bbox;
+    FT_Glyph_Get_CBox( glyph, ft_glyph_bbox_unscaled, &ft_bbox );
 
-      bbox += char_bbox;
-      mBBoxes[s[i]] = char_bbox;
-    }
+    FT_Done_Glyph( glyph );
 
-    return bbox;
+    bbox = ft_bbox;
+    bbox.advance_ = faces_[f].face_->glyph->advance;
+
+    mBBoxes[c] = bbox;
+    if ( latin ) {
+      mLatinBBoxes[c] = bbox;
+      mLatinState[c] = 1;
+    }
+    return true;
   }
 
   // Measure the bounding box as if the (latin1) string were not rotated
@@ -292,6 +292,12 @@ namespace OGLFT {
 
 
     std::unordered_map<wchar_t, BBox> mBBoxes;
+    //! Characters no face has a glyph for, so they're only looked up once.
+    std::unordered_map<wchar_t, bool> mMissing;
+    //! Flat copy of mBBoxes for the first 256 characters, which is what
+    //! most text is made of. mLatinState is 0 until seen, 1 if present, 2 if missing.
+    BBox mLatinBBoxes[256];
+    unsigned char mLatinState[256];
     //! We allow a Face to be constructed either from a file name
     //! or passed in as an already opened FreeType FT_Face. In the case
     //! of the later (already opened), we don't close the FT_Face on
@@ -752,6 +758,17 @@ namespace OGLFT {
     virtual BBox measure ( const std::wstring &s );
     virtual BBox measure ( const std::wstring &format, double number );
     virtual BBox measureRaw ( const std::wstring &s );
+    /*!
+     * Compute the raw bounding box info for a single character. The
+     * result is cached, so measuring a string a character at a time
+     * (i.e. with BBox::operator+=) is as fast as measureRaw, and
+     * gives exactly the same result.
+     * \param c the (UNICODE) character to measure.
+     * \param bbox receives the bounding box of c.
+     * \return false if no face has a glyph for c, in which case
+     * measureRaw skips it entirely.
+     */
+    bool measureRawChar ( const wchar_t c, BBox& bbox );
     /*!
      * Compile a string into an OpenGL display list for later
      * rendering.  Essentially, the string is rendered at the origin
@@ -975,6 +992,28 @@ namespace OGLFT {
      */
     int descender ( void ) { return faces_.front().face_->descender; }
 
+    /*!
+     * \return the number of glyphs compiled into display lists so far.
+     */
+    unsigned int compiledGlyphCount ( void ) const { return glyph_dlists_.size(); }
+
+    /*!
+     * \return the number of characters with a cached measurement.
+     */
+    unsigned int measuredCharCount ( void ) const { return mBBoxes.size(); }
+
+    /*!
+     * \return the total size of the font files behind this face, in bytes.
+     */
+    unsigned long fileSize ( void ) const
+    {
+      unsigned long size = 0;
+      for ( unsigned int i = 0; i < faces_.size(); i++ )
+	if ( faces_[i].face_ != 0 && faces_[i].face_->stream != 0 )
+	  size += faces_[i].face_->stream->size;
+      return size;
+    }
+
   protected:
     // The various styles override these routines
 
@@ -26,6 +26,7 @@
 #include "ds/ui/mesh_source/mesh_cache_service.h"
 // For installing the framework services
 #include "ds/ui/service/glsl_image_service.h"
+#include "ds/ui/service/glyph_atlas_service.h"
 // For verifying that the resources are installed
 #include "ds/app/FrameworkResources.h"
 
@@ -102,7 +103,9 @@ App::App(const RootList& roots)
 							[](ds::BlobRegistry& r){EngineStatsView::installAsClient(r);});
 
 	// Initialize the engine image generator typess.
-	ds::ui::ImageArc::install(mEngine.getImageRegistry());
+	const int			arc_cache_mb = mEngineSettings.getInt("arc:cache_mb", 0, 16);
+	ds::ui::ImageArc::install(	mEngine.getImageRegistry(), mEngineSettings.getInt("arc:threads", 0, 4),
+								static_cast<size_t>(arc_cache_mb > 0 ? arc_cache_mb : 0) * 1024 * 1024);
 	ds::ui::ImageFile::install(mEngine.getImageRegistry());
 	ds::ui::ImageGlsl::install(mEngine.getImageRegistry());
 	ds::ui::ImageResource::install(mEngine.getImageRegistry());
@@ -110,6 +113,8 @@ App::App(const RootList& roots)
 	// Install the framework services
 	mEngine.addService(ds::glsl::IMAGE_SERVICE, *(new ds::glsl::ImageService(mEngine)));
 	mEngine.addService(ds::MESH_CACHE_SERVICE_NAME, *(new ds::MeshCacheService()));
+	mEngine.addService(ds::ui::GLYPH_ATLAS_SERVICE, *(new ds::ui::GlyphAtlasService(	mEngineSettings.getBool("text:glyph_atlas", 0, true),
+																						mEngineSettings.getInt("text:glyph_atlas_page", 0, 1024))));
 
 	if (mArrowKeyCameraControl) {
 		// Currently this is necessary for the keyboard commands
@@ -296,7 +301,7 @@ void App::quit() {
 void App::shutdown() {
 	mEngine.getRootSprite().clearChildren();
 	mEngine.stopServices();
-	ds::ui::clearFontCache();
+	mEngine.getFontService().clear();
 	ci::app::AppBasic::shutdown();
 }
 
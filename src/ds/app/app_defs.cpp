@@ -41,6 +41,11 @@ RootList& RootList::pickColor() {
 	if (!mRoots.empty()) mRoots.back().mPick = Root::kColor;
 	return *this;
 }
+
+RootList& RootList::pickBounds(const bool on) {
+	if (!mRoots.empty()) mRoots.back().mPickBounds = on;
+	return *this;
+}
 
 RootList& RootList::perspFov(const float v) {
 	if (!mRoots.empty()) mRoots.back().mPersp.mFov = v;
@@ -83,7 +88,8 @@ RootList& RootList::slave() {
 RootList::Root::Root()
 		: mType(kOrtho)
 		, mPick(kDefault)
-		, mMaster(kIndependent) {
+		, mMaster(kIndependent)
+		, mPickBounds(false) {
 }
 
 
@@ -45,6 +45,9 @@ public:
 	RootList&						pickSelect();
 	// Use unique colour rendering for picking.
 	RootList&						pickColor();
+	// Ortho roots: skip any part of the tree whose cached global bounds
+	// don't contain the touch. Same result, much faster on large trees.
+	RootList&						pickBounds(const bool = true);
 	
 	RootList&						perspFov(const float);
 	RootList&						perspPosition(const ci::Vec3f&);
@@ -69,6 +72,7 @@ public:
 		enum Master					{ kIndependent, kMaster, kSlave };
 		Master						mMaster;
 		PerspCameraParams			mPersp;
+		bool						mPickBounds;
 	};
 
 private:
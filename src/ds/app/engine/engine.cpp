@@ -16,7 +16,11 @@
 #include "ds/debug/logger.h"
 #include "ds/math/math_defs.h"
 #include "ds/ui/ip/ip_defs.h"
+#include "ds/ui/ip/functions/ip_blur.h"
 #include "ds/ui/ip/functions/ip_circle_mask.h"
+#include "ds/ui/ip/functions/ip_desaturate.h"
+#include "ds/ui/ip/functions/ip_premultiply.h"
+#include "ds/ui/ip/functions/ip_resize.h"
 #include "ds/ui/sprite/util/blend.h"
 #include "cinder/Thread.h"
 
@@ -172,7 +176,15 @@ Engine::Engine(	ds::App& app, const ds::cfg::Settings &settings,
 	// For now, install some default image processing functions here, for convenience. These are
 	// so lightweight it probably makes sense just to have them always available for clients instead
 	// of requiring some sort of configuration.
+	mIpFunctions.setThreadCount(settings.getInt("ip:threads", 0, 4));
 	mIpFunctions.add(ds::ui::ip::CIRCLE_MASK, ds::ui::ip::FunctionRef(new ds::ui::ip::CircleMask()));
+	mIpFunctions.add(ds::ui::ip::PREMULTIPLY, ds::ui::ip::FunctionRef(new ds::ui::ip::Premultiply()));
+	mIpFunctions.add(ds::ui::ip::DESATURATE, ds::ui::ip::FunctionRef(new ds::ui::ip::Desaturate()));
+	mIpFunctions.add(ds::ui::ip::BLUR, ds::ui::ip::FunctionRef(new ds::ui::ip::Blur()));
+	mIpFunctions.add(ds::ui::ip::RESIZE, ds::ui::ip::FunctionRef(new ds::ui::ip::Resize()));
+
+	mFontService.setThreadCount(settings.getInt("font_cache:threads", 0, 2));
+	mFontService.setCacheBudget(static_cast<size_t>(settings.getInt("font_cache:mb", 0, 64)) * 1024 * 1024);
 
 	if (mAutoDraw) addService("AUTODRAW", *mAutoDraw);
 
@@ -613,6 +625,12 @@ void Engine::setup(ds::App&) {
 	mFbo = ci::gl::Fbo(w, h, format);
 	//////////////////////////////////////////////////////////////////////////
 
+	// The app has installed its fonts and loaded its text cfgs by now, so get
+	// their fonts loading before the first sprites ask for them.
+	mData.mEngineCfg.forEachText([this](const std::string&, const ds::cfg::Text& t) {
+		if (!t.mFont.empty()) mFontService.preload(mFonts.getFileNameFromName(t.mFont), t.mSize);
+	});
+
 	float curr = static_cast<float>(getElapsedSeconds());
 	mLastTime = curr;
 	mLastTouchTime = 0;
@@ -786,6 +804,10 @@ ds::FontList& Engine::editFonts() {
 	return mFonts;
 }
 
+ds::ui::FontService& Engine::getFontService() {
+	return mFontService;
+}
+
 void Engine::stopServices() {
 	if (mData.mServices.empty()) return;
 
@@ -24,6 +24,7 @@
 #include "ds/data/tuio_object.h"
 #include "ds/cfg/settings.h"
 #include "ds/ui/ip/ip_function_list.h"
+#include "ds/ui/service/font_service.h"
 #include "ds/ui/sprite/sprite_engine.h"
 #include "ds/ui/touch/select_picking.h"
 #include "ds/ui/touch/touch_manager.h"
@@ -119,6 +120,7 @@ public:
 	virtual ds::ResourceList&			getResources();
 	virtual const ds::FontList&			getFonts() const;
 	ds::FontList&						editFonts();
+	virtual ds::ui::FontService&		getFontService();
 
 	void								markCameraDirty();
 	virtual PerspCameraParams			getPerspectiveCamera(const size_t index) const;
@@ -194,6 +196,7 @@ private:
 	// A cache of all the resources in the system
 	ResourceList						mResources;
 	FontList							mFonts;
+	ds::ui::FontService					mFontService;
 	UpdateParams						mUpdateParams;
 	DrawParams							mDrawParams;
 	float								mLastTime;
@@ -89,6 +89,13 @@ void EngineCfg::setText(const std::string& name, const ds::cfg::Text& t) {
 	}
 }
 
+void EngineCfg::forEachText(const std::function<void(const std::string& name, const ds::cfg::Text&)>& fn) const {
+	if (!fn) return;
+	for (auto it=mTextCfg.begin(), end=mTextCfg.end(); it!=end; ++it) {
+		fn(it->first, it->second);
+	}
+}
+
 bool EngineCfg::hasNinePatch(const std::string& name) const {
 	if (name.empty()) return false;
 	if (mNinePatchCfg.empty()) return false;
@@ -2,6 +2,7 @@
 #ifndef DS_APP_ENGINE_ENGINECFG_H_
 #define DS_APP_ENGINE_ENGINECFG_H_
 
+#include <functional>
 #include <unordered_map>
 #include "ds/cfg/cfg_nine_patch.h"
 #include "ds/cfg/cfg_text.h"
@@ -26,6 +27,7 @@ public:
 	bool							hasText(const std::string& name) const;
 	const ds::cfg::Text&			getText(const std::string& name) const;
 	void							setText(const std::string& name, const ds::cfg::Text&);
+	void							forEachText(const std::function<void(const std::string& name, const ds::cfg::Text&)>&) const;
 	// Answer the requested text cfg. In debug mode, throw
 	// if it doesn't exist. In release mode, just answer an empty one.
 	bool							hasNinePatch(const std::string& name) const;
@@ -15,6 +15,13 @@ char				COMMAND_BLOB = 0;
 char				DELETE_SPRITE_BLOB = 0;
 // Used for clients to get info to the server
 char				CLIENT_STATUS_BLOB = 0;
+
+// Frames I can hold while waiting on a gap
+const int			HELD_FRAMES_MAX = 120;
+// Frames to wait on a resend before asking again
+const int32_t		RESEND_WAIT = 10;
+// Frames a gap can stay open before I give up and request the world
+const int32_t		GAP_AGE_MAX = 180;
 }
 
 /**
@@ -28,13 +35,15 @@ EngineClient::EngineClient(	ds::App& app, const ds::cfg::Settings& settings,
 							ds::EngineData& ed, const ds::RootList& roots)
 		: inherited(app, settings, ed, roots)
 		, mLoadImageService(mLoadImageThread, mIpFunctions)
-		, mRenderTextService(mRenderTextThread)
 //		, mConnection(NumberOfNetworkThreads)
 		, mSender(mSendConnection)
 		, mReceiver(mReceiveConnection)
 		, mBlobReader(mReceiver.getData(), *this)
 		, mSessionId(0)
 		, mConnectionRenewed(false)
+		, mHeldFrames(HELD_FRAMES_MAX)
+		, mGapAge(0)
+		, mResendWait(0)
 		, mServerFrame(-1)
 		, mState(nullptr) {
 	// NOTE:  Must be EXACTLY the same items as in EngineServer, in same order,
@@ -44,6 +53,9 @@ EngineClient::EngineClient(	ds::App& app, const ds::cfg::Settings& settings,
 	DELETE_SPRITE_BLOB = mBlobRegistry.add([this](BlobReader& r) {receiveDeleteSprite(r.mDataBuffer);});
 	CLIENT_STATUS_BLOB = mBlobRegistry.add([this](BlobReader& r) {receiveClientStatus(r.mDataBuffer);});
 	mReceiver.setHeaderAndCommandIds(HEADER_BLOB, COMMAND_BLOB);
+	mLoadImageService.configure(settings);
+	mRenderTextService.setThreadCount(settings.getInt("text:render_threads", 0, 2));
+	mWorkManager.configure(settings);
 	
 	try {
 		if (settings.getBool("server:connect", 0, true)) {
@@ -76,15 +88,17 @@ void EngineClient::setup(ds::App& app) {
 	inherited::setup(app);
 
 	mLoadImageThread.start(true);
-	mRenderTextThread.start(true);
 }
 
 void EngineClient::setupTuio(ds::App&) {
 }
 
 void EngineClient::update() {
+	mWorkManager.update();
 	updateClient();
+	mLoadImageService.update();
 	mRenderTextService.update();
+	getFontService().update();
 
 	if (!mConnectionRenewed && mReceiver.hasLostConnection()) {
 		mConnectionRenewed = true;
@@ -98,7 +112,7 @@ void EngineClient::update() {
 	// Every update, receive data
 	mReceiver.setHeaderAndCommandOnly(mState->getHeaderAndCommandOnly());
 //	mReceiver.setHeaderAndCommandOnly(false);
-	if (!mReceiver.receiveAndHandle(mBlobRegistry, mBlobReader)) {
+	if (!receiveFrame()) {
 		// If I didn't receive any data, then don't send any data. This is
 		// pretty important -- 0MQ will buffer sent commands if there's
 		// no one to receive them. There isn't a way to ask the socket how
@@ -117,7 +131,7 @@ void EngineClient::update() {
 	// weird condition.
 	int32_t		limit = 10;
 	while (mReceiveConnection.canRecv()) {
-		mReceiver.receiveAndHandle(mBlobRegistry, mBlobReader);
+		receiveFrame();
 		if (--limit <= 0) break;
 	}
 
@@ -138,10 +152,9 @@ void EngineClient::receiveHeader(ds::DataBuffer& data) {
 		mServerFrame = data.read<int32_t>();
 //		DS_LOG_INFO_M("Receive frame=" << mServerFrame, ds::IO_LOG);
 	}
-	// Terminator
-	if (data.canRead<char>()) {
-//		const char			term = data.read<char>();
-		data.read<char>();
+	// Attributes (currently only flags) and terminator
+	char				att;
+	while (data.canRead<char>() && (att=data.read<char>()) != ds::TERMINATOR_CHAR) {
 	}
 }
 
@@ -227,6 +240,80 @@ void EngineClient::onClientStartedReplyCommand(ds::DataBuffer& data) {
 	}
 }
 
+bool EngineClient::receiveFrame() {
+	if (!mReceiver.receive()) return false;
+
+	ds::DataBuffer&			data(mReceiver.getData());
+	int32_t					frame = -1;
+	bool					keyframe = false;
+	// Only frames sent from the server's running state are numbered. Anything
+	// else (the world, replies) is handled immediately and starts the numbering over.
+	if (mState != &mRunningState || !peekHeader(data, frame, keyframe) || frame < 0) {
+		clearHeldFrames();
+		mReceiver.handle(mBlobRegistry, mBlobReader);
+		return true;
+	}
+
+	const int32_t			expected = mServerFrame + 1;
+	// Already handled -- most likely a resend requested by another client.
+	if (frame < expected) return true;
+	if (frame > expected) {
+		if (!keyframe) {
+			holdFrame(frame);
+			return true;
+		}
+		// A keyframe contains the entire world, so it closes any gap.
+		DS_LOG_INFO_M("Resync on keyframe=" << frame << " expected=" << expected, ds::IO_LOG);
+		clearAllSprites();
+	}
+
+	mReceiver.handle(mBlobRegistry, mBlobReader);
+	mServerFrame = frame;
+	mHeldFrames.removeThrough(mServerFrame);
+
+	// Play any held frames that are now in sequence
+	const std::string*		next;
+	while ((next=mHeldFrames.find(mServerFrame+1)) != nullptr) {
+		data.clear();
+		data.addRaw(next->data(), next->size());
+		mReceiver.handle(mBlobRegistry, mBlobReader);
+		mServerFrame++;
+		mHeldFrames.removeThrough(mServerFrame);
+	}
+	if (mHeldFrames.empty()) {
+		mGapAge = 0;
+		mResendWait = 0;
+	}
+	return true;
+}
+
+bool EngineClient::peekHeader(ds::DataBuffer& data, int32_t& frame, bool& keyframe) const {
+	const unsigned			pos = data.getReadPosition();
+	bool					ans = false;
+	keyframe = false;
+	if (data.canRead<char>() && data.read<char>() == HEADER_BLOB && data.canRead<int32_t>()) {
+		frame = data.read<int32_t>();
+		ans = true;
+		char				att;
+		while (data.canRead<char>() && (att=data.read<char>()) != ds::TERMINATOR_CHAR) {
+			if (att == ATT_KEYFRAME) keyframe = true;
+		}
+	}
+	data.setReadPosition(pos);
+	return ans;
+}
+
+void EngineClient::holdFrame(const int32_t frame) {
+	const ds::DataBuffer&	data(mReceiver.getData());
+	mHeldFrames.add(frame, data.data(), data.size());
+}
+
+void EngineClient::clearHeldFrames() {
+	mHeldFrames.clear();
+	mGapAge = 0;
+	mResendWait = 0;
+}
+
 void EngineClient::setState(State& s) {
 	if (&s == mState) return;
   
@@ -252,6 +339,7 @@ EngineClient::RunningState::RunningState() {
 void EngineClient::RunningState::begin(EngineClient &c) {
 	DS_LOG_INFO_M("RunningState", ds::IO_LOG);
 	c.mServerFrame = -1;
+	c.clearHeldFrames();
 }
 
 void EngineClient::RunningState::update(EngineClient &e) {
@@ -265,6 +353,28 @@ void EngineClient::RunningState::update(EngineClient &e) {
 	buf.add(e.mServerFrame);
 	buf.add(ds::TERMINATOR_CHAR);
 
+	// If there's a gap, ask the server for the missing frames
+	if (!e.mHeldFrames.empty()) {
+		if (++e.mGapAge > GAP_AGE_MAX || e.mHeldFrames.size() >= e.mHeldFrames.getMaxSize()) {
+			DS_LOG_WARNING_M("Missing frames never arrived, requesting world", ds::IO_LOG);
+			e.setState(e.mBlankState);
+			return;
+		}
+		if (--e.mResendWait <= 0) {
+			const int32_t	first = e.mServerFrame + 1;
+			buf.add(COMMAND_BLOB);
+			buf.add(CMD_CLIENT_REQUEST_FRAMES);
+			buf.add(ATT_SESSION_ID);
+			buf.add(e.mSessionId);
+			buf.add(ATT_FRAME);
+			buf.add(first);
+			buf.add(ATT_FRAME_COUNT);
+			buf.add(e.mHeldFrames.getOldest() - first);
+			buf.add(ds::TERMINATOR_CHAR);
+			e.mResendWait = RESEND_WAIT;
+		}
+	}
+
 	const int				count(e.getRootCount());
 	for (int k=0; k<count; ++k) {
 		const ui::Sprite&	s(e.getRootSprite(k));
@@ -50,11 +50,18 @@ private:
 	void							receiveClientStatus(ds::DataBuffer&);
 	void							onClientStartedReplyCommand(ds::DataBuffer&);
 
+	// Receive a frame and handle it in sequence. Frames that arrive ahead
+	// of a gap are held until the missing frames are resent, or a keyframe
+	// arrives. Answer true if there was data.
+	bool							receiveFrame();
+	bool							peekHeader(ds::DataBuffer&, int32_t& frame, bool& keyframe) const;
+	void							holdFrame(const int32_t frame);
+	void							clearHeldFrames();
+
 	typedef Engine inherited;
 	WorkManager						mWorkManager;
 	GlThread						mLoadImageThread;
 	ui::LoadImageService			mLoadImageService;
-	GlThread						mRenderTextThread;
 	ui::RenderTextService			mRenderTextService;
 
 	EngineIoInfo					mIoInfo;
@@ -68,6 +75,11 @@ private:
 	// True if I lost the connection, renewed it, and am
 	// waiting to hear back.
 	bool							mConnectionRenewed;
+	// Frames received ahead of a gap
+	EngineFrameHistory				mHeldFrames;
+	// Frames the current gap has been open, and until I ask for a resend again
+	int32_t							mGapAge;
+	int32_t							mResendWait;
 
     // STATES
 	class State {
@@ -8,6 +8,11 @@
 
 namespace ds {
 
+namespace {
+// Number of frames before I'll serve the same resend request again.
+const int32_t			RESEND_THROTTLE = 10;
+}
+
 /**
  * \class ds::EngineClientList
  */
@@ -55,6 +60,27 @@ void EngineClientList::reportingIn(const int32_t session_id, const int32_t frame
 	if (s) s->mServerSentFrame = frame;
 }
 
+bool EngineClientList::requestResend(	const int32_t session_id, const int32_t server_frame,
+										int32_t& first, int32_t& count) {
+	State* s = findClient(session_id);
+	if (!s || count < 1) return false;
+
+	if (s->mServerSentFrame >= first) {
+		count -= (s->mServerSentFrame - first) + 1;
+		first = s->mServerSentFrame + 1;
+	}
+	if (count < 1) return false;
+
+	if (s->mResendFirstFrame == first && s->mResendServerFrame >= 0
+			&& server_frame >= s->mResendServerFrame
+			&& (server_frame - s->mResendServerFrame) < RESEND_THROTTLE) {
+		return false;
+	}
+	s->mResendFirstFrame = first;
+	s->mResendServerFrame = server_frame;
+	return true;
+}
+
 void EngineClientList::compare(const int32_t server_frame) {
 	for (auto it=mClients.begin(), end=mClients.end(); it!=end; ++it) {
 		bool				needs_connection_error = false;
@@ -79,14 +105,18 @@ void EngineClientList::compare(const int32_t server_frame) {
 EngineClientList::State::State()
 		: mSessionId(0)
 		, mServerSentFrame(-1)
-		, mGlobalsHasConnectionError(false) {
+		, mGlobalsHasConnectionError(false)
+		, mResendFirstFrame(-1)
+		, mResendServerFrame(-1) {
 }
 
 EngineClientList::State::State(const std::string &guid, const int32_t sessionid)
 		: mGuid(guid)
 		, mSessionId(sessionid)
 		, mServerSentFrame(-1)
-		, mGlobalsHasConnectionError(false) {
+		, mGlobalsHasConnectionError(false)
+		, mResendFirstFrame(-1)
+		, mResendServerFrame(-1) {
 	std::wstringstream		buf;
 	buf << "The server has lost the connection to client  " << ds::wstr_from_utf8(guid) << ".";
 	mConnectionError = ErrorRef(ErrorRef::getNextId(), L"Client connection lost", buf.str());
@@ -31,6 +31,10 @@ public:
 		// Cache when my connection error is in the error list,
 		// so I can pull it out without going through all the message sending.
 		bool					mGlobalsHasConnectionError;
+		// The last resend request I served, and the server frame I served
+		// it on, so repeated requests don't flood the network.
+		int32_t					mResendFirstFrame;
+		int32_t					mResendServerFrame;
 	};
 
 public:
@@ -45,6 +49,11 @@ public:
 	const State*				findClient(const int32_t) const;
 	
 	void						reportingIn(const int32_t session_id, const int32_t frame);
+	// A client is asking for count frames starting at first. Clip the range
+	// to what the client has already reported receiving, and answer false if
+	// there's nothing to resend or I've recently served the same request.
+	bool						requestResend(	const int32_t session_id, const int32_t server_frame,
+												int32_t& first, int32_t& count);
 
 	void						compare(const int32_t server_frame);
 
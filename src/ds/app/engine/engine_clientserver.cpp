@@ -10,8 +10,9 @@ namespace ds {
 EngineClientServer::EngineClientServer(	ds::App& app, const ds::cfg::Settings& settings,
 										ds::EngineData& ed, const ds::RootList& roots)
 		: inherited(app, settings, ed, roots)
-		, mLoadImageService(mLoadImageThread, mIpFunctions)
-		, mRenderTextService(mRenderTextThread) {
+		, mLoadImageService(mLoadImageThread, mIpFunctions) {
+	mLoadImageService.configure(settings);
+	mRenderTextService.setThreadCount(settings.getInt("text:render_threads", 0, 2));
 }
 
 EngineClientServer::~EngineClientServer() {
@@ -21,7 +22,6 @@ void EngineClientServer::setup(ds::App& app) {
 	inherited::setup(app);
 
 	mLoadImageThread.start(true);
-	mRenderTextThread.start(true);
 }
 
 void EngineClientServer::draw() {
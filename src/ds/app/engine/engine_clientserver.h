@@ -28,7 +28,6 @@ private:
 	typedef AbstractEngineServer inherited;
 	GlThread						mLoadImageThread;
 	ui::LoadImageService			mLoadImageService;
-	GlThread						mRenderTextThread;
 	ui::RenderTextService			mRenderTextService;
 };
 
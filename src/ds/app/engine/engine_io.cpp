@@ -8,11 +8,95 @@
 
 namespace ds {
 
+namespace {
+// Largest possible UDP payload
+const int				MAX_DATAGRAM_SIZE = 64*1024;
+// Anything that claims to decompress larger than this is assumed to be garbage.
+const size_t			MAX_UNCOMPRESSED_SIZE = 256*1024*1024;
+}
+
+/**
+ * \class ds::EngineFrameHistory
+ */
+EngineFrameHistory::EngineFrameHistory(const int maxSize)
+		: mMaxSize(maxSize) {
+}
+
+void EngineFrameHistory::setMaxSize(const int maxSize) {
+	mMaxSize = maxSize;
+	while (!mFrames.empty() && static_cast<int>(mFrames.size()) > mMaxSize) {
+		mFrames.erase(mFrames.begin());
+	}
+}
+
+int EngineFrameHistory::getMaxSize() const {
+	return mMaxSize;
+}
+
+void EngineFrameHistory::clear() {
+	mFrames.clear();
+}
+
+bool EngineFrameHistory::empty() const {
+	return mFrames.empty();
+}
+
+int EngineFrameHistory::size() const {
+	return static_cast<int>(mFrames.size());
+}
+
+void EngineFrameHistory::add(const int32_t frame, const char* data, const int size) {
+	if (mMaxSize < 1 || !data || size < 1) return;
+	try {
+		mFrames[frame].assign(data, size);
+		while (static_cast<int>(mFrames.size()) > mMaxSize) {
+			mFrames.erase(mFrames.begin());
+		}
+	} catch (std::exception const&) {
+	}
+}
+
+const std::string* EngineFrameHistory::find(const int32_t frame) const {
+	auto f = mFrames.find(frame);
+	if (f == mFrames.end()) return nullptr;
+	return &(f->second);
+}
+
+void EngineFrameHistory::removeThrough(const int32_t frame) {
+	mFrames.erase(mFrames.begin(), mFrames.upper_bound(frame));
+}
+
+int32_t EngineFrameHistory::getOldest() const {
+	if (mFrames.empty()) return -1;
+	return mFrames.begin()->first;
+}
+
 /**
  * \class ds::EngineSender
  */
 EngineSender::EngineSender(ds::NetConnection& con)
-		: mConnection(con) {
+		: mConnection(con)
+		, mHistory(0) {
+}
+
+void EngineSender::setHistorySize(const int size) {
+	mHistory.setMaxSize(size);
+}
+
+void EngineSender::clearHistory() {
+	mHistory.clear();
+}
+
+bool EngineSender::resend(const int32_t frame) {
+	if (!mConnection.initialized()) return false;
+	const std::string*		data = mHistory.find(frame);
+	if (!data) return false;
+	mFragmenter.send(mConnection, data->data(), data->size());
+	return true;
+}
+
+bool EngineSender::canResend(const int32_t frame) const {
+	return mHistory.find(frame) != nullptr;
 }
 
 /**
@@ -20,20 +104,38 @@ EngineSender::EngineSender(ds::NetConnection& con)
  */
 EngineSender::AutoSend::AutoSend(EngineSender& sender)
 		: mData(sender.mSendBuffer)
-		, mSender(sender) {
+		, mSender(sender)
+		, mFrame(-1) {
+  mData.clear();
+}
+
+EngineSender::AutoSend::AutoSend(EngineSender& sender, const int32_t frame)
+		: mData(sender.mSendBuffer)
+		, mSender(sender)
+		, mFrame(frame) {
   mData.clear();
 }
 
 EngineSender::AutoSend::~AutoSend() {
 	// Send data to client
 	if (!mSender.mConnection.initialized()) return;
-	if (mData.size() < 1) return;
-
-	const int size = mData.size();
-	mSender.mRawDataBuffer.setSize(size);
-	mData.readRaw(mSender.mRawDataBuffer.data(), size);
-	snappy::Compress(mSender.mRawDataBuffer.data(), size, &mSender.mCompressionBuffer);
-	mSender.mConnection.sendMessage(mSender.mCompressionBuffer);
+	const int				size = mData.size();
+	if (size < 1) return;
+
+	// Compress straight out of the send buffer. The fragmenter makes the
+	// only other copy, when it prepends each datagram header.
+	RawDataBuffer&			compressed(mSender.mCompressionBuffer);
+	if (!compressed.setSize(static_cast<int>(snappy::MaxCompressedLength(size)))) {
+		DS_LOG_ERROR_M("EngineSender::AutoSend() can't allocate compression buffer", ds::IO_LOG);
+		mData.clear();
+		return;
+	}
+	size_t					compressedSize = 0;
+	snappy::RawCompress(mData.data(), size, compressed.data(), &compressedSize);
+	mSender.mFragmenter.send(mSender.mConnection, compressed.data(), static_cast<int>(compressedSize));
+	if (mFrame >= 0) {
+		mSender.mHistory.add(mFrame, compressed.data(), static_cast<int>(compressedSize));
+	}
 	mData.clear();
 }
 
@@ -45,7 +147,9 @@ EngineReceiver::EngineReceiver(ds::NetConnection& con)
 		, mHeaderId(0)
 		, mCommandId(0)
 		, mHeaderAndCommandOnly(false)
+		, mReceivedFragments(false)
 		, mNoDataCount(0) {
+	mDatagramBuffer.setSize(MAX_DATAGRAM_SIZE);
 	setHeaderAndCommandOnly();
 }
 
@@ -63,18 +167,27 @@ ds::DataBuffer& EngineReceiver::getData() {
 }
 
 bool EngineReceiver::receiveAndHandle(ds::BlobRegistry& registry, ds::BlobReader& reader) {
+	if (!receive()) return false;
+	handle(registry, reader);
+	return true;
+}
+
+bool EngineReceiver::receive() {
 	EngineReceiver::AutoReceive   receive(*this);
 	if (mReceiveBuffer.size() < 1) {
-		++mNoDataCount;
+		// A partial frame still means the connection is alive
+		if (!mReceivedFragments) ++mNoDataCount;
 		return false;
 	}
 
 	mNoDataCount = 0;
+	return true;
+}
 
-	const int					receiveSize = mReceiveBuffer.size();
+void EngineReceiver::handle(ds::BlobRegistry& registry, ds::BlobReader& reader) {
 	const char					size = static_cast<char>(registry.mReader.size());
-	while (receive.mData.canRead<char>()) {
-		const char				token = receive.mData.read<char>();
+	while (mReceiveBuffer.canRead<char>()) {
+		const char				token = mReceiveBuffer.read<char>();
 		if (token > 0 && token < size) {
 			// If we're doing header and command only, as soon as we hit a
 			// non-header, non-command, we need to bail
@@ -82,14 +195,13 @@ bool EngineReceiver::receiveAndHandle(ds::BlobRegistry& registry, ds::BlobReader
 				if (token == mHeaderId || token == mCommandId) {
 					registry.mReader[token](reader);
 				} else {
-					return true;
+					return;
 				}
 			} else {
 				registry.mReader[token](reader);
 			}
 		}
 	}
-	return true;
 }
 
 bool EngineReceiver::hasLostConnection() const {
@@ -106,9 +218,28 @@ void EngineReceiver::clearLostConnection() {
 EngineReceiver::AutoReceive::AutoReceive(EngineReceiver& receiver)
 		: mData(receiver.mReceiveBuffer) {
 	mData.clear();
-	if (receiver.mConnection.recvMessage(receiver.mCompressionBufferWrite)) {
-		snappy::Uncompress(receiver.mCompressionBufferWrite.c_str(), receiver.mCompressionBufferWrite.size(), &receiver.mCompressionBufferRead);
-		mData.addRaw(receiver.mCompressionBufferRead.c_str(), receiver.mCompressionBufferRead.size());
+	receiver.mReceivedFragments = false;
+	// Pull datagrams until a frame completes. The limit guarantees I return
+	// on a flood; anything left over is picked up by the next receive.
+	char*					datagram = receiver.mDatagramBuffer.data();
+	const int				datagramAlloc = receiver.mDatagramBuffer.size();
+	int						limit = 8192,
+							size;
+	while (--limit >= 0 && (size = receiver.mConnection.recvMessage(datagram, datagramAlloc)) != 0) {
+		receiver.mReceivedFragments = true;
+		if (size < 0 || !receiver.mReassembler.add(datagram, size)) continue;
+
+		// Decompress straight into the receive buffer
+		const char*			frame = receiver.mReassembler.getFrameData();
+		const int			frameSize = receiver.mReassembler.getFrameSize();
+		size_t				length = 0;
+		if (snappy::GetUncompressedLength(frame, frameSize, &length) && length <= MAX_UNCOMPRESSED_SIZE
+				&& snappy::RawUncompress(frame, frameSize, mData.prepareRaw(static_cast<unsigned>(length)))) {
+			mData.commitRaw(static_cast<unsigned>(length));
+		} else {
+			DS_LOG_WARNING_M("EngineReceiver::AutoReceive() failed to uncompress frame", ds::IO_LOG);
+		}
+		break;
 	}
 }
 
@@ -2,9 +2,11 @@
 #ifndef DS_APP_ENGINE_ENGINEIO_H_
 #define DS_APP_ENGINE_ENGINEIO_H_
 
+#include <map>
 #include "ds/data/data_buffer.h"
 #include "ds/data/raw_data_buffer.h"
 #include "ds/network/net_connection.h"
+#include "ds/network/net_fragmenter.h"
 
 /**
  * Hide the busy work of sending information between the server and client.
@@ -14,6 +16,37 @@ namespace ds {
 class BlobReader;
 class BlobRegistry;
 
+/**
+ * \class ds::EngineFrameHistory
+ * A bounded collection of frames, keyed by the frame number sent
+ * in the header. The server uses it to resend recent frames, the
+ * client to hold frames that arrived ahead of a gap.
+ */
+class EngineFrameHistory {
+public:
+	EngineFrameHistory(const int maxSize = 120);
+
+	void						setMaxSize(const int);
+	int							getMaxSize() const;
+	void						clear();
+	bool						empty() const;
+	int							size() const;
+
+	// Adding past the max size drops the oldest frame.
+	void						add(const int32_t frame, const char* data, const int size);
+	// Answer nullptr if the frame isn't in the history.
+	const std::string*			find(const int32_t frame) const;
+	// Remove all frames up to and including the supplied frame.
+	void						removeThrough(const int32_t frame);
+	// Answer the oldest frame in the history, or -1 if empty.
+	int32_t						getOldest() const;
+
+private:
+	int							mMaxSize;
+	std::map<int32_t, std::string>
+								mFrames;
+};
+
 /**
  * \class ds::EngineSender
  * Send data from a source to destination.
@@ -22,22 +55,36 @@ class EngineSender {
 public:
 	EngineSender(ds::NetConnection&);
 
+	// Frames sent with a frame number are kept in a history so
+	// they can be resent when a client misses them.
+	void						setHistorySize(const int);
+	void						clearHistory();
+	// Answer false if the frame is no longer in the history.
+	bool						resend(const int32_t frame);
+	bool						canResend(const int32_t frame) const;
+
 private:
 	ds::NetConnection&			mConnection;
 	ds::DataBuffer				mSendBuffer;
-	RawDataBuffer				mRawDataBuffer;
-	std::string					mCompressionBuffer;
+	// Frames are compressed straight out of the send buffer into this
+	RawDataBuffer				mCompressionBuffer;
+	// Split each compressed frame into MTU-sized datagrams
+	ds::NetFragmenter			mFragmenter;
+	EngineFrameHistory			mHistory;
 
 public:
 	class AutoSend {
 	public:
 		AutoSend(EngineSender&);
+		// Record the sent data in the history under the supplied frame.
+		AutoSend(EngineSender&, const int32_t frame);
 		~AutoSend();
 
 		ds::DataBuffer&			mData;
 
 	private:
 		EngineSender&			mSender;
+		const int32_t			mFrame;
 	};
 };
 
@@ -60,14 +107,24 @@ public:
 	// Convenience for clients with a blob reader, automatically
 	// receive and handle the data. Answer true if there was data.
 	bool						receiveAndHandle(ds::BlobRegistry&, ds::BlobReader&);
+	// The two halves of receiveAndHandle(), for clients that need to
+	// inspect a frame before handling it. receive() answers true if
+	// there was data, which is available from getData().
+	bool						receive();
+	void						handle(ds::BlobRegistry&, ds::BlobReader&);
 	bool						hasLostConnection() const;
 	void						clearLostConnection();
 
 private:
 	ds::NetConnection&			mConnection;
 	ds::DataBuffer				mReceiveBuffer;
-	std::string					mCompressionBufferRead;
-	std::string					mCompressionBufferWrite;
+	// Datagrams are received into this, and single-datagram
+	// frames are decompressed from it into the receive buffer.
+	RawDataBuffer				mDatagramBuffer;
+	// Rebuild whole frames from the datagrams sent by a NetFragmenter
+	ds::NetReassembler			mReassembler;
+	// True if the last receive got fragments, even if it didn't complete a frame
+	bool						mReceivedFragments;
 	// The header and command blob IDs, used for filtering. The header
 	// and command are always processed, but anything else depends on the state
 	char						mHeaderId,
@@ -15,11 +15,14 @@ const char			CMD_CLIENT_STARTED_REPLY = 2;
 const char			CMD_CLIENT_STARTED = 3;
 const char			CMD_CLIENT_REQUEST_WORLD = 4;
 const char			CMD_CLIENT_RUNNING = 5;
+const char			CMD_CLIENT_REQUEST_FRAMES = 6;
 
 const char			ATT_CLIENT = 1;
 const char			ATT_GLOBAL_ID = 2;
 const char			ATT_SESSION_ID = 3;
 const char			ATT_FRAME = 4;
+const char			ATT_FRAME_COUNT = 5;
+const char			ATT_KEYFRAME = 6;
 
 /**
  * \class ds::EngineIoInfo
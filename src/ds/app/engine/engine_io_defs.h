@@ -21,11 +21,17 @@ extern const char				CMD_CLIENT_REQUEST_WORLD;	// The client is requesting the e
 
 extern const char				CMD_CLIENT_RUNNING;			// A general heartbeat from the client.
 
+extern const char				CMD_CLIENT_REQUEST_FRAMES;	// The client missed a range of frames, and is
+															// requesting the server resend them: ATT_SESSION_ID,
+															// ATT_FRAME (first), ATT_FRAME_COUNT
+
 // ATTRIBUTES
 extern const char				ATT_CLIENT;					// Header for a client, which might have: ATT_GLOBAL_ID, ATT_SESSION_ID
 extern const char				ATT_GLOBAL_ID;				// A string, which is a GUID
 extern const char				ATT_SESSION_ID;				// An int32, which is a client-unique ID
 extern const char				ATT_FRAME;					// A frame number
+extern const char				ATT_FRAME_COUNT;			// An int32, a number of frames
+extern const char				ATT_KEYFRAME;				// No data. In the header, flags a frame that contains the entire world
 
 /**
  * \class ds::EngineIoInfo
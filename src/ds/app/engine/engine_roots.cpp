@@ -108,6 +108,7 @@ void OrthRoot::drawServer(const DrawParams& p) {
 }
 
 ui::Sprite* OrthRoot::getHit(const ci::Vec3f& point) {
+	if (mRootBuilder.mPickBounds) return mSprite->getHitBounded(point);
 	return mSprite->getHit(point);
 }
 
@@ -43,6 +43,11 @@ AbstractEngineServer::AbstractEngineServer(	ds::App& app, const ds::cfg::Setting
 	DELETE_SPRITE_BLOB = mBlobRegistry.add([this](BlobReader& r) {receiveDeleteSprite(r.mDataBuffer);});
 	CLIENT_STATUS_BLOB = mBlobRegistry.add([this](BlobReader& r) {receiveClientStatus(r.mDataBuffer);});
 
+	mSender.setHistorySize(settings.getInt("server:resend_frames", 0, 120));
+	mRunningState.setKeyframeInterval(settings.getInt("server:keyframe_interval", 0, 600));
+	mTreeWriter.setThreadCount(settings.getInt("server:write_threads", 0, 0));
+	mWorkManager.configure(settings);
+
 	try {
 		if (settings.getBool("server:connect", 0, true)) {
 			mSendConnection.initialize(true, settings.getText("server:ip"), ds::value_to_string(settings.getInt("server:send_port")));
@@ -82,6 +87,9 @@ void AbstractEngineServer::setupTuio(ds::App& a) {
 
 void AbstractEngineServer::update() {
 	mWorkManager.update();
+	getLoadImageService().update();
+	getRenderTextService().update();
+	getFontService().update();
 	updateServer();
 
 	mState->update(*this);
@@ -115,6 +123,8 @@ void AbstractEngineServer::receiveCommand(ds::DataBuffer &data) {
 			onClientStartedCommand(data);
 		} else if (cmd == CMD_CLIENT_RUNNING) {
 			onClientRunningCommand(data);
+		} else if (cmd == CMD_CLIENT_REQUEST_FRAMES) {
+			onClientRequestFramesCommand(data);
 		} else if (cmd == CMD_CLIENT_REQUEST_WORLD) {
 			DS_LOG_INFO_M("CMD_CLIENT_REQUEST_WORLD", ds::IO_LOG);
 			setState(mSendWorldState);
@@ -186,6 +196,33 @@ void AbstractEngineServer::onClientRunningCommand(ds::DataBuffer &data) {
 	mClients.reportingIn(session_id, frame);
 }
 
+void AbstractEngineServer::onClientRequestFramesCommand(ds::DataBuffer &data) {
+	if (!data.canRead<char>()) return;
+
+	// Session ID
+	char				att = data.read<char>();
+	if (att != ATT_SESSION_ID || !data.canRead<int32_t>()) return;
+	const int32_t		session_id = data.read<int32_t>();
+
+	// First missing frame
+	if (!data.canRead<char>()) return;
+	att = data.read<char>();
+	if (att != ATT_FRAME || !data.canRead<int32_t>()) return;
+	const int32_t		first = data.read<int32_t>();
+
+	// Count
+	if (!data.canRead<char>()) return;
+	att = data.read<char>();
+	if (att != ATT_FRAME_COUNT || !data.canRead<int32_t>()) return;
+	const int32_t		count = data.read<int32_t>();
+
+	// Resends only make sense while frames are being numbered. In any other
+	// state the client is about to get the world anyway.
+	if (mState == &mRunningState) {
+		mRunningState.resendFrames(*this, session_id, first, count);
+	}
+}
+
 void AbstractEngineServer::setState(State& s) {
 	if (&s == mState) return;
   
@@ -202,10 +239,11 @@ AbstractEngineServer::State::State() {
 void AbstractEngineServer::State::begin(AbstractEngineServer&) {
 }
 
-void AbstractEngineServer::State::addHeader(ds::DataBuffer& data, const int frame) {
+void AbstractEngineServer::State::addHeader(ds::DataBuffer& data, const int frame, const bool keyframe) {
     data.add(HEADER_BLOB);
 
     data.add(frame);
+    if (keyframe) data.add(ATT_KEYFRAME);
     data.add(ds::TERMINATOR_CHAR);
 }
 
@@ -213,14 +251,40 @@ void AbstractEngineServer::State::addHeader(ds::DataBuffer& data, const int fram
  * EngineServer::RunningState
  */
 EngineServer::RunningState::RunningState()
-		: mFrame(0) {
+		: mFrame(0)
+		, mKeyframeInterval(0)
+		, mKeyframeRequested(false) {
 	mDeletedSprites.reserve(128);
 }
 
-void EngineServer::RunningState::begin(AbstractEngineServer&) {
+void EngineServer::RunningState::begin(AbstractEngineServer& engine) {
 	DS_LOG_INFO_M("RunningState", ds::IO_LOG);
 	mFrame = 0;
 	mDeletedSprites.clear();
+	mKeyframeRequested = false;
+	// Frame numbers start over, so nothing in the history is valid
+	engine.mSender.clearHistory();
+}
+
+void EngineServer::RunningState::setKeyframeInterval(const int32_t interval) {
+	mKeyframeInterval = interval;
+}
+
+void EngineServer::RunningState::resendFrames(	AbstractEngineServer& engine, const int32_t session_id,
+												int32_t first, int32_t count) {
+	if (first < 0 || first >= mFrame) return;
+	if (first + count > mFrame) count = mFrame - first;
+	if (!engine.mClients.requestResend(session_id, mFrame, first, count)) return;
+
+	// Frames are only useful to the client in order, so as soon as one
+	// is missing from the history the only way back is a keyframe.
+	for (int32_t k=0; k<count; ++k) {
+		if (!engine.mSender.resend(first+k)) {
+			DS_LOG_INFO_M("Client " << session_id << " missed frame " << (first+k) << " which is gone from the history, sending keyframe", ds::IO_LOG);
+			mKeyframeRequested = true;
+			return;
+		}
+	}
 }
 
 void EngineServer::RunningState::update(AbstractEngineServer& engine) {
@@ -232,13 +296,19 @@ void EngineServer::RunningState::update(AbstractEngineServer& engine) {
 
 	// Send data to clients
 	{
-		EngineSender::AutoSend  send(engine.mSender);
+		const bool				keyframe = mKeyframeRequested || (mKeyframeInterval > 0 && mFrame > 0 && (mFrame % mKeyframeInterval) == 0);
+		mKeyframeRequested = false;
+
+		EngineSender::AutoSend  send(engine.mSender, mFrame);
 		// Always send the header
-		addHeader(send.mData, mFrame);
+		addHeader(send.mData, mFrame, keyframe);
 //		DS_LOG_INFO_M("running frame=" << mFrame, ds::IO_LOG);
 		ui::Sprite                 &root = engine.getRootSprite();
+		if (keyframe) {
+			root.markTreeAsDirty();
+		}
 		if (root.isDirty()) {
-			root.writeTo(send.mData);
+			engine.mTreeWriter.write(root, send.mData);
 		}
 		if (!mDeletedSprites.empty()) {
 			addDeletedSprites(send.mData);
@@ -346,7 +416,7 @@ void EngineServer::SendWorldState::update(AbstractEngineServer& engine) {
 
 		ui::Sprite                 &root = engine.getRootSprite();
 		root.markTreeAsDirty();
-		root.writeTo(send.mData);
+		engine.mTreeWriter.write(root, send.mData);
 	}
 
 	engine.setState(engine.mRunningState);
@@ -358,8 +428,7 @@ void EngineServer::SendWorldState::update(AbstractEngineServer& engine) {
 EngineServer::EngineServer(	ds::App& app, const ds::cfg::Settings& settings,
 							ds::EngineData& ed, const ds::RootList& roots)
     : inherited(app, settings, ed, roots)
-    , mLoadImageService(mLoadImageThread, mIpFunctions)
-    , mRenderTextService(mRenderTextThread) {
+    , mLoadImageService(mLoadImageThread, mIpFunctions) {
 }
 
 EngineServer::~EngineServer() {
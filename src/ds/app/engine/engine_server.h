@@ -6,6 +6,7 @@
 #include "ds/app/engine/engine.h"
 #include "ds/app/engine/engine_client_list.h"
 #include "ds/app/engine/engine_io.h"
+#include "ds/app/engine/engine_tree_writer.h"
 #include "ds/network/udp_connection.h"
 #include "ds/thread/gl_thread.h"
 #include "ds/thread/work_manager.h"
@@ -48,6 +49,7 @@ private:
 	void							receiveClientStatus(ds::DataBuffer&);
 	void							onClientStartedCommand(ds::DataBuffer&);
 	void							onClientRunningCommand(ds::DataBuffer&);
+	void							onClientRequestFramesCommand(ds::DataBuffer&);
 
 	typedef Engine inherited;
 	WorkManager						mWorkManager;
@@ -59,6 +61,7 @@ private:
 	EngineSender					mSender;
 	EngineReceiver					mReceiver;
 	ds::BlobReader					mBlobReader;
+	EngineTreeWriter				mTreeWriter;
 
     // STATES
 	class State {
@@ -69,7 +72,7 @@ private:
 		virtual void				spriteDeleted(const ds::sprite_id_t&) { }
 
 	protected:
-		void						addHeader(ds::DataBuffer&, const int frame);
+		void						addHeader(ds::DataBuffer&, const int frame, const bool keyframe = false);
 	};
 
 	/* Default state: Gathers all changes in the app and sends them out each frame.
@@ -81,11 +84,22 @@ private:
 		virtual void				update(AbstractEngineServer&);
 		virtual void				spriteDeleted(const ds::sprite_id_t&);
 
+		// Send the entire world every interval frames, so clients that
+		// fell too far behind can resync without requesting the world.
+		// 0 turns off periodic keyframes.
+		void						setKeyframeInterval(const int32_t);
+		// A client has missed frames. Resend them from the history, or
+		// send a keyframe next if they're no longer available.
+		void						resendFrames(AbstractEngineServer&, const int32_t session_id,
+												 int32_t first, int32_t count);
+
 	private:
 		void						addDeletedSprites(ds::DataBuffer&) const;
 
 		int32_t						mFrame;
 		std::vector<sprite_id_t>	mDeletedSprites;
+		int32_t						mKeyframeInterval;
+		bool						mKeyframeRequested;
 	};
 
 	/* This state is used to send a client started reply.
@@ -135,7 +149,6 @@ private:
 	typedef AbstractEngineServer inherited;
 	GlNoThread						mLoadImageThread;
 	ui::LoadImageService			mLoadImageService;
-	GlNoThread						mRenderTextThread;
 	ui::RenderTextService			mRenderTextService;
 };
 
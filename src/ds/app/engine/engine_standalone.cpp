@@ -13,8 +13,10 @@ namespace ds {
 EngineStandalone::EngineStandalone(	ds::App& app, const ds::cfg::Settings& settings,
 									ds::EngineData& ed, const ds::RootList& roots)
 		: inherited(app, settings, ed, roots)
-		, mLoadImageService(mLoadImageThread, mIpFunctions)
-		, mRenderTextService(mRenderTextThread) {
+		, mLoadImageService(mLoadImageThread, mIpFunctions) {
+	mLoadImageService.configure(settings);
+	mRenderTextService.setThreadCount(settings.getInt("text:render_threads", 0, 2));
+	mWorkManager.configure(settings);
 }
 
 EngineStandalone::~EngineStandalone() {
@@ -34,7 +36,6 @@ void EngineStandalone::setup(ds::App& app) {
 	inherited::setup(app);
 
 	mLoadImageThread.start(true);
-	mRenderTextThread.start(true);
 
 	app.setupServer();
 }
@@ -50,7 +51,9 @@ void EngineStandalone::setupTuio(ds::App& a) {
 
 void EngineStandalone::update() {
 	mWorkManager.update();
+	mLoadImageService.update();
 	mRenderTextService.update();
+	getFontService().update();
 	updateServer();
 }
 
@@ -40,7 +40,6 @@ private:
 	WorkManager					mWorkManager;
 	GlThread					mLoadImageThread;
 	ui::LoadImageService		mLoadImageService;
-	GlThread					mRenderTextThread;
 	ui::RenderTextService		mRenderTextService;
 };
 
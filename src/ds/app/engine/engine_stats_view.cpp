@@ -1,5 +1,6 @@
 #include "engine_stats_view.h"
 
+#include <Poco/Path.h>
 #include "ds/app/blob_reader.h"
 #include "ds/data/data_buffer.h"
 #include "engine_data.h"
@@ -21,6 +22,13 @@ std::string			make_line(const std::string &key, const std::string &v) {
 	return key + ": " + v;
 }
 
+std::string			make_font_line(const ds::ui::FontService::FaceStats& s) {
+	std::stringstream	buf;
+	buf << "  " << Poco::Path(s.mFilename).getFileName() << ": " << s.mSizesInUse << "/" << s.mSizes
+		<< " sizes in use, " << s.mGlyphs << " glyphs, " << (s.mBytes / 1024) << " KB";
+	return buf.str();
+}
+
 }
 
 /**
@@ -81,6 +89,15 @@ void EngineStatsView::drawLocalClient() {
 	const float			gap = 5.0f;
 	y = drawLine(make_line("Sprites", mEngine.mSprites.size()), y) + gap;
 	y = drawLine(make_line("Touch mode (t)", ds::ui::TouchMode::toString(mEngine.mTouchMode)), y) + gap;
+
+	const ds::ui::ImageCache<ds::ui::FontKey>::Stats
+						font_stats(mEngine.mFontService.getCacheStats());
+	y = drawLine(make_line("Font KB", static_cast<int>(font_stats.mResidentBytes / 1024)), y) + gap;
+	const std::vector<ds::ui::FontService::FaceStats>
+						faces(mEngine.mFontService.getFaceStats());
+	for (auto it=faces.begin(), end=faces.end(); it!=end; ++it) {
+		y = drawLine(make_font_line(*it), y) + gap;
+	}
 }
 
 float EngineStatsView::drawLine(const std::string &v, const float y) {
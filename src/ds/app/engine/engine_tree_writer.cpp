@@ -0,0 +1,181 @@
+#include "ds/app/engine/engine_tree_writer.h"
+
+#include <Poco/Exception.h>
+#include "ds/debug/logger.h"
+#include "ds/ui/sprite/sprite.h"
+
+namespace ds {
+
+namespace {
+// Split into this many subtrees per thread, so one large
+// subtree doesn't leave the other threads idle.
+const size_t			SUBTREES_PER_THREAD = 4;
+// Everything above the split is written serially, so don't go too deep.
+const int				MAX_SPLIT_DEPTH = 4;
+}
+
+/**
+ * \class ds::EngineTreeWriter
+ */
+EngineTreeWriter::EngineTreeWriter(const int threads)
+		: mThreadCount(0)
+		, mBufferCount(0)
+		, mNextItem(0) {
+	setThreadCount(threads);
+}
+
+EngineTreeWriter::~EngineTreeWriter() {
+	if (mPool) mPool->joinAll();
+}
+
+void EngineTreeWriter::setThreadCount(const int threads) {
+	const int				count = (threads > 0 ? threads : 0);
+	if (count == mThreadCount) return;
+
+	if (mPool) mPool->joinAll();
+	mPool.reset();
+	mWorkers.clear();
+	mThreadCount = count;
+	if (mThreadCount < 1) return;
+
+	try {
+		mPool.reset(new Poco::ThreadPool(mThreadCount, mThreadCount));
+		for (int k=0; k<mThreadCount; ++k) {
+			mWorkers.push_back(std::unique_ptr<Worker>(new Worker(*this)));
+		}
+	} catch (std::exception const& ex) {
+		DS_LOG_WARNING_M("EngineTreeWriter can't start threads, writing serially (" << ex.what() << ")", ds::IO_LOG);
+		mPool.reset();
+		mWorkers.clear();
+		mThreadCount = 0;
+	}
+}
+
+int EngineTreeWriter::getThreadCount() const {
+	return mThreadCount;
+}
+
+void EngineTreeWriter::write(ui::Sprite& root, ds::DataBuffer& out) {
+	// Anything that reaches past a single sprite happens here, before the split.
+	root.prepareToWrite();
+	if (mThreadCount < 1 || !mPool) {
+		root.writeTo(out);
+		return;
+	}
+
+	mBufferCount = 0;
+	split(root);
+
+	size_t					subtrees = 0;
+	for (auto it=mItems.begin(), end=mItems.end(); it!=end; ++it) {
+		if (it->mSubtree) ++subtrees;
+	}
+
+	// I take one of the subtrees myself
+	mNextItem = 0;
+	for (size_t k=1; k<subtrees && k<=mWorkers.size(); ++k) {
+		try {
+			mPool->start(*(mWorkers[k-1].get()));
+		} catch (Poco::Exception const&) {
+			// Whatever is left will be written by the threads that did start.
+			break;
+		}
+	}
+	writeSubtrees();
+	mPool->joinAll();
+
+	for (auto it=mItems.begin(), end=mItems.end(); it!=end; ++it) {
+		const ds::DataBuffer&	buf = getBuffer(it->mBuffer);
+		if (buf.size() > 0) out.addRaw(buf.data(), buf.size());
+	}
+}
+
+void EngineTreeWriter::split(ui::Sprite& root) {
+	mItems.clear();
+	mItems.push_back(Item(&root, true));
+
+	const size_t			target = (mThreadCount + 1) * SUBTREES_PER_THREAD;
+	size_t					subtrees = 1;
+	for (int depth=0; depth<MAX_SPLIT_DEPTH && subtrees < target; ++depth) {
+		// Replace every subtree with the sprite's own blob, followed by
+		// each of its dirty children as a new subtree. This is the same
+		// order writeTo() uses.
+		mNextItems.clear();
+		subtrees = 0;
+		for (auto it=mItems.begin(), end=mItems.end(); it!=end; ++it) {
+			if (!it->mSubtree) {
+				mNextItems.push_back(*it);
+				continue;
+			}
+			const size_t	buffer = newBuffer();
+			// If the sprite doesn't write, neither does anything below it.
+			if (!it->mSprite->writeSelfTo(getBuffer(buffer))) continue;
+			mNextItems.push_back(Item(it->mSprite, false, buffer));
+
+			mChildren.clear();
+			it->mSprite->getDirtyChildren(mChildren);
+			for (auto cit=mChildren.begin(), cend=mChildren.end(); cit!=cend; ++cit) {
+				mNextItems.push_back(Item(*cit, true));
+				++subtrees;
+			}
+		}
+		mItems.swap(mNextItems);
+	}
+
+	for (auto it=mItems.begin(), end=mItems.end(); it!=end; ++it) {
+		if (it->mSubtree) it->mBuffer = newBuffer();
+	}
+}
+
+void EngineTreeWriter::writeSubtrees() {
+	while (true) {
+		size_t				index;
+		{
+			Poco::FastMutex::ScopedLock		l(mMutex);
+			while (mNextItem < mItems.size() && !mItems[mNextItem].mSubtree) ++mNextItem;
+			if (mNextItem >= mItems.size()) return;
+			index = mNextItem++;
+		}
+
+		const Item&			item = mItems[index];
+		try {
+			item.mSprite->writeTo(getBuffer(item.mBuffer));
+		} catch (std::exception const& ex) {
+			DS_LOG_WARNING_M("EngineTreeWriter::writeSubtrees() " << ex.what(), ds::IO_LOG);
+		}
+	}
+}
+
+size_t EngineTreeWriter::newBuffer() {
+	if (mBufferCount >= mBuffers.size()) {
+		mBuffers.push_back(std::unique_ptr<ds::DataBuffer>(new ds::DataBuffer()));
+	}
+	mBuffers[mBufferCount]->clear();
+	return mBufferCount++;
+}
+
+ds::DataBuffer& EngineTreeWriter::getBuffer(const size_t index) {
+	return *(mBuffers[index].get());
+}
+
+/**
+ * \class ds::EngineTreeWriter::Item
+ */
+EngineTreeWriter::Item::Item(ui::Sprite* s, const bool subtree, const size_t buffer)
+		: mSprite(s)
+		, mSubtree(subtree)
+		, mBuffer(buffer) {
+}
+
+/**
+ * \class ds::EngineTreeWriter::Worker
+ */
+EngineTreeWriter::Worker::Worker(EngineTreeWriter& w)
+		: mWriter(w) {
+}
+
+void EngineTreeWriter::Worker::run() {
+	mWriter.writeSubtrees();
+}
+
+} // namespace ds
@@ -0,0 +1,89 @@
+#pragma once
+#ifndef DS_APP_ENGINE_ENGINETREEWRITER_H_
+#define DS_APP_ENGINE_ENGINETREEWRITER_H_
+
+#include <memory>
+#include <vector>
+#include <Poco/Mutex.h>
+#include <Poco/Runnable.h>
+#include <Poco/ThreadPool.h>
+#include "ds/data/data_buffer.h"
+
+namespace ds {
+namespace ui {
+class Sprite;
+} // namespace ui
+
+/**
+ * \class ds::EngineTreeWriter
+ * \brief Write the dirty sprite tree for the server, optionally splitting
+ * it across worker threads. The top of the tree is written on the calling
+ * thread until there are enough dirty subtrees to go around, then each
+ * subtree is written into its own buffer by whichever thread gets to it
+ * first. The buffers are appended in tree order, so the result is
+ * byte-for-byte what root.writeTo() would have produced. The tree is
+ * always prepared on the calling thread first.
+ */
+class EngineTreeWriter {
+public:
+	// 0 threads writes serially on the calling thread.
+	EngineTreeWriter(const int threads = 0);
+	~EngineTreeWriter();
+
+	void							setThreadCount(const int);
+	int								getThreadCount() const;
+
+	// Same as root.prepareToWrite() then root.writeTo(out).
+	void							write(ui::Sprite& root, ds::DataBuffer& out);
+
+private:
+	EngineTreeWriter(const EngineTreeWriter&);
+	EngineTreeWriter&				operator=(const EngineTreeWriter&);
+
+	// Break the tree into blobs written here and subtrees for the workers.
+	void							split(ui::Sprite& root);
+	// Write subtrees until there are none left. Run by every thread.
+	void							writeSubtrees();
+	// Answer the index of a cleared buffer.
+	size_t							newBuffer();
+	ds::DataBuffer&					getBuffer(const size_t index);
+
+	class Item {
+	public:
+		Item(ui::Sprite* s = nullptr, const bool subtree = false, const size_t buffer = 0);
+
+		ui::Sprite*					mSprite;
+		// If false, the sprite's own blob has already been written.
+		bool						mSubtree;
+		size_t						mBuffer;
+	};
+
+	class Worker : public Poco::Runnable {
+	public:
+		Worker(EngineTreeWriter&);
+		virtual void				run();
+
+	private:
+		EngineTreeWriter&			mWriter;
+	};
+
+	int								mThreadCount;
+	std::unique_ptr<Poco::ThreadPool>
+									mPool;
+	std::vector<std::unique_ptr<Worker>>
+									mWorkers;
+	// Reused every frame
+	std::vector<Item>				mItems,
+									mNextItems;
+	std::vector<ui::Sprite*>		mChildren;
+	std::vector<std::unique_ptr<ds::DataBuffer>>
+									mBuffers;
+	size_t							mBufferCount;
+
+	Poco::FastMutex					mMutex;
+	size_t							mNextItem;
+};
+
+} // namespace ds
+
+#endif // DS_APP_ENGINE_ENGINETREEWRITER_H_
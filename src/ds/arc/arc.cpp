@@ -1,5 +1,7 @@
 #include "ds/arc/arc.h"
 
+#include "ds/arc/arc_render_circle.h"
+
 namespace ds {
 namespace arc {
 
@@ -19,10 +21,29 @@ double Arc::run(const Input&, const double v) const
 	return v;
 }
 
+void Arc::runArray(const Input& input, double* values, const size_t count) const
+{
+	for (size_t k=0; k<count; ++k) values[k] = run(input, values[k]);
+}
+
 void Arc::renderCircle(const Input&, RenderCircleParams&) const
 {
 }
 
+void Arc::renderCircleRow(const Input& input, RenderCircleParams& p, ci::ColorA* out, const size_t count) const
+{
+	const double		x = p.mX;
+	const ci::ColorA	output = p.mOutput;
+	for (size_t k=0; k<count; ++k) {
+		p.mX = x + static_cast<double>(k);
+		p.mOutput = out[k];
+		renderCircle(input, p);
+		out[k] = p.mOutput;
+	}
+	p.mX = x;
+	p.mOutput = output;
+}
+
 void Arc::readXml(const ci::XmlTree&)
 {
 }
@@ -3,6 +3,7 @@
 #define DS_ARC_ARC_H_
 
 #include <string>
+#include <cinder/Color.h>
 #include <cinder/Xml.h>
 
 namespace ds {
@@ -21,8 +22,14 @@ public:
 
 	// Basic perform operation. Translate the value based on subclass params
 	virtual double				run(const Input&, const double) const;
+	// run() on count values in place. Subclasses should override this to
+	// do their setup once instead of once per value.
+	virtual void				runArray(const Input&, double* values, const size_t count) const;
 
 	virtual void				renderCircle(const Input&, RenderCircleParams&) const;
+	// renderCircle() on count pixels of a row, starting at the params
+	// mX and mY, compositing into out. The params are left as they were.
+	virtual void				renderCircleRow(const Input&, RenderCircleParams&, ci::ColorA* out, const size_t count) const;
 
 	virtual void				readXml(const ci::XmlTree&);
 
@@ -20,6 +20,13 @@ double Chain::run(const Input& input, const double v) const {
 	return ans;
 }
 
+void Chain::runArray(const Input& input, double* values, const size_t count) const {
+	for (auto it=mArc.begin(), end=mArc.end(); it!=end; ++it) {
+		const Arc*		a = it->get();
+		if (a) a->runArray(input, values, count);
+	}
+}
+
 void Chain::renderCircle(const Input& input, RenderCircleParams& p) const {
 	for (auto it=mArc.begin(), end=mArc.end(); it!=end; ++it) {
 		const Arc*		a = it->get();
@@ -27,6 +34,15 @@ void Chain::renderCircle(const Input& input, RenderCircleParams& p) const {
 	}
 }
 
+// Every pixel is independent, so running each arc across the whole row
+// gives the same answer as running the whole chain on each pixel.
+void Chain::renderCircleRow(const Input& input, RenderCircleParams& p, ci::ColorA* out, const size_t count) const {
+	for (auto it=mArc.begin(), end=mArc.end(); it!=end; ++it) {
+		const Arc*		a = it->get();
+		if (a) a->renderCircleRow(input, p, out, count);
+	}
+}
+
 void Chain::readXml(const ci::XmlTree& xml) {
 	mArc.clear();
 
@@ -18,7 +18,9 @@ public:
 	Chain();
 	
 	virtual double				run(const Input&, const double) const;
+	virtual void				runArray(const Input&, double* values, const size_t count) const;
 	virtual void				renderCircle(const Input&, RenderCircleParams&) const;
+	virtual void				renderCircleRow(const Input&, RenderCircleParams&, ci::ColorA* out, const size_t count) const;
 
 	virtual void				readXml(const ci::XmlTree&);
 
@@ -31,6 +31,16 @@ ci::ColorA ColorArray::at(const Input& input, const double unit) const
 return ci::ColorA(0.0, 0.0, 0.0, static_cast<float>(unit));
 }
 
+void ColorArray::at(const Input& input, const double* unit, ci::ColorA* out, const size_t count) const
+{
+	if (mColor.size() == 1) {
+		const ci::ColorA	c = mColor[0].getValue(input);
+		for (size_t k=0; k<count; ++k) out[k] = ci::ColorA(c.r, c.g, c.b, c.a * static_cast<float>(unit[k]));
+		return;
+	}
+	for (size_t k=0; k<count; ++k) out[k] = ci::ColorA(0.0, 0.0, 0.0, static_cast<float>(unit[k]));
+}
+
 void ColorArray::readXml(const ci::XmlTree& xml)
 {
 	mColor.clear();
@@ -19,6 +19,8 @@ public:
 	ColorArray();
 
 	ci::ColorA				at(const Input&, const double unit) const;
+	// at() for count units.
+	void					at(const Input&, const double* unit, ci::ColorA* out, const size_t count) const;
 
 	virtual void			readXml(const ci::XmlTree&);
 
@@ -14,22 +14,15 @@ namespace arc {
 
 namespace {
 const std::string			RESOURCE_("resource:");
-
-std::unique_ptr<Arc>		load_xml(const std::string& xmlstr) {
-	try {
-		ci::XmlTree					xml(xmlstr);
-		for (auto it=xml.begin(), end=xml.end(); it != end; ++it) {
-			std::unique_ptr<Arc>	ans(create(*it));
-			if (ans) return ans;
-		}
-	} catch (std::exception const&) {
-	}
-	return nullptr;
 }
 
+std::unique_ptr<Arc>		load(const std::string& filename) {
+	const std::string		xml(loadXml(filename));
+	if (xml.empty()) return nullptr;
+	return parse(xml);
 }
 
-std::unique_ptr<Arc>		load(const std::string& filename) {
+std::string					loadXml(const std::string& filename) {
 	// Determine if this is a resource
 	if (filename.compare(0, RESOURCE_.length(), RESOURCE_) == 0) {
 		ci::DataSourceRef		ds;
@@ -40,11 +33,22 @@ std::unique_ptr<Arc>		load(const std::string& filename) {
 		if (ds) {
 			ci::Buffer&			buf = ds->getBuffer();
 			if (buf.getDataSize() > 0 && buf.getDataSize() < 100000) {
-				std::string	str(static_cast<const char*>(buf.getData()), buf.getDataSize());
-				return load_xml(str);
+				return std::string(static_cast<const char*>(buf.getData()), buf.getDataSize());
 			}
 		}
 	}
+	return std::string();
+}
+
+std::unique_ptr<Arc>		parse(const std::string& xmlstr) {
+	try {
+		ci::XmlTree					xml(xmlstr);
+		for (auto it=xml.begin(), end=xml.end(); it != end; ++it) {
+			std::unique_ptr<Arc>	ans(create(*it));
+			if (ans) return ans;
+		}
+	} catch (std::exception const&) {
+	}
 	return nullptr;
 }
 
@@ -12,6 +12,14 @@ namespace arc {
  * \brief Load an arc from the file name.
  */
 std::unique_ptr<Arc>		load(const std::string& filename);
+/**
+ * \brief Answer the XML text of the arc at filename, or an empty string.
+ */
+std::string					loadXml(const std::string& filename);
+/**
+ * \brief Create an arc from XML text.
+ */
+std::unique_ptr<Arc>		parse(const std::string& xml);
 
 /**
  * \brief Create a new arc from the classname
@@ -1,5 +1,6 @@
 #include "ds/arc/arc_layer.h"
 
+#include <vector>
 #include <Poco/String.h>
 #include "ds/arc/arc_io.h"
 #include "ds/arc/arc_render_circle.h"
@@ -8,11 +9,23 @@
 namespace ds {
 namespace arc {
 
+namespace {
+void			composite_srcover(ci::ColorA& dst, const ci::ColorA& src)
+{
+	const float		amt = (1-src.a);
+	dst.r = src.r + (amt * dst.r);
+	dst.g = src.g + (amt * dst.g);
+	dst.b = src.b + (amt * dst.b);
+	dst.a = src.a + (amt * dst.a);
+}
+}
+
 /**
  * ds::arc::Layer
  */
 Layer::Layer()
 	: mScaleMode(SCALE_MULTIPLY)
+	, mInputMode(INPUT_DIST)
 	, mScale(1.0)
 {
 	setInput(INPUT_DIST);
@@ -53,6 +66,53 @@ void Layer::renderCircle(const Input& ip, RenderCircleParams& p) const
 	}
 }
 
+void Layer::renderCircleRow(const Input& ip, RenderCircleParams& p, ci::ColorA* out, const size_t count) const
+{
+	const double	y = p.mY;
+	if (count < 1 || y < 0 || y >= p.mH) return;
+	ci::Vec2d		offset = mOffset.getValue(ip);
+	const double	cenx = p.mCenX + offset.x,
+					ceny = p.mCenY + offset.y;
+	const double	max_dist = mScaleFn(p, offset);
+
+	// Gather the pixels inside the circle, so the arc and colours only run on those.
+	std::vector<size_t>		index;
+	std::vector<double>		dist, input;
+	index.reserve(count);
+	dist.reserve(count);
+	input.reserve(count);
+	for (size_t k=0; k<count; ++k) {
+		const double	x = p.mX + static_cast<double>(k);
+		if (x < 0 || x >= p.mW) continue;
+		const double	d = ds::math::dist(cenx, ceny, x, y);
+		if (d >= max_dist) continue;
+		index.push_back(k);
+		dist.push_back(d);
+		if (mInputMode == INPUT_DEGREE) {
+			input.push_back(ds::math::clamp(ds::math::degree(x - cenx, ceny - y) / 360.0, 0.0, 1.0));
+		} else {
+			input.push_back(1.0 - ds::math::clamp(d / max_dist, 0.0, 1.0));
+		}
+	}
+	const size_t	inside = index.size();
+	if (inside < 1) return;
+
+	if (mArc) mArc->runArray(ip, &input[0], inside);
+	std::vector<ci::ColorA>	clr(inside);
+	mColor.at(ip, &input[0], &clr[0], inside);
+
+	for (size_t k=0; k<inside; ++k) {
+		ci::ColorA&		c = clr[k];
+		if (c.a > 0.0f) {
+			// antialias
+			if (dist[k] > (max_dist - 1.0)) {
+				c.a *= static_cast<float>(max_dist-dist[k]);
+			}
+			composite_srcover(out[index[k]], c.premultiplied());
+		}
+	}
+}
+
 void Layer::readXml(const ci::XmlTree& xml)
 {
 	mArc.reset();
@@ -112,19 +172,14 @@ void Layer::setScale(const std::string& in_mode, const double amount)
 
 void Layer::setInput(const InputMode mode)
 {
+	mInputMode = mode;
 	if (mode == INPUT_DEGREE) mInputFn = [](const double dist, const double degree)->double{return degree;};
 	else mInputFn = [](const double dist, const double degree)->double{return dist;};
 }
 
 void Layer::setCompositeMode(const CompositeMode mode)
 {
-	mCompositeFn = [](ci::ColorA& dst, const ci::ColorA& src) {
-		const float		amt = (1-src.a);
-		dst.r = src.r + (amt * dst.r);
-		dst.g = src.g + (amt * dst.g);
-		dst.b = src.b + (amt * dst.b);
-		dst.a = src.a + (amt * dst.a);
-	};
+	mCompositeFn = composite_srcover;
 }
 
 } // namespace arc
@@ -19,6 +19,7 @@ public:
 	Layer();
 
 	virtual void			renderCircle(const Input&, RenderCircleParams&) const;
+	virtual void			renderCircleRow(const Input&, RenderCircleParams&, ci::ColorA* out, const size_t count) const;
 
 	virtual void			readXml(const ci::XmlTree&);
 
@@ -34,6 +35,7 @@ private:
 
 	Vec2Param				mOffset;
 	ScaleMode				mScaleMode;
+	InputMode				mInputMode;
 	double					mScale;
 	std::unique_ptr<Arc>	mArc;
 	ColorArray				mColor;
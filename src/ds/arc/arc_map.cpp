@@ -10,6 +10,19 @@ void		read_float_param(const ci::XmlTree& xml, FloatParam& fp) {
 	fp.mValue = xml.getAttributeValue<double>("value", fp.mValue);
 }
 
+inline double	map_value(	const double v, const double from_min, const double from_max,
+							const double to_min, const double to_max) {
+	double			ans = v;
+	// Clip to from range
+	if (ans < from_min) ans = from_min;
+	else if (ans > from_max) ans = from_max;
+	// Convert to a unit value in the from range
+	ans = (ans-from_min) / (from_max-from_min);
+	// Convert to to range
+	ans = to_min + (ans * (to_max-to_min));
+	return ans;
+}
+
 }
 
 /**
@@ -23,19 +36,15 @@ Map::Map()
 }
 
 double Map::run(const Input& input, const double v) const {
-	double			ans = v;
+	return map_value(v, mFromMin.getValue(input), mFromMax.getValue(input), mToMin.getValue(input), mToMax.getValue(input));
+}
+
+void Map::runArray(const Input& input, double* values, const size_t count) const {
 	const double	from_min = mFromMin.getValue(input),
 					from_max = mFromMax.getValue(input),
 					to_min = mToMin.getValue(input),
 					to_max = mToMax.getValue(input);
-	// Clip to from range
-	if (ans < from_min) ans = from_min;
-	else if (ans > from_max) ans = from_max;
-	// Convert to a unit value in the from range
-	ans = (ans-from_min) / (from_max-from_min);
-	// Convert to to range
-	ans = to_min + (ans * (to_max-to_min));
-	return ans;
+	for (size_t k=0; k<count; ++k) values[k] = map_value(values[k], from_min, from_max, to_min, to_max);
 }
 
 void Map::readXml(const ci::XmlTree& xml) {
@@ -21,6 +21,7 @@ public:
 	Map();
 
 	virtual double		run(const Input&, const double) const;
+	virtual void		runArray(const Input&, double* values, const size_t count) const;
 
 	virtual void		readXml(const ci::XmlTree&);
 
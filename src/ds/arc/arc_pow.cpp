@@ -14,6 +14,13 @@ double Pow::run(const Input& input, const double v) const {
 	return pow(v, mExp.getValue(input));
 }
 
+void Pow::runArray(const Input& input, double* values, const size_t count) const {
+	const double	exp = mExp.getValue(input);
+	// The default exponent leaves every value as it is.
+	if (exp == 1.0) return;
+	for (size_t k=0; k<count; ++k) values[k] = pow(values[k], exp);
+}
+
 void Pow::readXml(const ci::XmlTree& xml) {
 	mExp = FloatParam(1.0);
 
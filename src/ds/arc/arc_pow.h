@@ -19,6 +19,7 @@ public:
 	Pow();
 
 	virtual double		run(const Input&, const double) const;
+	virtual void		runArray(const Input&, double* values, const size_t count) const;
 
 	virtual void		readXml(const ci::XmlTree&);
 
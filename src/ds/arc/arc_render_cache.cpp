@@ -0,0 +1,79 @@
+#include "ds/arc/arc_render_cache.h"
+
+#include <sstream>
+#include "ds/arc/arc_input.h"
+#include "ds/data/data_buffer.h"
+
+namespace ds {
+namespace arc {
+
+namespace {
+// 64-bit FNV-1a
+uint64_t					hash_text(const std::string& text) {
+	uint64_t				h = 14695981039346656037ULL;
+	for (auto it=text.begin(), end=text.end(); it!=end; ++it) {
+		h ^= static_cast<uint8_t>(*it);
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+}
+
+/**
+ * ds::arc::RenderCache
+ */
+RenderCache::RenderCache(const size_t max_bytes)
+		: mMaxBytes(max_bytes) {
+}
+
+void RenderCache::setMaxBytes(const size_t bytes) {
+	Poco::FastMutex::ScopedLock		l(mMutex);
+	mMaxBytes = bytes;
+	trimLocked();
+}
+
+std::string RenderCache::makeKey(const std::string& xml, const Input& input, const int w, const int h) {
+	// The inputs are compared exactly, in their wire format.
+	DataBuffer						buf;
+	input.writeTo(buf);
+	std::stringstream				key;
+	key << std::hex << hash_text(xml) << std::dec << ":" << xml.size() << ":" << w << "x" << h << ":";
+	key.write(buf.data(), buf.size());
+	return key.str();
+}
+
+bool RenderCache::find(const std::string& key, ci::Surface8u& out) {
+	Poco::FastMutex::ScopedLock		l(mMutex);
+	auto							found = mSurfaces.find(key);
+	if (found == mSurfaces.end()) return false;
+	// Make it the most recently used
+	mLru.setPinned(key, true);
+	mLru.setPinned(key, false);
+	out = found->second;
+	return true;
+}
+
+void RenderCache::add(const std::string& key, const ci::Surface8u& s) {
+	if (!s) return;
+	Poco::FastMutex::ScopedLock		l(mMutex);
+	const size_t					bytes = static_cast<size_t>(s.getRowBytes()) * s.getHeight();
+	if (bytes > mMaxBytes) return;
+	mSurfaces[key] = s;
+	mLru.add(key, bytes, false);
+	trimLocked();
+}
+
+void RenderCache::clear() {
+	Poco::FastMutex::ScopedLock		l(mMutex);
+	mSurfaces.clear();
+	mLru.clear();
+}
+
+void RenderCache::trimLocked() {
+	mLru.setBudget(mMaxBytes > 0 ? mMaxBytes : 1);
+	std::string						key;
+	while (mLru.popEviction(key)) mSurfaces.erase(key);
+}
+
+} // namespace arc
+} // namespace ds
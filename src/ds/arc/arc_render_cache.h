@@ -0,0 +1,54 @@
+#pragma once
+#ifndef DS_ARC_ARCRENDERCACHE_H_
+#define DS_ARC_ARCRENDERCACHE_H_
+
+#include <string>
+#include <unordered_map>
+#include <Poco/Mutex.h>
+#include <cinder/Surface.h>
+#include "ds/ui/service/image_cache.h"
+
+namespace ds {
+namespace arc {
+class Input;
+
+/**
+ * \class ds::arc::RenderCache
+ * \brief Remember rendered arc surfaces, so the same arc with the same
+ * inputs at the same size is only ever rendered once. Surfaces are
+ * dropped least recently used first to stay under a byte budget.
+ * Answered surfaces are shared with the cache, so don't modify them.
+ * Safe to use from any thread.
+ */
+class RenderCache {
+public:
+	// A budget of 0 caches nothing.
+	RenderCache(const size_t max_bytes = 0);
+
+	void						setMaxBytes(const size_t);
+
+	// xml is the text of the arc.
+	static std::string			makeKey(const std::string& xml, const Input&, const int w, const int h);
+
+	bool						find(const std::string& key, ci::Surface8u&);
+	void						add(const std::string& key, const ci::Surface8u&);
+	void						clear();
+
+private:
+	RenderCache(const RenderCache&);
+	RenderCache&				operator=(const RenderCache&);
+
+	void						trimLocked();
+
+	Poco::FastMutex				mMutex;
+	size_t						mMaxBytes;
+	std::unordered_map<std::string, ci::Surface8u>
+								mSurfaces;
+	ds::ui::ImageCache<std::string>
+								mLru;
+};
+
+} // namespace arc
+} // namespace ds
+
+#endif // DS_ARC_ARCRENDERCACHE_H_
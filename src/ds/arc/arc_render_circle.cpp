@@ -1,6 +1,9 @@
 #include "ds/arc/arc_render_circle.h"
 
+#include <algorithm>
+#include <vector>
 #include "ds/math/math_func.h"
+#include "ds/ui/ip/ip_tile_runner.h"
 
 namespace ds {
 namespace arc {
@@ -34,16 +37,67 @@ static inline uint8_t to_color(const float inv)
 	return static_cast<uint8_t>(inv*255.0f);
 }
 
-bool RenderCircle::on(const Input& input, ci::Surface8u& s, ds::arc::Arc& a)
+static void init_params(const ci::Surface8u& s, RenderCircleParams& params)
 {
-	s.setPremultiplied(false);
-
-	RenderCircleParams	params;
 	params.mW = s.getWidth();
 	params.mH = s.getHeight();
 	params.mCenX = (s.getWidth()-1)/2.0;
 	params.mCenY = (s.getHeight()-1)/2.0;
 	params.mMaxDist = ds::math::dist(params.mCenX, params.mCenY, params.mCenX, 0.0);
+}
+
+bool RenderCircle::on(const Input& input, ci::Surface8u& s, ds::arc::Arc& a, ds::ui::ip::TileRunner* runner)
+{
+	if (!s) return false;
+	s.setPremultiplied(false);
+
+	const int32_t		w = s.getWidth();
+	const int32_t		row_bytes = s.getRowBytes();
+	const int32_t		inc = s.getPixelInc();
+	const int32_t		r = s.getChannelOrder().getRedOffset(),
+						g = s.getChannelOrder().getGreenOffset(),
+						b = s.getChannelOrder().getBlueOffset(),
+						alpha = s.getChannelOrder().getAlphaOffset();
+	const bool			has_alpha = s.hasAlpha();
+	uint8_t*			data = s.getData();
+	const ds::arc::Arc&	arc = a;
+	RenderCircleParams	base;
+	init_params(s, base);
+
+	auto				render = [=, &input, &arc](const int32_t y0, const int32_t y1) {
+		RenderCircleParams			params(base);
+		std::vector<ci::ColorA>		row(w);
+		for (int32_t y=y0; y<y1; ++y) {
+			std::fill(row.begin(), row.end(), ci::ColorA(0.0f, 0.0f, 0.0f, 0.0f));
+			params.mX = 0.0;
+			params.mY = static_cast<double>(y);
+			arc.renderCircleRow(input, params, &row[0], row.size());
+
+			uint8_t*				pix = data + y * row_bytes;
+			for (int32_t x=0; x<w; ++x, pix+=inc) {
+				const ci::ColorA&	c = row[x];
+				pix[r] = to_color(un_premult(c.r, c.a));
+				pix[g] = to_color(un_premult(c.g, c.a));
+				pix[b] = to_color(un_premult(c.b, c.a));
+				if (has_alpha) pix[alpha] = to_color(c.a);
+			}
+		}
+	};
+
+	if (runner) {
+		runner->run(s.getHeight(), render, 16);
+	} else {
+		render(0, s.getHeight());
+	}
+	return true;
+}
+
+bool RenderCircle::onPixels(const Input& input, ci::Surface8u& s, ds::arc::Arc& a)
+{
+	s.setPremultiplied(false);
+
+	RenderCircleParams	params;
+	init_params(s, params);
 
 	auto			pix = s.getIter();
 	params.mY = 0.0;
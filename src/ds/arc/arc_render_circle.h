@@ -8,6 +8,12 @@
 #include "ds/arc/arc.h"
 
 namespace ds {
+namespace ui {
+namespace ip {
+class TileRunner;
+}
+}
+
 namespace arc {
 
 class RenderCircleParams {
@@ -28,14 +34,17 @@ public:
 
 /**
  * \class ds::arc::RenderCircle
- * \brief Given an arc, generate a circular image.
+ * \brief Given an arc, generate a circular image. The arc is run a row at
+ * a time; supply a runner to render the rows on several threads.
  */
 class RenderCircle
 {
 public:
 	RenderCircle();
 
-	bool				on(const Input&, ci::Surface8u&, ds::arc::Arc&);
+	bool				on(const Input&, ci::Surface8u&, ds::arc::Arc&, ds::ui::ip::TileRunner* = nullptr);
+	// The original pixel at a time render, for comparison.
+	bool				onPixels(const Input&, ci::Surface8u&, ds::arc::Arc&);
 };
 
 } // namespace arc
@@ -0,0 +1,168 @@
+#include "ds/data/compact_floats.h"
+
+#include <cmath>
+#include <cstring>
+#include "ds/data/data_buffer.h"
+
+namespace ds {
+
+namespace {
+const char			DELTA_BIT = (char)0x80;
+const char			MODE_MASK = 0x7f;
+const double		FIXED_SCALE = 16.0;
+const double		FIXED_LIMIT = 1073741823.0;
+
+uint32_t			float_bits(const float f) {
+	uint32_t		ans;
+	memcpy(&ans, &f, sizeof(ans));
+	return ans;
+}
+
+float				bits_float(const uint32_t b) {
+	float			ans;
+	memcpy(&ans, &b, sizeof(ans));
+	return ans;
+}
+
+int32_t				to_fixed(const float f) {
+	double			v = floor(static_cast<double>(f) * FIXED_SCALE + 0.5);
+	if (v != v) return 0;
+	if (v > FIXED_LIMIT) v = FIXED_LIMIT;
+	else if (v < -FIXED_LIMIT) v = -FIXED_LIMIT;
+	return static_cast<int32_t>(v);
+}
+
+float				from_fixed(const int32_t v) {
+	return static_cast<float>(static_cast<double>(v) / FIXED_SCALE);
+}
+
+int					varint_size(uint32_t v) {
+	int				ans = 1;
+	while (v >= 0x80) {
+		v >>= 7;
+		++ans;
+	}
+	return ans;
+}
+}
+
+void add_compact_floats(ds::DataBuffer& buf, const float* values, float* ref, const int count,
+						const CompactFloatMode mode, bool delta) {
+	// Full floats that changed in their high bits are cheaper sent raw.
+	if (delta && mode == COMPACT_FLOAT) {
+		int					size = 0;
+		for (int k=0; k<count; ++k) size += varint_size(float_bits(values[k]) ^ float_bits(ref[k]));
+		if (size >= count * static_cast<int>(sizeof(float))) delta = false;
+	}
+	buf.add(static_cast<char>(mode | (delta ? DELTA_BIT : 0)));
+	for (int k=0; k<count; ++k) {
+		const float			v = values[k];
+		float				decoded = v;
+		if (mode == COMPACT_HALF) {
+			const uint16_t	h = float_to_half(v);
+			if (delta) buf.addVarint(h ^ float_to_half(ref[k]));
+			else buf.add(h);
+			decoded = half_to_float(h);
+		} else if (mode == COMPACT_FIXED) {
+			const int32_t	q = to_fixed(v);
+			if (delta) buf.addZigzag(q - to_fixed(ref[k]));
+			else buf.addZigzag(q);
+			decoded = from_fixed(q);
+		} else {
+			if (delta) buf.addVarint(float_bits(v) ^ float_bits(ref[k]));
+			else buf.add(v);
+		}
+		ref[k] = decoded;
+	}
+}
+
+bool read_compact_floats(ds::DataBuffer& buf, float* values, float* ref, const int count) {
+	if (!buf.canRead<char>()) return false;
+	const char				header = buf.read<char>();
+	const char				mode = header&MODE_MASK;
+	const bool				delta = (header&DELTA_BIT) != 0;
+	for (int k=0; k<count; ++k) {
+		float				v;
+		uint32_t			bits;
+		int32_t				q;
+		if (mode == COMPACT_HALF) {
+			if (delta) {
+				if (!buf.readVarint(bits)) return false;
+				v = half_to_float(static_cast<uint16_t>(bits ^ float_to_half(ref[k])));
+			} else {
+				if (!buf.canRead<uint16_t>()) return false;
+				v = half_to_float(buf.read<uint16_t>());
+			}
+		} else if (mode == COMPACT_FIXED) {
+			if (!buf.readZigzag(q)) return false;
+			if (delta) v = from_fixed(q + to_fixed(ref[k]));
+			else v = from_fixed(q);
+		} else if (mode == COMPACT_FLOAT) {
+			if (delta) {
+				if (!buf.readVarint(bits)) return false;
+				v = bits_float(bits ^ float_bits(ref[k]));
+			} else {
+				if (!buf.canRead<float>()) return false;
+				v = buf.read<float>();
+			}
+		} else {
+			return false;
+		}
+		ref[k] = v;
+		values[k] = v;
+	}
+	return true;
+}
+
+uint16_t float_to_half(const float f) {
+	const uint32_t			x = float_bits(f);
+	const uint32_t			sign = (x >> 16) & 0x8000;
+	const uint32_t			raw_exp = (x >> 23) & 0xff;
+	uint32_t				mant = x & 0x7fffff;
+
+	// Inf and NaN
+	if (raw_exp == 0xff) return static_cast<uint16_t>(sign | 0x7c00 | (mant ? 0x200 : 0));
+
+	const int32_t			exp = static_cast<int32_t>(raw_exp) - 127 + 15;
+	// Overflow to infinity
+	if (exp >= 31) return static_cast<uint16_t>(sign | 0x7c00);
+	// Subnormal, or too small and flushed to zero
+	if (exp <= 0) {
+		if (exp < -10) return static_cast<uint16_t>(sign);
+		mant |= 0x800000;
+		const uint32_t		shift = static_cast<uint32_t>(14 - exp);
+		uint32_t			h = mant >> shift;
+		const uint32_t		rem = mant & ((1u << shift) - 1);
+		const uint32_t		halfway = 1u << (shift - 1);
+		if (rem > halfway || (rem == halfway && (h & 1))) ++h;
+		return static_cast<uint16_t>(sign | h);
+	}
+
+	// Rounding can carry into the exponent, which is the correct result.
+	uint32_t				h = (static_cast<uint32_t>(exp) << 10) | (mant >> 13);
+	const uint32_t			rem = mant & 0x1fff;
+	if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) ++h;
+	return static_cast<uint16_t>(sign | h);
+}
+
+float half_to_float(const uint16_t h) {
+	const uint32_t			sign = static_cast<uint32_t>(h & 0x8000) << 16;
+	const uint32_t			exp = (h >> 10) & 0x1f;
+	uint32_t				mant = h & 0x3ff;
+
+	if (exp == 0) {
+		if (mant == 0) return bits_float(sign);
+		// Subnormal, normalize it
+		uint32_t			e = 127 - 15 + 1;
+		while ((mant & 0x400) == 0) {
+			mant <<= 1;
+			--e;
+		}
+		mant &= 0x3ff;
+		return bits_float(sign | (e << 23) | (mant << 13));
+	}
+	if (exp == 31) return bits_float(sign | 0x7f800000 | (mant << 13));
+	return bits_float(sign | ((exp + 112) << 23) | (mant << 13));
+}
+
+} // namespace ds
@@ -0,0 +1,45 @@
+#pragma once
+#ifndef DS_DATA_COMPACTFLOATS_H_
+#define DS_DATA_COMPACTFLOATS_H_
+
+#include <stdint.h>
+
+namespace ds {
+class DataBuffer;
+
+/**
+ * Compact encoding for short runs of floats (positions, colors, etc.)
+ * in the replication stream. Each run starts with a mode byte, so the
+ * reader never needs to know how the writer was configured.
+ *
+ * Every run is written against a reference -- the last values written
+ * for the same attribute. The writer and reader each keep their own copy
+ * of the reference, and both are updated to the decoded values, so they
+ * stay identical as long as the stream is applied in order. A run that
+ * isn't a delta ignores the reference, which is how the two sides resync.
+ */
+enum CompactFloatMode {
+	// Full 32-bit floats. Lossless.
+	COMPACT_FLOAT		= 0,
+	// 16-bit half floats. Good for scale, color, opacity.
+	COMPACT_HALF		= 1,
+	// Fixed point at 1/16th of a unit. Good for positions and sizes in pixels.
+	COMPACT_FIXED		= 2
+};
+
+// Write count values. If delta is true, the values are encoded against
+// ref (float and half XOR the bits, fixed takes the difference). ref is
+// updated to the values the reader will decode.
+void				add_compact_floats(	ds::DataBuffer&, const float* values, float* ref, const int count,
+										const CompactFloatMode, const bool delta);
+// Read count values written by add_compact_floats(). values and ref can be
+// the same array. Answer false if the buffer ran out.
+bool				read_compact_floats(ds::DataBuffer&, float* values, float* ref, const int count);
+
+// IEEE 754 half float conversion, round to nearest.
+uint16_t			float_to_half(const float);
+float				half_to_float(const uint16_t);
+
+} // namespace ds
+
+#endif // DS_DATA_COMPACTFLOATS_H_
@@ -1,5 +1,6 @@
 #include "data_buffer.h"
 #include <string>
+#include "ds/util/utf8.h"
 
 namespace ds {
 
@@ -24,9 +25,91 @@ void DataBuffer::add(const wchar_t *cs)
 template <>
 void DataBuffer::add<std::wstring>( const std::wstring &ws )
 {
-  unsigned size = (ws.size())*sizeof(wchar_t);
-  add(size);
-  mStream.write((const char *)(ws.c_str()), size);
+  const unsigned size = static_cast<unsigned>(ds::utf8::encodedSize(ws.data(), ws.size()));
+  add(size | WSTRING_UTF8_F);
+  if (size < 1)
+    return;
+
+  char *dst = mStream.prepareWrite(size);
+  mStream.commitWrite(static_cast<unsigned>(ds::utf8::encode(ws.data(), ws.size(), dst)));
+}
+
+template <>
+std::wstring DataBuffer::read<std::wstring>()
+{
+  const unsigned header = read<unsigned>();
+  const unsigned size = header & ~WSTRING_UTF8_F;
+  if (size > remaining()) {
+    mStream.setReadPosition(ReadWriteBuffer::End);
+    return std::wstring();
+  }
+
+  // Decode straight out of the stream.
+  const unsigned position = mStream.getReadPosition();
+  const char *src = mStream.data() + position;
+  mStream.setReadPosition(position + size);
+  if ((header & WSTRING_UTF8_F) != 0)
+    return ds::utf8::decode(src, size);
+  return ds::utf8::decodeUtf16(src, size);
+}
+
+void DataBuffer::addVarint(uint32_t v)
+{
+  char bytes[5];
+  unsigned size = 0;
+  while (v >= 0x80) {
+    bytes[size++] = static_cast<char>((v & 0x7f) | 0x80);
+    v >>= 7;
+  }
+  bytes[size++] = static_cast<char>(v);
+  mStream.write(bytes, size);
+}
+
+void DataBuffer::addZigzag(int32_t v)
+{
+  addVarint((static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31));
+}
+
+uint32_t DataBuffer::readVarint()
+{
+  uint32_t ans = 0;
+  if (!readVarint(ans))
+    return 0;
+  return ans;
+}
+
+int32_t DataBuffer::readZigzag()
+{
+  int32_t ans = 0;
+  if (!readZigzag(ans))
+    return 0;
+  return ans;
+}
+
+bool DataBuffer::readVarint(uint32_t &v)
+{
+  uint32_t ans = 0;
+  for (unsigned shift = 0; shift < 35; shift += 7) {
+    unsigned char b;
+    if (!mStream.read((char *)(&b), 1))
+      return false;
+    ans |= static_cast<uint32_t>(b & 0x7f) << shift;
+    if ((b & 0x80) == 0) {
+      v = ans;
+      return true;
+    }
+  }
+  // More than 5 bytes isn't something addVarint() wrote.
+  return false;
+}
+
+bool DataBuffer::readZigzag(int32_t &v)
+{
+  uint32_t u = 0;
+  if (!readVarint(u))
+    return false;
+  v = static_cast<int32_t>((u >> 1) ^ (~(u & 1) + 1));
+  return true;
 }
 
 void DataBuffer::add( const char *b, unsigned size )
@@ -37,22 +120,19 @@ void DataBuffer::add( const char *b, unsigned size )
 
 bool DataBuffer::read( char *b, unsigned size )
 {
+  if (!canRead<unsigned>())
+    return false;
+
   unsigned wsize = read<unsigned>();
   if (wsize != size) {
-    add(wsize);
+    // Put the size back, the caller might try a different read.
+    rewindRead<unsigned>();
     return false;
   }
 
-  unsigned currentPosition = mStream.getReadPosition();
-
-  mStream.setReadPosition(ReadWriteBuffer::End);
-  unsigned length = mStream.getReadPosition();
-  mStream.setReadPosition(currentPosition);
-
-  if (size > (length - currentPosition))
+  if (size > remaining())
     return false;
 
-
   mStream.read(b, size);
   return true;
 }
@@ -69,15 +149,28 @@ void DataBuffer::seekBegin()
   mStream.setWritePosition(ReadWriteBuffer::Begin);
 }
 
-unsigned DataBuffer::size()
+unsigned DataBuffer::getReadPosition() const
 {
-  unsigned currentPosition = mStream.getReadPosition();
+  return mStream.getReadPosition();
+}
 
-  mStream.setReadPosition(ReadWriteBuffer::End);
-  unsigned length = mStream.getReadPosition();
-  mStream.setReadPosition(currentPosition);
+void DataBuffer::setReadPosition(const unsigned position)
+{
+  mStream.setReadPosition(position);
+}
 
-  return length;
+unsigned DataBuffer::size() const
+{
+  return mStream.length();
+}
+
+unsigned DataBuffer::remaining() const
+{
+  const unsigned length = mStream.length();
+  const unsigned currentPosition = mStream.getReadPosition();
+  if (currentPosition >= length)
+    return 0;
+  return length - currentPosition;
 }
 
 void DataBuffer::clear()
@@ -90,15 +183,24 @@ void DataBuffer::addRaw( const char *b, unsigned size )
   mStream.write(b, size);
 }
 
-bool DataBuffer::readRaw( char *b, unsigned size )
+const char *DataBuffer::data() const
+{
+  return mStream.data();
+}
+
+char *DataBuffer::prepareRaw( unsigned size )
 {
-  unsigned currentPosition = mStream.getReadPosition();
+  return mStream.prepareWrite(size);
+}
 
-  mStream.setReadPosition(ReadWriteBuffer::End);
-  unsigned length = mStream.getReadPosition();
-  mStream.setReadPosition(currentPosition);
+void DataBuffer::commitRaw( unsigned size )
+{
+  mStream.commitWrite(size);
+}
 
-  if (size > (length - currentPosition))
+bool DataBuffer::readRaw( char *b, unsigned size )
+{
+  if (size > remaining())
     return false;
 
   mStream.read(b, size);
@@ -1,6 +1,7 @@
 #pragma once
 #ifndef DS_DATA_BUFFER_H
 #define DS_DATA_BUFFER_H
+#include <stdint.h>
 #include <string>
 #include "read_write_buffer.h"
 #include "raw_data_buffer.h"
@@ -14,24 +15,26 @@ namespace ds {
 class DataBuffer
 {
   public:
+    // Wide strings are written as UTF-8, with this bit set in their size.
+    // Without it the size is in bytes of little-endian UTF-16, the format
+    // before, which is still read.
+    static const unsigned WSTRING_UTF8_F = 0x80000000;
+
     DataBuffer(unsigned initialStreamSize = 0);
-    unsigned size();
+    // Answer the total bytes written.
+    unsigned size() const;
+    // Answer the bytes between the read position and the end.
+    unsigned remaining() const;
     void seekBegin();
     void clear();
+    // Save and restore the read position, i.e. to peek ahead.
+    unsigned getReadPosition() const;
+    void setReadPosition(const unsigned position);
 
     template <typename T>
-    bool canRead()
+    bool canRead() const
     {
-      unsigned size = sizeof(T);
-      unsigned currentPosition = mStream.getReadPosition();
-
-      mStream.setReadPosition(ReadWriteBuffer::End);
-      unsigned length = mStream.getReadPosition();
-      mStream.setReadPosition(currentPosition);
-
-      if (size > (length - currentPosition))
-        return false;
-      return true;
+      return sizeof(T) <= remaining();
     }
 
     // function to add raw data no size added.
@@ -39,6 +42,14 @@ class DataBuffer
     // function to read raw data no size will be read.
     bool readRaw(char *b, unsigned size);
 
+    // Direct access to everything written, i.e. to compress or send the
+    // buffer without copying it out first. Only valid until the next add.
+    const char *data() const;
+    // Answer space for size raw bytes at the end of the buffer, i.e. to
+    // decompress straight into it, then commit the bytes actually used.
+    char *prepareRaw(unsigned size);
+    void commitRaw(unsigned size);
+
     // will write size when writing data.
     void add(const char *b, unsigned size);
     template <typename T>
@@ -54,12 +65,19 @@ class DataBuffer
     void add(const char *cs);
     void add(const wchar_t *cs);
 
+    // Variable-length unsigned int, 7 bits per byte, low bits first.
+    // Small values (IDs, counts, deltas) take a single byte.
+    void addVarint(uint32_t v);
+    // Signed values are zigzag encoded so small negatives stay small.
+    void addZigzag(int32_t v);
+
     // will read size from buffer and only read if size is available.
     bool read(char *b, unsigned size);
+    // Answer a default-constructed value if the buffer runs out.
     template <typename T>
     T read()
     {
-      T t;
+      T t = T();
       mStream.read((char *)(&t), sizeof(t));
       return t;
     }
@@ -69,6 +87,13 @@ class DataBuffer
     template <>
     std::wstring read<std::wstring>();
 
+    // Answer 0 if the buffer runs out before the value is complete.
+    uint32_t readVarint();
+    int32_t readZigzag();
+    // Answer false if the buffer runs out before the value is complete.
+    bool readVarint(uint32_t &v);
+    bool readZigzag(int32_t &v);
+
     template <typename T>
     void rewindRead()
     {
@@ -93,21 +118,16 @@ class DataBuffer
   private:
     ReadWriteBuffer mStream;
     RawDataBuffer   mStringBuffer;
-    RawDataBuffer   mWStringBuffer;
 };
 
+// On underflow the rest of the buffer is consumed, so
+// callers looping on canRead() stop.
 template <>
 std::string DataBuffer::read<std::string>()
 {
   unsigned size = read<unsigned>();
-  unsigned currentPosition = mStream.getReadPosition();
-
-  mStream.setReadPosition(ReadWriteBuffer::End);
-  unsigned length = mStream.getReadPosition();
-  mStream.setReadPosition(currentPosition);
-
-  if (size > (length - currentPosition)) {
-    add(size);
+  if (size > remaining()) {
+    mStream.setReadPosition(ReadWriteBuffer::End);
     return std::string();
   }
 
@@ -117,27 +137,6 @@ std::string DataBuffer::read<std::string>()
   return std::string(mStringBuffer.data(), size);
 }
 
-template <>
-std::wstring DataBuffer::read<std::wstring>()
-{
-  unsigned size = read<unsigned>();
-  unsigned currentPosition = mStream.getReadPosition();
-
-  mStream.setReadPosition(ReadWriteBuffer::End);
-  unsigned length = mStream.getReadPosition();
-  mStream.setReadPosition(currentPosition);
-
-  if (size > (length - currentPosition)) {
-    add(size);
-    return std::wstring();
-  }
-
-  mWStringBuffer.setSize(size);
-
-  mStream.read((char *)mWStringBuffer.data(), size);
-  return std::wstring((const wchar_t *)mWStringBuffer.data(), size/2);
-}
-
 }
 
 #endif//DS_DATA_BUFFER_H
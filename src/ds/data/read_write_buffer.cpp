@@ -69,6 +69,34 @@ unsigned ReadWriteBuffer::size()
   return mSize;
 }
 
+const char *ReadWriteBuffer::data() const
+{
+  return mBuffer;
+}
+
+unsigned ReadWriteBuffer::length() const
+{
+  return mMaxBufferWritePosition;
+}
+
+char *ReadWriteBuffer::prepareWrite( unsigned size )
+{
+  if (mBufferWritePosition+size > mSize)
+    grow(math::getNextPowerOf2(mBufferWritePosition+size));
+
+  return mBuffer + mBufferWritePosition;
+}
+
+void ReadWriteBuffer::commitWrite( unsigned size )
+{
+  if (mBufferWritePosition+size > mSize)
+    size = mSize - mBufferWritePosition;
+
+  mBufferWritePosition += size;
+  if (mBufferWritePosition > mMaxBufferWritePosition)
+    mMaxBufferWritePosition = mBufferWritePosition;
+}
+
 unsigned ReadWriteBuffer::getReadPosition() const
 {
   return mBufferReadPosition;
@@ -78,6 +106,7 @@ void ReadWriteBuffer::setReadPosition( const unsigned &position )
 {
   if (position > mMaxBufferWritePosition) {
     mBufferReadPosition = mMaxBufferWritePosition;
+    return;
   }
 
   mBufferReadPosition = position;
@@ -100,6 +129,7 @@ void ReadWriteBuffer::setWritePosition( const unsigned &position )
 {
   if (position > mMaxBufferWritePosition) {
     mBufferWritePosition = mMaxBufferWritePosition;
+    return;
   }
 
   mBufferWritePosition = position;
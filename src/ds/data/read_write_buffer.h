@@ -25,6 +25,17 @@ class ReadWriteBuffer
     void clear();
     unsigned size();
 
+    // Contiguous access to everything written so far, independent of the
+    // read position. Only valid until the next write.
+    const char *data() const;
+    // Answer the number of bytes written.
+    unsigned length() const;
+    // Answer a pointer to at least size writable bytes at the write position,
+    // so callers can fill the buffer directly. Follow with commitWrite() for
+    // the number of bytes actually used.
+    char *prepareWrite(unsigned size);
+    void commitWrite(unsigned size);
+
     unsigned getReadPosition() const;
     void setReadPosition(const unsigned &position);
     void setReadPosition(const Postions &position);
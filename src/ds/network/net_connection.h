@@ -22,6 +22,9 @@ class NetConnection
     virtual bool sendMessage(const char *data, int size) = 0;
 
     virtual int recvMessage(std::string &msg) = 0;
+    // Receive a single message straight into a caller-owned buffer. Answer
+    // the size of the message, 0 if there wasn't one, or -1 if it didn't fit.
+    virtual int recvMessage(char *buffer, int size) = 0;
 
     virtual bool isServer() const = 0;
 
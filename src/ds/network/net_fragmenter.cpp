@@ -0,0 +1,239 @@
+#include "ds/network/net_fragmenter.h"
+
+#include <cstring>
+#include <Poco/Random.h>
+#include "ds/debug/logger.h"
+#include "ds/network/net_connection.h"
+
+const int				ds::NET_FRAGMENT_PAYLOAD_SIZE = 1400;
+const int				ds::NET_FRAGMENT_HEADER_SIZE = 21;
+
+namespace ds {
+
+namespace {
+const unsigned char		FRAGMENT_MAGIC = 0xD5;
+// The largest frame I will try to reassemble. Anything bigger is
+// assumed to be garbage.
+const uint32_t			MAX_FRAME_SIZE = 256*1024*1024;
+
+uint32_t				make_source_id() {
+	Poco::Random		r;
+	r.seed();
+	uint32_t			ans = r.next();
+	if (ans == 0) ans = 1;
+	return ans;
+}
+
+// Frame IDs wrap, so compare based on the signed distance.
+bool					is_older(const uint32_t a, const uint32_t b) {
+	return static_cast<int32_t>(a - b) < 0;
+}
+
+template <typename T>
+void					write_at(char* dst, const T& v) {
+	memcpy(dst, &v, sizeof(T));
+}
+
+template <typename T>
+T						read_at(const char* src) {
+	T					v;
+	memcpy(&v, src, sizeof(T));
+	return v;
+}
+
+// Header layout
+const int				MAGIC_OFFSET = 0;
+const int				SOURCE_OFFSET = 1;
+const int				FRAME_OFFSET = 5;
+const int				INDEX_OFFSET = 9;
+const int				COUNT_OFFSET = 11;
+const int				BYTE_OFFSET = 13;
+const int				TOTAL_OFFSET = 17;
+}
+
+/**
+ * \class ds::NetFragmenter
+ */
+NetFragmenter::NetFragmenter(const int payloadSize)
+		: mPayloadSize(payloadSize > 0 ? payloadSize : NET_FRAGMENT_PAYLOAD_SIZE)
+		, mSourceId(make_source_id())
+		, mFrameId(0) {
+	mPacket.resize(NET_FRAGMENT_HEADER_SIZE + mPayloadSize);
+}
+
+uint32_t NetFragmenter::getSourceId() const {
+	return mSourceId;
+}
+
+uint32_t NetFragmenter::getFrameId() const {
+	return mFrameId;
+}
+
+bool NetFragmenter::send(ds::NetConnection& con, const char* data, const int size) {
+	if (!data || size < 1) return false;
+
+	const int				count = (size + mPayloadSize - 1) / mPayloadSize;
+	if (count > 0xffff) {
+		DS_LOG_ERROR("NetFragmenter::send() frame of " << size << " bytes needs too many fragments");
+		return false;
+	}
+
+	const uint32_t			frame = mFrameId++;
+	char*					packet = &mPacket.front();
+	packet[MAGIC_OFFSET] = static_cast<char>(FRAGMENT_MAGIC);
+	write_at(packet + SOURCE_OFFSET, mSourceId);
+	write_at(packet + FRAME_OFFSET, frame);
+	write_at(packet + COUNT_OFFSET, static_cast<uint16_t>(count));
+	write_at(packet + TOTAL_OFFSET, static_cast<uint32_t>(size));
+
+	bool					ans = true;
+	for (int k=0; k<count; ++k) {
+		const int			offset = k * mPayloadSize;
+		const int			len = (size - offset < mPayloadSize ? size - offset : mPayloadSize);
+		write_at(packet + INDEX_OFFSET, static_cast<uint16_t>(k));
+		write_at(packet + BYTE_OFFSET, static_cast<uint32_t>(offset));
+		memcpy(packet + NET_FRAGMENT_HEADER_SIZE, data + offset, len);
+		if (!con.sendMessage(packet, NET_FRAGMENT_HEADER_SIZE + len)) ans = false;
+	}
+	return ans;
+}
+
+/**
+ * \class ds::NetReassembler
+ */
+NetReassembler::NetReassembler(const int maxPendingFrames)
+		: mMaxPendingFrames(maxPendingFrames > 0 ? maxPendingFrames : 1)
+		, mFrameData(nullptr)
+		, mFrameSize(0)
+		, mDiscardedCount(0) {
+	mPending.reserve(mMaxPendingFrames);
+}
+
+bool NetReassembler::add(const char* datagram, const int size) {
+	if (!datagram || size <= NET_FRAGMENT_HEADER_SIZE) return false;
+	if (static_cast<unsigned char>(datagram[MAGIC_OFFSET]) != FRAGMENT_MAGIC) return false;
+
+	const uint32_t			source_id = read_at<uint32_t>(datagram + SOURCE_OFFSET);
+	const uint32_t			frame_id = read_at<uint32_t>(datagram + FRAME_OFFSET);
+	const uint16_t			index = read_at<uint16_t>(datagram + INDEX_OFFSET);
+	const uint16_t			count = read_at<uint16_t>(datagram + COUNT_OFFSET);
+	const uint32_t			offset = read_at<uint32_t>(datagram + BYTE_OFFSET);
+	const uint32_t			total = read_at<uint32_t>(datagram + TOTAL_OFFSET);
+	const uint32_t			len = static_cast<uint32_t>(size - NET_FRAGMENT_HEADER_SIZE);
+	if (count < 1 || index >= count || total > MAX_FRAME_SIZE || offset > total || len > total - offset) return false;
+
+	// Anything at or before the last completed frame is stale.
+	Source&					source = findSource(source_id);
+	if (source.mHasLastFrame && !is_older(source.mLastFrameId, frame_id)) return false;
+
+	// Most frames fit in one datagram, so skip the reassembly copy.
+	if (count == 1) {
+		if (offset != 0 || len != total) return false;
+		mFrameData = datagram + NET_FRAGMENT_HEADER_SIZE;
+		mFrameSize = static_cast<int>(len);
+		source.mLastFrameId = frame_id;
+		source.mHasLastFrame = true;
+		discardOlder(source_id, frame_id);
+		return true;
+	}
+
+	Pending*				p = nullptr;
+	for (auto it=mPending.begin(), end=mPending.end(); it!=end; ++it) {
+		if (it->mSourceId == source_id && it->mFrameId == frame_id) {
+			p = &(*it);
+			break;
+		}
+	}
+	if (!p) {
+		if (static_cast<int>(mPending.size()) >= mMaxPendingFrames) {
+			mPending.erase(mPending.begin());
+			++mDiscardedCount;
+		}
+		mPending.push_back(Pending());
+		p = &mPending.back();
+		p->mSourceId = source_id;
+		p->mFrameId = frame_id;
+		p->mFragmentCount = count;
+		p->mReceived.assign(count, false);
+		p->mData.resize(total);
+	} else if (p->mFragmentCount != count || p->mData.size() != total) {
+		// Conflicting header, can't trust this fragment
+		return false;
+	}
+
+	if (p->mReceived[index]) return false;
+	p->mReceived[index] = true;
+	++p->mReceivedCount;
+	if (len > 0) memcpy(&p->mData[offset], datagram + NET_FRAGMENT_HEADER_SIZE, len);
+	if (p->mReceivedCount < p->mFragmentCount) return false;
+
+	// Complete
+	mFrame.swap(p->mData);
+	mFrameData = mFrame.data();
+	mFrameSize = static_cast<int>(mFrame.size());
+	source.mLastFrameId = frame_id;
+	source.mHasLastFrame = true;
+	discardOlder(source_id, frame_id);
+	return true;
+}
+
+const char* NetReassembler::getFrameData() const {
+	return mFrameData;
+}
+
+int NetReassembler::getFrameSize() const {
+	return mFrameSize;
+}
+
+void NetReassembler::clear() {
+	mPending.clear();
+	mSources.clear();
+	mFrame.clear();
+	mFrameData = nullptr;
+	mFrameSize = 0;
+}
+
+int NetReassembler::getDiscardedCount() const {
+	return mDiscardedCount;
+}
+
+NetReassembler::Source& NetReassembler::findSource(const uint32_t id) {
+	for (auto it=mSources.begin(), end=mSources.end(); it!=end; ++it) {
+		if (it->mId == id) return *it;
+	}
+	mSources.push_back(Source(id));
+	return mSources.back();
+}
+
+void NetReassembler::discardOlder(const uint32_t source, const uint32_t frame) {
+	for (auto it=mPending.begin(); it!=mPending.end(); ) {
+		if (it->mSourceId == source && !is_older(frame, it->mFrameId)) {
+			// The completed frame itself is also removed here.
+			if (it->mFrameId != frame) ++mDiscardedCount;
+			it = mPending.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+/**
+ * \class ds::NetReassembler::Pending
+ */
+NetReassembler::Pending::Pending()
+		: mSourceId(0)
+		, mFrameId(0)
+		, mFragmentCount(0)
+		, mReceivedCount(0) {
+}
+
+/**
+ * \class ds::NetReassembler::Source
+ */
+NetReassembler::Source::Source(const uint32_t id)
+		: mId(id)
+		, mLastFrameId(0)
+		, mHasLastFrame(false) {
+}
+
+} // namespace ds
@@ -0,0 +1,107 @@
+#pragma once
+#ifndef DS_NETWORK_NETFRAGMENTER_H_
+#define DS_NETWORK_NETFRAGMENTER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ds {
+class NetConnection;
+
+// Default payload for a single fragment. Small enough that the
+// fragment plus all IP/UDP headers fits in a standard 1500 byte MTU.
+extern const int				NET_FRAGMENT_PAYLOAD_SIZE;
+// Size of the header prepended to every fragment.
+extern const int				NET_FRAGMENT_HEADER_SIZE;
+
+/**
+ * \class ds::NetFragmenter
+ * \brief Split a single frame of data into MTU-sized, sequenced
+ * fragments and send each one as its own datagram. Every fragment
+ * carries the sender's source ID, the frame ID, its index and the
+ * total frame size, so the receiver can reassemble out-of-order
+ * fragments and throw away frames that never completed.
+ */
+class NetFragmenter {
+public:
+	NetFragmenter(const int payloadSize = NET_FRAGMENT_PAYLOAD_SIZE);
+
+	uint32_t					getSourceId() const;
+	// Answer the ID the next frame will be sent with.
+	uint32_t					getFrameId() const;
+
+	// Answer true if every fragment was handed to the connection.
+	bool						send(ds::NetConnection&, const char* data, const int size);
+
+private:
+	const int					mPayloadSize;
+	const uint32_t				mSourceId;
+	uint32_t					mFrameId;
+	std::vector<char>			mPacket;
+};
+
+/**
+ * \class ds::NetReassembler
+ * \brief Collect fragments produced by a NetFragmenter and answer
+ * complete frames. Frames are delivered in order per source: once a
+ * frame completes, any older frame from the same source that is still
+ * missing fragments is discarded.
+ */
+class NetReassembler {
+public:
+	NetReassembler(const int maxPendingFrames = 8);
+
+	// Add a single received datagram. Answer true if it completed a frame,
+	// in which case the frame is available from getFrameData() until the next add().
+	// A frame that fits in one datagram isn't copied, the data points into the
+	// datagram itself, so the caller must also keep the datagram around until then.
+	bool						add(const char* datagram, const int size);
+	const char*					getFrameData() const;
+	int							getFrameSize() const;
+	// Drop all in-progress frames.
+	void						clear();
+
+	// Total frames thrown away because they never completed.
+	int							getDiscardedCount() const;
+
+private:
+	class Pending {
+	public:
+		Pending();
+
+		uint32_t				mSourceId;
+		uint32_t				mFrameId;
+		uint16_t				mFragmentCount;
+		uint16_t				mReceivedCount;
+		std::vector<bool>		mReceived;
+		std::string				mData;
+	};
+
+	class Source {
+	public:
+		Source(const uint32_t id = 0);
+
+		uint32_t				mId;
+		// The last frame completed for this source
+		uint32_t				mLastFrameId;
+		bool					mHasLastFrame;
+	};
+
+	Source&						findSource(const uint32_t);
+	void						discardOlder(const uint32_t source, const uint32_t frame);
+
+	const int					mMaxPendingFrames;
+	std::vector<Pending>		mPending;
+	std::vector<Source>			mSources;
+	// The last completed frame. mFrameData points at either mFrame
+	// or the payload of a single-fragment datagram.
+	std::string					mFrame;
+	const char*					mFrameData;
+	int							mFrameSize;
+	int							mDiscardedCount;
+};
+
+} // namespace ds
+
+#endif // DS_NETWORK_NETFRAGMENTER_H_
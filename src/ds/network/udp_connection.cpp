@@ -1,6 +1,7 @@
 #include "udp_connection.h"
 #include <iostream>
 #include <Poco/Net/NetException.h>
+#include <Poco/Net/SocketDefs.h>
 #include "ds\util\string_util.h"
 
 const unsigned int		ds::NET_MAX_UDP_PACKET_SIZE = 2000000;
@@ -169,6 +170,45 @@ int UdpConnection::recvMessage( std::string &msg )
   return 0;
 }
 
+int UdpConnection::recvMessage( char *buffer, int size )
+{
+  if ( !mInitialized || !buffer || size < 1 )
+    return 0;
+
+  try
+  {
+		if ( mSocket.available() <= 0 ) {
+      return 0;
+    }
+
+    // On Winsock available() is everything queued, not the size of the next
+    // datagram, so receive straight into the buffer and let the socket report
+    // a datagram that didn't fit.
+#ifdef MSG_TRUNC
+    // Answers the full datagram size, even though only size bytes were kept.
+    const int received = mSocket.receiveBytes(buffer, size, MSG_TRUNC);
+    if ( received > size )
+      return -1;
+    return received;
+#else
+    return mSocket.receiveBytes(buffer, size);
+#endif
+  }
+  catch ( Poco::Exception &e )
+  {
+    // Winsock fails a truncated datagram with WSAEMSGSIZE, and drops it.
+    if ( e.code() == POCO_EMSGSIZE )
+      return -1;
+    std::cout << e.displayText() << std::endl;
+  }
+  catch ( std::exception &e )
+  {
+    std::cout << e.what() << std::endl;
+  }
+
+  return 0;
+}
+
 bool UdpConnection::canRecv() const
 {
   if ( !mInitialized )
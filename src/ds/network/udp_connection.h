@@ -10,6 +10,8 @@
 namespace ds
 {
 
+// Size of the socket send and receive buffers. Individual datagrams
+// are kept under the MTU by ds::NetFragmenter.
 extern const unsigned int		NET_MAX_UDP_PACKET_SIZE;
 
 class UdpConnection : public NetConnection
@@ -27,6 +29,7 @@ class UdpConnection : public NetConnection
     bool sendMessage(const char *data, int size);
 
     int recvMessage(std::string &msg);
+    int recvMessage(char *buffer, int size);
     // Answer true if I have more data to receive, false otherwise.
     bool canRecv() const;
 
@@ -1,4 +1,5 @@
 #include "zmq_connection.h"
+#include <cstring>
 #include <iostream>
 #include "ds\util\string_util.h"
 
@@ -181,6 +182,38 @@ int ZmqConnection::recvMessage( std::string &msg )
   return false;
 }
 
+int ZmqConnection::recvMessage( char *buffer, int size )
+{
+  if ( !mInitialized || !mSocket || !buffer || size < 1 )
+    return 0;
+
+  try
+  {
+    if ( !mSocket->recv(&mMsgRecv, ZMQ_NOBLOCK) )
+      return 0;
+
+    const int msgSize = static_cast<int>(mMsgRecv.size());
+    if ( msgSize > size )
+      return -1;
+    memcpy(buffer, mMsgRecv.data(), msgSize);
+    return msgSize;
+  }
+  catch ( zmq::error_t &e )
+  {
+    std::cout << e.what() << std::endl;
+  }
+  catch ( std::exception &e )
+  {
+    std::cout << e.what() << std::endl;
+  }
+  catch (...)
+  {
+    std::cout << "Caught unknown exception" << std::endl;
+  }
+
+  return 0;
+}
+
 bool ZmqConnection::isServer() const
 {
   return mServer;
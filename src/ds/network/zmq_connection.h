@@ -22,6 +22,7 @@ class ZmqConnection : public NetConnection
     bool sendMessage(const char *data, int size);
 
     int recvMessage(std::string &msg);
+    int recvMessage(char *buffer, int size);
 
     bool isServer() const;
 
@@ -2,25 +2,35 @@
 
 #include <algorithm>
 #include <iostream>
+#include <cinder/Timer.h>
+#include "ds/cfg/settings.h"
 #include "ds/thread/work_client.h"
 
 using namespace ds;
 using namespace std;
 
 static const string					WORK_THREAD_NAME("ds_work");
+// Default time update() can spend handing off results
+static const double					DEFAULT_UPDATE_BUDGET = 0.002;
+// We use this for all async ops, some of which block on the network
+static const int					DEFAULT_THREAD_COUNT = 8;
+// Most requests a thread takes from a queue at once
+static const size_t					MAX_BATCH = 16;
+static const int					MAX_AVAILABLE = 0x7fffffff;
 
 /**
  * \class ds::WorkManager
  */
 WorkManager::WorkManager()
-	: mPool(WORK_THREAD_NAME, 4, 16)		// Keep at least 4 threads running, because we use this for all async ops
-//	: mPool(WORK_THREAD_NAME, 1, 1)
-	, mLoop(*this)
+	: mThreadCount(DEFAULT_THREAD_COUNT)
+	, mStarted(false)
+	, mStopping(false)
+	, mNextQueue(0)
+	, mAvailable(0, MAX_AVAILABLE)
+	, mUpdateBudget(DEFAULT_UPDATE_BUDGET)
+	, mUpdateMaxItems(0)
 {
 	mClient.reserve(64);
-	mInput.reserve(64);
-	mOutput.reserve(64);
-	mOutputTmp.reserve(64);
 }
 
 WorkManager::~WorkManager()
@@ -28,9 +38,23 @@ WorkManager::~WorkManager()
 	stopManager();
 }
 
+void WorkManager::configure(const ds::cfg::Settings& settings)
+{
+	setThreadCount(settings.getInt("work_manager:threads", 0, DEFAULT_THREAD_COUNT));
+	setUpdateBudget(settings.getFloat("work_manager:update_ms", 0, static_cast<float>(DEFAULT_UPDATE_BUDGET * 1000.0)) / 1000.0,
+					settings.getInt("work_manager:update_max", 0, 0));
+}
+
+void WorkManager::setThreadCount(const int count)
+{
+	Poco::FastMutex::ScopedLock	l(mStateMutex);
+	if (mStarted) return;
+	mThreadCount = std::max(count, 1);
+}
+
 void WorkManager::addClient(WorkClient& c)
 {
-	Poco::Mutex::ScopedLock		l(mInputMutex);
+	Poco::Mutex::ScopedLock		l(mClientMutex);
 	try {
 		mClient.push_back(&c);
 	} catch (std::exception const&) {
@@ -39,122 +63,215 @@ void WorkManager::addClient(WorkClient& c)
 
 void WorkManager::removeClient(WorkClient& c)
 {
-	Poco::Mutex::ScopedLock		l(mInputMutex);
-	try {
-		mClient.erase( remove( mClient.begin(), mClient.end(), &c ), mClient.end() );
-	} catch (std::exception const&) {
+	{
+		Poco::Mutex::ScopedLock		l(mClientMutex);
+		try {
+			mClient.erase( remove( mClient.begin(), mClient.end(), &c ), mClient.end() );
+		} catch (std::exception const&) {
+		}
 	}
+	cancelRequests(&c);
 }
 
 bool WorkManager::sendRequest(std::unique_ptr<WorkRequest>& upR, Poco::Timestamp* sendTime)
 {
 	if (!upR.get()) return false;
-	// Push new input onto the stack
+
+	Queue*							q = nullptr;
 	{
-		Poco::Mutex::ScopedLock		l(mInputMutex);
+		Poco::FastMutex::ScopedLock	l(mStateMutex);
+		if (mStopping) return false;
+		if (!mStarted) startLocked();
+		if (mQueues.empty()) return false;
+		q = mQueues[mNextQueue++ % mQueues.size()].get();
+	}
+
+	// Push new input onto the queue
+	{
+		Poco::FastMutex::ScopedLock	l(q->mMutex);
 		try {
 			upR.get()->mRequestTime = Poco::Timestamp();
 			if (sendTime) *sendTime = upR.get()->mRequestTime;
-			mInput.push_back(std::move(upR));
+			const int				p = std::min(std::max(static_cast<int>(upR.get()->mPriority), 0), WorkRequest::PRIORITY_COUNT-1);
+			q->mRequests[p].push_back(std::move(upR));
+			++q->mSize;
 		} catch (std::exception&) {
 			return false;
 		}
 	}
-	return inputAdded();
+
+	try {
+		mAvailable.set();
+	} catch (std::exception&) {
+		// Only if the count overflows, and then there are plenty of wakeups pending.
+	}
+	return true;
 }
 
 void WorkManager::stopManager()
 {
-	// Clear out the inputs so the threads will finish.
 	{
-		Poco::Mutex::ScopedLock		l(mInputMutex);
-		mInput.clear();
+		Poco::FastMutex::ScopedLock	l(mStateMutex);
+		mStopping = true;
+	}
+
+	// Clear out the inputs so the threads will finish.
+	for (auto it=mQueues.begin(), end=mQueues.end(); it != end; ++it) {
+		Queue&						q = *(it->get());
+		Poco::FastMutex::ScopedLock	l(q.mMutex);
+		for (int k=0; k<WorkRequest::PRIORITY_COUNT; ++k) q.mRequests[k].clear();
+		q.mSize = 0;
 	}
 
 	try {
-		mPool.joinAll();
+		for (size_t k=0; k<mThreads.size(); ++k) mAvailable.set();
+		for (auto it=mThreads.begin(), end=mThreads.end(); it != end; ++it) (*it)->join();
 	} catch (std::exception&) {
 	}
+	mThreads.clear();
 }
 
 void WorkManager::update()
 {
-	// To control how much processing the client does, pop off a single result
-	// in an update cycle.
-	mOutputTmp.clear();
-	{
-		Poco::Mutex::ScopedLock		l(mOutputMutex);
-		if (!mOutput.empty()) {
-			// I suspect there's a 1-line way to do this but haven't found it so far
-//			std::move(mOutput.begin(), mOutput.begin()+1, mOutputTmp.end());
-			std::unique_ptr<WorkRequest>	r(std::move(mOutput.front()));
-			mOutput.erase(mOutput.begin());
-			mOutputTmp.push_back(std::move(r));
+	// To control how much processing the clients do, hand off results until
+	// the time budget or item cap runs out, whichever comes first.
+	ci::Timer						timer(true);
+	mUpdateStats.mDrained = 0;
+	while (true) {
+		std::unique_ptr<WorkRequest>	r;
+		{
+			Poco::Mutex::ScopedLock		l(mOutputMutex);
+			mUpdateStats.mPending = static_cast<int>(mOutput.size());
+			if (mOutput.empty()) break;
+			r = std::move(mOutput.front());
+			mOutput.pop_front();
+			mUpdateStats.mPending = static_cast<int>(mOutput.size());
 		}
-	}
-	if (mOutputTmp.empty()) return;
+		++mUpdateStats.mDrained;
 
-	{
-		Poco::Mutex::ScopedLock		l(mClientMutex);
-		for (auto it=mOutputTmp.begin(), end=mOutputTmp.end(); it != end; ++it) {
-			WorkRequest*			r(it->get());
-			if (!r) continue;
+		if (r) {
+			Poco::Mutex::ScopedLock		l(mClientMutex);
 			WorkClient*				client = findClientLocked(r->mClientId);
-			if (!client) continue;
-
-			client->handleResult(*it);
+			// Any requests that weren't claimed by a client are lost
+			if (client) client->handleResult(r);
 		}
+
+		if (mUpdateMaxItems > 0 && mUpdateStats.mDrained >= mUpdateMaxItems) break;
+		if (timer.getSeconds() >= mUpdateBudget) break;
 	}
-	// Any requests that weren't claimed by a client are lost
-	mOutputTmp.clear();
+	mUpdateStats.mSeconds = timer.getSeconds();
+}
+
+void WorkManager::setUpdateBudget(const double seconds, const int maxItems)
+{
+	mUpdateBudget = seconds;
+	mUpdateMaxItems = maxItems;
 }
 
-bool WorkManager::inputAdded()
+const WorkManager::UpdateStats& WorkManager::getUpdateStats() const
 {
-	// Start a new thread to handle the input.  If we can't start one, no big deal,
-	// that means we've got threads running that will handle it.  And note that
-	// we always have a minimum number of threads running, so there's always someone
-	// who can handle it eventually.
+	return mUpdateStats;
+}
+
+void WorkManager::startLocked()
+{
+	mStarted = true;
 	try {
-		// This is a little ugly, but I have VS set to break on handled exceptions, which I want
-		// in general.  However, it's pretty easy to use up my thread pool, and I don't care
-		// about those warnings.  BUT, in practice, I imagine there's a remote possibility that
-		// somewhere after checking if threads are available but before calling start(), all the
-		// threads might HAVE been in use but time out, causing a thread not to get started.
-		// Granted, even if this happens it just means an input will sit there until someone
-		// else starts a thread, but still, in practice, I always want to try and create a thread.
-#ifdef _DEBUG
-		if (mPool.available() > 1) {
-			mPool.startWithPriority(Poco::Thread::PRIO_LOW, mLoop);
+		mQueues.reserve(mThreadCount);
+		mWorkers.reserve(mThreadCount);
+		mThreads.reserve(mThreadCount);
+		for (int k=0; k<mThreadCount; ++k) {
+			mQueues.push_back(std::unique_ptr<Queue>(new Queue()));
+			mWorkers.push_back(std::unique_ptr<Worker>(new Worker(*this, k)));
+		}
+		for (int k=0; k<mThreadCount; ++k) {
+			std::unique_ptr<Poco::Thread>	t(new Poco::Thread(WORK_THREAD_NAME));
+			t->setPriority(Poco::Thread::PRIO_LOW);
+			t->start(*(mWorkers[k].get()));
+			mThreads.push_back(std::move(t));
 		}
-#else
-		mPool.startWithPriority(Poco::Thread::PRIO_LOW, mLoop);
-#endif
-	} catch (Poco::NoThreadAvailableException&) {
 	} catch (std::exception&) {
+		// Any threads that did start will steal the work from the others' queues.
 	}
+	if (mThreads.empty()) mQueues.clear();
+}
 
-	return true;
+bool WorkManager::isStopping()
+{
+	Poco::FastMutex::ScopedLock	l(mStateMutex);
+	return mStopping;
 }
 
-void WorkManager::popNextInput(RequestList& in)
+bool WorkManager::takeInput(const size_t index, RequestList& out)
 {
-	Poco::Mutex::ScopedLock		l(mInputMutex);
-	if (!mInput.empty()) {
-		if (in.empty()) {
-			in.swap(mInput);
-		} else {
-			std::move(mInput.begin(), mInput.end(), in.begin());
+	// My own queue first, then everyone else's.
+	const size_t					count = mQueues.size();
+	for (size_t k=0; k<count; ++k) {
+		Queue&						q = *(mQueues[(index + k) % count].get());
+		Poco::FastMutex::ScopedLock	l(q.mMutex);
+		if (q.mSize < 1) continue;
+
+		// Nothing I take can be stolen, so only batch when no one is waiting to steal.
+		// Then take up to half, so a backed-up queue of small requests doesn't
+		// cost a lock per request, and there's still some left to steal.
+		const size_t				n = (mIdle.value() > 0 ? 1 : std::min((q.mSize + 1) / 2, MAX_BATCH));
+		takeFrom(q, k == 0, n, out);
+		return !out.empty();
+	}
+	return false;
+}
+
+void WorkManager::takeFrom(Queue& q, const bool front, const size_t count, RequestList& out)
+{
+	size_t							n = count;
+	for (int p=WorkRequest::PRIORITY_COUNT-1; p>=0 && n>0; --p) {
+		RequestDeque&				d = q.mRequests[p];
+		while (n > 0 && !d.empty()) {
+			if (front) {
+				out.push_back(std::move(d.front()));
+				d.pop_front();
+			} else {
+				out.push_back(std::move(d.back()));
+				d.pop_back();
+			}
+			--q.mSize;
+			--n;
 		}
 	}
 }
 
-void WorkManager::addOutput(std::unique_ptr<WorkRequest>& r)
+void WorkManager::cancelRequests(const void* clientId)
+{
+	for (auto it=mQueues.begin(), end=mQueues.end(); it != end; ++it) {
+		Queue&						q = *(it->get());
+		Poco::FastMutex::ScopedLock	l(q.mMutex);
+		for (int p=0; p<WorkRequest::PRIORITY_COUNT; ++p) {
+			RequestDeque&			d = q.mRequests[p];
+			RequestDeque			keep;
+			for (auto rit=d.begin(), rend=d.end(); rit != rend; ++rit) {
+				if (*rit && (*rit)->mClientId == clientId) --q.mSize;
+				else keep.push_back(std::move(*rit));
+			}
+			d.swap(keep);
+		}
+	}
+
+	// Nobody would claim these, either.
+	Poco::Mutex::ScopedLock			l(mOutputMutex);
+	RequestDeque					keep;
+	for (auto it=mOutput.begin(), end=mOutput.end(); it != end; ++it) {
+		if (*it && (*it)->mClientId != clientId) keep.push_back(std::move(*it));
+	}
+	mOutput.swap(keep);
+}
+
+void WorkManager::addOutput(RequestList& list)
 {
-	if (!r.get()) return;
 	Poco::Mutex::ScopedLock		l(mOutputMutex);
 	try {
-		mOutput.push_back(std::move(r));
+		for (auto it=list.begin(), end=list.end(); it != end; ++it) {
+			if (it->get()) mOutput.push_back(std::move(*it));
+		}
 	} catch (std::exception const&) {
 	}
 }
@@ -167,48 +284,62 @@ WorkClient* WorkManager::findClientLocked(const void* clientId)
 }
 
 /**
- * \class ds::WorkManager::Loop
+ * \class ds::WorkManager::UpdateStats
+ */
+WorkManager::UpdateStats::UpdateStats()
+	: mDrained(0)
+	, mPending(0)
+	, mSeconds(0.0)
+{
+}
+
+/**
+ * \class ds::WorkManager::Queue
  */
-WorkManager::Loop::Loop(WorkManager& qm)
+WorkManager::Queue::Queue()
+	: mSize(0)
+{
+}
+
+/**
+ * \class ds::WorkManager::Worker
+ */
+WorkManager::Worker::Worker(WorkManager& qm, const size_t index)
 	: mManager(qm)
+	, mIndex(index)
 {
 }
 
-void WorkManager::Loop::run()
+void WorkManager::Worker::run()
 {
 	DS_DBG_THREAD_CODE(mManager.debugThreadStarted(Poco::Thread::current()));
 
-	// Run for as long as I have input, then let the thread die to be reclaimed.
 	RequestList						ins;
-	mManager.popNextInput(ins);
-	while (!ins.empty()) {
-		// Process
-		for (auto it=ins.begin(), end=ins.end(); it != end; ++it) {
-			handleInput(*it);
+	ins.reserve(MAX_BATCH);
+	while (true) {
+		// One set() per request, so there might be nothing left by the time
+		// I wake up. That's fine, it just means someone else got it.
+		++mManager.mIdle;
+		mManager.mAvailable.wait();
+		--mManager.mIdle;
+		if (mManager.isStopping()) break;
+
+		// Run for as long as anyone has input
+		while (mManager.takeInput(mIndex, ins)) {
+			for (auto it=ins.begin(), end=ins.end(); it != end; ++it) {
+				try {
+					(*it)->run();
+				} catch (std::exception const&) {
+				}
+			}
+			mManager.addOutput(ins);
+			ins.clear();
 		}
-		ins.clear();
-
-		// Testing!  Which is not great -- should have some randomization
-		// so they're not all in sync.
-//		Poco::Thread::sleep(500);
-
-		// Continue processing if we've got input
-		mManager.popNextInput(ins);
 	}
 
 	DS_DBG_THREAD_CODE(mManager.debugThreadStopped(Poco::Thread::current()));
 }
 
-void WorkManager::Loop::handleInput(std::unique_ptr<WorkRequest>& upR) const
-{
-	WorkRequest*			r = upR.get();
-	if (!r) return;
-
-	r->run();
-
-  mManager.addOutput(upR);
-}
-
 /* QUERY-DEBUG
  ******************************************************************/
 #if QUERY_DEBUG_IS_ON
@@ -2,20 +2,34 @@
 #ifndef DS_THREAD_WORKMANAGER_H_
 #define DS_THREAD_WORKMANAGER_H_
 
+#include <deque>
 #include <string>
 #include <vector>
-#include <Poco/ThreadPool.h>
+#include <Poco/AtomicCounter.h>
+#include <Poco/Mutex.h>
+#include <Poco/Runnable.h>
+#include <Poco/Semaphore.h>
+#include <Poco/Thread.h>
 #include "ds/thread/thread_defs.h"
 #include "ds/thread/work_request.h"
 
 namespace ds {
 class WorkClient;
+namespace cfg {
+class Settings;
+}
 
 /**
  * \class ds::WorkManager
  * \brief Run a thread pool that can be continually fed WorRequests. These requests are generally
  * mediated through a WorkClient subclass, which handles the broad types of requests an app might
  * want.  Typically, the app will instantiate a WorkClient and let it take care of all the details.
+ *
+ * The pool is a fixed number of threads, each with its own queue. New requests are dealt out
+ * to the queues in turn. A thread runs from the front of its own queue, and when it runs dry it
+ * steals from the back of the others. While any thread is idle, requests are taken one at a time
+ * so the rest stay where they can be stolen. Only when every thread is busy does a thread take
+ * several from a backed-up queue at once, and those wait for any long request taken with them.
  */
 class WorkManager
 {
@@ -23,6 +37,11 @@ public:
 	WorkManager();
 	~WorkManager();
 
+	// Apply the work_manager:* engine settings (threads and update budget).
+	void							configure(const ds::cfg::Settings&);
+	// Only applies if called before the first request is sent.
+	void							setThreadCount(const int);
+
 	// I take ownership of the request.
 	bool							sendRequest(std::unique_ptr<WorkRequest>&, Poco::Timestamp* sendTime = nullptr);
 
@@ -31,6 +50,23 @@ public:
 	// any pending query outputs.
 	void							update();
 
+	// Limit how long update() spends handing results to clients. At least one
+	// result is always handed off. A maxItems of 0 means no limit on count.
+	void							setUpdateBudget(const double seconds, const int maxItems = 0);
+
+	class UpdateStats {
+	public:
+		UpdateStats();
+
+		// Results handed off in the last update()
+		int							mDrained;
+		// Results still waiting after the last update()
+		int							mPending;
+		// Time spent in the last update()
+		double						mSeconds;
+	};
+	const UpdateStats&				getUpdateStats() const;
+
 	// Stop the thread pool.  Called from the destructor, if a client doesn't call it earlier.
 	void							stopManager();
 
@@ -38,58 +74,80 @@ protected:
 	friend class WorkClient;
 
 	void							addClient(WorkClient&);
+	// Also throws away any of the client's requests that haven't started.
 	void							removeClient(WorkClient&);
 
-	// Thread entry
 private:
-	class Loop : public Poco::Runnable {
+	typedef std::vector<std::unique_ptr<WorkRequest>> RequestList;
+	typedef std::deque<std::unique_ptr<WorkRequest>> RequestDeque;
+
+	// One per thread.
+	class Queue {
 	public:
-		Loop(WorkManager&);
+		Queue();
 
-		// needs to be reentrant, since we are passed to multiple threads
-		virtual void				run();
+		Poco::FastMutex				mMutex;
+		RequestDeque				mRequests[WorkRequest::PRIORITY_COUNT];
+		size_t						mSize;
+	};
 
-		void						handleInput(std::unique_ptr<WorkRequest>&) const;
+	// Thread entry
+	class Worker : public Poco::Runnable {
+	public:
+		Worker(WorkManager&, const size_t index);
+
+		virtual void				run();
 
 	private:
 		WorkManager&				mManager;
+		const size_t				mIndex;
 	};
 
-private:
-	typedef std::vector<std::unique_ptr<WorkRequest>> RequestList;
+	// Start the threads, if they haven't been. Assumes the state is locked.
+	void							startLocked();
+	bool							isStopping();
+	// Fill the list from the worker's own queue, or steal from another.
+	bool							takeInput(const size_t index, RequestList&);
+	// Move up to count requests from the front or back of the queue into the list.
+	void							takeFrom(Queue&, const bool front, const size_t count, RequestList&);
+	// Throw away any queued requests for the client.
+	void							cancelRequests(const void* clientId);
 
-	/* NOTE ON LOCK ORDER:  Clients and the output can have nested locks.  Client
-	 * is always locked first.  XXX actually I think that changed.  I think there's
-	 * no nesting at the moment.
-	 */
-	// Synchronization
-	Poco::ThreadPool				mPool;
-	Loop							mLoop;
+	// Add to the output list
+	void							addOutput(RequestList&);
 
-	// Input
-	Poco::Mutex						mInputMutex;
-	RequestList						mInput;
+	// Answer the client, if it exists.  Assumes the client list is locked.
+	WorkClient*						findClientLocked(const void* clientId);
+
+	// Threads
+	Poco::FastMutex					mStateMutex;
+	int								mThreadCount;
+	bool							mStarted,
+									mStopping;
+	size_t							mNextQueue;
+	std::vector<std::unique_ptr<Queue>>
+									mQueues;
+	std::vector<std::unique_ptr<Worker>>
+									mWorkers;
+	std::vector<std::unique_ptr<Poco::Thread>>
+									mThreads;
+	// Set once for each request sent, so it's never less than the number queued.
+	Poco::Semaphore					mAvailable;
+	// Threads waiting for input
+	Poco::AtomicCounter				mIdle;
 
 	// Output
 	Poco::Mutex						mOutputMutex;
-	RequestList						mOutput, mOutputTmp;
+	RequestDeque					mOutput;
+
+	double							mUpdateBudget;
+	int								mUpdateMaxItems;
+	UpdateStats						mUpdateStats;
 
 	// Clients
 	Poco::Mutex						mClientMutex;
 	std::vector<WorkClient*>		mClient;
 
-	// Call after you've added more input
-	bool							inputAdded();
-
-	// Find the best match with database and put it in the list
-	void							popNextInput(RequestList&);
-
-	// Add to the output list
-	void							addOutput(std::unique_ptr<WorkRequest>&);
-
-	// Answer the client, if it exists.  Assumes the client list is locked.
-	WorkClient*						findClientLocked(const void* clientId);
-
 public:
 	class InputFactory;
 	class OutputFactory;
@@ -5,8 +5,9 @@ namespace ds {
 /**
  * \class ds::WorkRequest
  */
-WorkRequest::WorkRequest(const void* clientId)
+WorkRequest::WorkRequest(const void* clientId, const Priority p)
 	: mClientId(clientId)
+	, mPriority(p)
 {
 }
 
@@ -14,4 +15,14 @@ WorkRequest::~WorkRequest()
 {
 }
 
+void WorkRequest::setPriority(const Priority p)
+{
+	mPriority = p;
+}
+
+WorkRequest::Priority WorkRequest::getPriority() const
+{
+	return mPriority;
+}
+
 } // namespace ds
@@ -13,14 +13,21 @@ namespace ds {
  */
 class WorkRequest : public Poco::Runnable {
 public:
-	WorkRequest(const void* clientId);
+	// Higher priority requests are run first, within each worker thread.
+	enum Priority				{ PRIORITY_LOW, PRIORITY_NORMAL, PRIORITY_HIGH, PRIORITY_COUNT };
+
+	WorkRequest(const void* clientId, const Priority = PRIORITY_NORMAL);
 	virtual ~WorkRequest();
 
+	void						setPriority(const Priority);
+	Priority					getPriority() const;
+
 protected:
 	friend class WorkManager;
 
 	const void*					mClientId;
 	Poco::Timestamp				mRequestTime;
+	Priority					mPriority;
 
 private:
 	WorkRequest();
@@ -5,10 +5,12 @@
 #include "ds/app/environment.h"
 #include "ds/app/image_registry.h"
 #include "ds/arc/arc_io.h"
+#include "ds/arc/arc_render_cache.h"
 #include "ds/arc/arc_render_circle.h"
 #include "ds/data/data_buffer.h"
 #include "ds/debug/logger.h"
 #include "ds/ui/image_source/image_generator.h"
+#include "ds/ui/ip/ip_tile_runner.h"
 #include "ds/ui/sprite/sprite_engine.h"
 
 namespace ds {
@@ -26,6 +28,12 @@ const int			STATUS_ERROR	= -1;
 const int			STATUS_EMPTY	= 0;
 const int			STATUS_OK		= 1;
 
+// Shared by every generator. Set up in install().
+std::unique_ptr<ds::ui::ip::TileRunner>
+					RENDER_RUNNER;
+ds::arc::RenderCache
+					RENDER_CACHE;
+
 /**
  * \class ArcGenerator
  * This does all the work of generating and transporting settings across the network.
@@ -92,13 +100,20 @@ private:
 	void											generate() {
 		mStatus = STATUS_ERROR;
 		if (mWidth < 1 || mHeight < 1) return;
-		std::unique_ptr<ds::arc::Arc>		a = std::move(ds::arc::load(mFilename));
-		if (!a) return;
-		ci::Surface8u		s(mWidth, mHeight, true, ci::SurfaceConstraintsDefault());
-		if (!s || s.getWidth() != mWidth || s.getHeight() != mHeight) return;
-
-		ds::arc::RenderCircle		render;
-		if (!render.on(mInput, s, *(a.get()))) return;
+		const std::string	xml = ds::arc::loadXml(mFilename);
+		if (xml.empty()) return;
+		const std::string	key = ds::arc::RenderCache::makeKey(xml, mInput, mWidth, mHeight);
+		ci::Surface8u		s;
+		if (!RENDER_CACHE.find(key, s)) {
+			std::unique_ptr<ds::arc::Arc>	a = std::move(ds::arc::parse(xml));
+			if (!a) return;
+			s = ci::Surface8u(mWidth, mHeight, true, ci::SurfaceConstraintsDefault());
+			if (!s || s.getWidth() != mWidth || s.getHeight() != mHeight) return;
+
+			ds::arc::RenderCircle		render;
+			if (!render.on(mInput, s, *(a.get()), RENDER_RUNNER.get())) return;
+			RENDER_CACHE.add(key, s);
+		}
 
 		writeFile(s);
 		mTexture = ci::gl::Texture(s);
@@ -132,9 +147,11 @@ private:
 /**
  * \class ds::ui::ImageFile
  */
-void ImageArc::install(ds::ImageRegistry& registry)
+void ImageArc::install(ds::ImageRegistry& registry, const int threads, const size_t cache_bytes)
 {
   BLOB_TYPE = registry.addGenerator([](ds::ui::SpriteEngine& se)->ImageGenerator* { return new ArcGenerator(se); });
+  RENDER_RUNNER.reset(threads > 0 ? new ds::ui::ip::TileRunner(threads) : nullptr);
+  RENDER_CACHE.setMaxBytes(cache_bytes);
 }
 
 ImageArc::ImageArc(const int width, const int height, const std::string& filename)
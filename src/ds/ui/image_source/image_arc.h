@@ -41,8 +41,10 @@ private:
 
 	// Engine initialization
 public:
-	// Generators must be registered with the system at startup (i.e. in App constructor)
-	static void				install(ds::ImageRegistry&);
+	// Generators must be registered with the system at startup (i.e. in App constructor).
+	// Arcs are rendered on this many extra threads, and up to cache_bytes of rendered
+	// arcs are kept so the same arc, inputs and size aren't rendered again.
+	static void				install(ds::ImageRegistry&, const int threads = 0, const size_t cache_bytes = 0);
 };
 
 } // namespace ui
@@ -2,6 +2,7 @@
 
 #include "ds/app/image_registry.h"
 #include "ds/data/data_buffer.h"
+#include "ds/ui/ip/functions/ip_downscale.h"
 #include "ds/ui/image_source/image_generator.h"
 #include "ds/ui/service/load_image_service.h"
 #include "ds/ui/sprite/image.h"
@@ -16,6 +17,7 @@ const char          RES_FN_ATT			= 20;
 const char          RES_FLAGS_ATT		= 21;
 const char          RES_IPKEY_ATT		= 22;
 const char          RES_IPPARAMS_ATT	= 23;
+const char          RES_MAXSIZE_ATT		= 24;
 
 /**
  * \class FileGenerator
@@ -24,9 +26,9 @@ const char          RES_IPPARAMS_ATT	= 23;
 class FileGenerator : public ImageGenerator {
 public:
 	FileGenerator(SpriteEngine& e)
-			: ImageGenerator(BLOB_TYPE), mToken(e.getLoadImageService()) { }
-	FileGenerator(SpriteEngine& e, const std::string& fn, const std::string& ip_key, const std::string& ip_params, const int f)
-			: ImageGenerator(BLOB_TYPE), mToken(e.getLoadImageService()), mFilename(fn), mIpKey(ip_key), mIpParams(ip_params), mFlags(f) { preload(); }
+			: ImageGenerator(BLOB_TYPE), mToken(e.getLoadImageService()), mFlags(0), mMaxSize(0) { }
+	FileGenerator(SpriteEngine& e, const std::string& fn, const std::string& ip_key, const std::string& ip_params, const int f, const int max_size)
+			: ImageGenerator(BLOB_TYPE), mToken(e.getLoadImageService()), mFilename(fn), mIpKey(ip_key), mIpParams(ip_params), mFlags(f), mMaxSize(max_size) { preload(); }
 
 	const std::string&			getFilename() const {
 		return mFilename;
@@ -36,18 +38,27 @@ public:
 		return mFlags;
 	}
 
+	const int					getMaxSize() const {
+		return mMaxSize;
+	}
+
 	bool						getMetaData(ImageMetaData& d) const {
 		if (mFilename.empty()) return false;
 		ImageMetaData			atts(mFilename);
 		d = atts;
-		return !d.empty();
+		if (d.empty()) return false;
+		// Report the size the image will actually be decoded at.
+		const ci::Vec2i			size = ip::get_downscaled_size(	static_cast<int32_t>(d.mSize.x + 0.5f),
+																static_cast<int32_t>(d.mSize.y + 0.5f), mMaxSize);
+		d.mSize = ci::Vec2f(static_cast<float>(size.x), static_cast<float>(size.y));
+		return true;
 	}
 
 	const ci::gl::Texture*		getImage() {
 		if (mTexture) return &mTexture;
 
 		if (mToken.canAcquire()) {
-			mToken.acquire(mFilename, mIpKey, mIpParams, mFlags);
+			mToken.acquire(mFilename, mIpKey, mIpParams, mFlags, mMaxSize);
 		}
 		float						fade;
 		mTexture = mToken.getImage(fade);
@@ -67,6 +78,9 @@ public:
 
 		buf.add(RES_FLAGS_ATT);
 		buf.add(mFlags);
+
+		buf.add(RES_MAXSIZE_ATT);
+		buf.add(mMaxSize);
 	}
 
 	virtual bool				readFrom(DataBuffer& buf) {
@@ -86,6 +100,10 @@ public:
 		if (buf.read<char>() != RES_FLAGS_ATT) return false;
 		mFlags = buf.read<int>();
 
+		if (!buf.canRead<char>()) return false;
+		if (buf.read<char>() != RES_MAXSIZE_ATT) return false;
+		mMaxSize = buf.read<int>();
+
 		preload();
 
 		return true;
@@ -96,7 +114,7 @@ private:
 		// XXX This should check to see if I'm in client mode and only
 		// load it then. (or the service should be empty in server mode).
 		if ((mFlags&ds::ui::Image::IMG_PRELOAD_F) != 0 && mToken.canAcquire()) {
-			mToken.acquire(mFilename, mIpKey, mIpParams, mFlags);
+			mToken.acquire(mFilename, mIpKey, mIpParams, mFlags, mMaxSize, IMAGE_PRIORITY_LOW);
 		}
 	}
 
@@ -105,6 +123,7 @@ private:
 	std::string				mIpKey,
 							mIpParams;
 	int						mFlags;
+	int						mMaxSize;
 	ci::gl::Texture			mTexture;
 };
 
@@ -117,27 +136,29 @@ void ImageFile::install(ds::ImageRegistry& registry) {
 	BLOB_TYPE = registry.addGenerator([](ds::ui::SpriteEngine& se)->ImageGenerator* { return new FileGenerator(se); });
 }
 
-ImageFile::ImageFile(const std::string& filename, const int flags)
+ImageFile::ImageFile(const std::string& filename, const int flags, const int max_size)
 		: mFilename(filename)
-		, mFlags(flags) {
+		, mFlags(flags)
+		, mMaxSize(max_size > 0 ? max_size : 0) {
 }
 
 ImageFile::ImageFile(	const std::string& filename, const std::string& ip_key,
-						const std::string& ip_params, const int flags)
+						const std::string& ip_params, const int flags, const int max_size)
 		: mFilename(filename)
 		, mIpKey(ip_key)
 		, mIpParams(ip_params)
-		, mFlags(flags) {
+		, mFlags(flags)
+		, mMaxSize(max_size > 0 ? max_size : 0) {
 }
 
 ImageGenerator* ImageFile::newGenerator(SpriteEngine& e) const {
-	return new FileGenerator(e, mFilename, mIpKey, mIpParams, mFlags);
+	return new FileGenerator(e, mFilename, mIpKey, mIpParams, mFlags, mMaxSize);
 }
 
 bool ImageFile::generatorMatches(const ImageGenerator& gen) const {
 	const FileGenerator*	fgen = dynamic_cast<const FileGenerator*>(&gen);
 	if (fgen) {
-		return mFilename == fgen->getFilename() && mFlags == fgen->getFlags();
+		return mFilename == fgen->getFilename() && mFlags == fgen->getFlags() && mMaxSize == fgen->getMaxSize();
 	}
 	return false;
 }
@@ -19,8 +19,10 @@ public:
 	/**
 	 * \param filename is the filename (and path) for the resource.
 	 * \param flags provides scope info (i.e. ds::IMG_CACHE).
+	 * \param max_size shrinks the image as it's loaded so neither side is
+	 * larger. Use it for thumbnails. 0 loads it at full size.
 	 */
-	ImageFile(const std::string& filename, const int flags = 0);
+	ImageFile(const std::string& filename, const int flags = 0, const int max_size = 0);
 	/**
 	 * \param ip_key is a key to an IpFunction, which must be one of the
 	 * system ones in ip_defs.h, or installed by the app.
@@ -28,7 +30,7 @@ public:
 	 * on the function.
 	 */
 	ImageFile(	const std::string& filename, const std::string& ip_key,
-				const std::string& ip_params, const int flags = 0);
+				const std::string& ip_params, const int flags = 0, const int max_size = 0);
 
 	virtual ImageGenerator*		newGenerator(SpriteEngine&) const;
 	virtual bool				generatorMatches(const ImageGenerator&) const;
@@ -38,6 +40,7 @@ private:
 	const std::string			mIpKey,
 								mIpParams;
 	const int					mFlags;
+	const int					mMaxSize;
 
 	// Engine initialization
 public:
@@ -27,8 +27,8 @@ void ImageOwner::clearImage() {
 	onImageChanged();
 }
 
-void ImageOwner::setImageFile(const std::string& filename, const int flags) {
-	setImage(ImageFile(filename, flags));
+void ImageOwner::setImageFile(const std::string& filename, const int flags, const int max_size) {
+	setImage(ImageFile(filename, flags, max_size));
 }
 
 void ImageOwner::setImageResource(const ds::Resource& r, const int flags) {
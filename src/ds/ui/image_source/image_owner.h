@@ -25,8 +25,10 @@ public:
 	/**
 	 * \param filename is the absolute file path to the resource.
 	 * \param flags provides scope info (i.e. ds::IMG_CACHE).
+	 * \param max_size shrinks the image as it's loaded so neither side is
+	 * larger, which is also the size it reports once loaded. 0 is full size.
 	 */
-	void				setImageFile(const std::string& filename, const int flags = 0);
+	void				setImageFile(const std::string& filename, const int flags = 0, const int max_size = 0);
 	/**
 	 * \param resource is the resource.
 	 * \param flags provides scope info (i.e. ds::IMG_CACHE).
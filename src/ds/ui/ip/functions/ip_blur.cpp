@@ -0,0 +1,106 @@
+#include <ds/ui/ip/functions/ip_blur.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <ds/ui/ip/ip_tile_runner.h>
+#include <ds/util/string_util.h>
+
+namespace ds {
+namespace ui {
+namespace ip {
+
+namespace {
+const int					MAX_RADIUS = 256;
+const int					MAX_PASSES = 5;
+
+inline int32_t				clamp_index(const int32_t i, const int32_t count) {
+	return (i < 0 ? 0 : (i >= count ? count - 1 : i));
+}
+
+// Blur each row in place. Pixels past the edge repeat the edge pixel.
+void						blur_rows(	uint8_t* data, const int32_t w, const int32_t row_bytes, const int32_t inc,
+										const int32_t radius, const int32_t y0, const int32_t y1) {
+	const uint32_t			n = 2 * radius + 1;
+	std::vector<uint8_t>	src(static_cast<size_t>(w) * inc);
+	for (int32_t y=y0; y<y1; ++y) {
+		uint8_t*			row = data + y * row_bytes;
+		memcpy(&src[0], row, src.size());
+		for (int32_t c=0; c<inc; ++c) {
+			const uint8_t*	p = &src[c];
+			uint32_t		sum = (radius + 1) * p[0];
+			for (int32_t i=1; i<=radius; ++i) sum += p[clamp_index(i, w) * inc];
+			for (int32_t x=0; x<w; ++x) {
+				row[x * inc + c] = static_cast<uint8_t>((sum + n / 2) / n);
+				sum += p[clamp_index(x + radius + 1, w) * inc];
+				sum -= p[clamp_index(x - radius, w) * inc];
+			}
+		}
+	}
+}
+
+// Blur each column over rows [y0, y1), reading from an untouched copy.
+void						blur_columns(	const uint8_t* src, uint8_t* dst, const int32_t w, const int32_t h,
+											const int32_t row_bytes, const int32_t inc, const int32_t radius,
+											const int32_t y0, const int32_t y1) {
+	const uint32_t			n = 2 * radius + 1;
+	const int32_t			count = w * inc;
+	std::vector<uint32_t>	sums(count, 0);
+	for (int32_t i=-radius; i<=radius; ++i) {
+		const uint8_t*		row = src + clamp_index(y0 + i, h) * row_bytes;
+		for (int32_t k=0; k<count; ++k) sums[k] += row[k];
+	}
+	for (int32_t y=y0; y<y1; ++y) {
+		uint8_t*			out = dst + y * row_bytes;
+		const uint8_t*		add = src + clamp_index(y + radius + 1, h) * row_bytes;
+		const uint8_t*		sub = src + clamp_index(y - radius, h) * row_bytes;
+		for (int32_t k=0; k<count; ++k) {
+			out[k] = static_cast<uint8_t>((sums[k] + n / 2) / n);
+			sums[k] += add[k];
+			sums[k] -= sub[k];
+		}
+	}
+}
+}
+
+/**
+ * \class ds::ui::ip::Blur
+ */
+Blur::Blur() {
+}
+
+void Blur::on(const std::string& parameters, ci::Surface8u& s) const {
+	TileRunner				serial;
+	onTiles(parameters, s, serial);
+}
+
+void Blur::onTiles(const std::string& parameters, ci::Surface8u& s, TileRunner& runner) const {
+	if (!s) return;
+	int						radius = 2, passes = 3;
+	const std::vector<std::string>	args = ds::split(parameters, ",", true);
+	if (args.size() > 0) ds::string_to_value(args[0], radius);
+	if (args.size() > 1) ds::string_to_value(args[1], passes);
+	radius = std::min(radius, MAX_RADIUS);
+	passes = std::min(passes, MAX_PASSES);
+	if (radius < 1 || passes < 1) return;
+
+	const int32_t			w = s.getWidth(), h = s.getHeight();
+	const int32_t			row_bytes = s.getRowBytes();
+	const int32_t			inc = s.getPixelInc();
+	uint8_t*				data = s.getData();
+	std::vector<uint8_t>	copy(static_cast<size_t>(row_bytes) * h);
+	const uint8_t*			src = &copy[0];
+	for (int p=0; p<passes; ++p) {
+		runner.run(h, [=](const int32_t y0, const int32_t y1) {
+			blur_rows(data, w, row_bytes, inc, radius, y0, y1);
+		});
+		memcpy(&copy[0], data, copy.size());
+		runner.run(h, [=](const int32_t y0, const int32_t y1) {
+			blur_columns(src, data, w, h, row_bytes, inc, radius, y0, y1);
+		});
+	}
+}
+
+} // namespace ip
+} // namespace ui
+} // namespace ds
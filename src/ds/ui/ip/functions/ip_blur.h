@@ -0,0 +1,30 @@
+#pragma once
+#ifndef DS_UI_IP_FUNCTIONS_IPBLUR_H_
+#define DS_UI_IP_FUNCTIONS_IPBLUR_H_
+
+#include <ds/ui/ip/ip_function.h>
+
+namespace ds {
+namespace ui {
+namespace ip {
+
+/**
+ * \class ds::ui::ip::Blur
+ * Box blur the surface. Parameters are "radius" (default 2) and optionally
+ * "radius,passes" (default 3 passes, which is close to a gaussian). Every
+ * channel is blurred, so premultiply first if the transparent pixels have
+ * colours that shouldn't bleed in.
+ */
+class Blur : public Function {
+public:
+	Blur();
+
+	virtual void				on(const std::string& parameters, ci::Surface8u&) const;
+	virtual void				onTiles(const std::string& parameters, ci::Surface8u&, TileRunner&) const;
+};
+
+} // namespace ip
+} // namespace ui
+} // namespace ds
+
+#endif
@@ -1,9 +1,35 @@
 #include <ds/ui/ip/functions/ip_circle_mask.h>
 
+#include <cmath>
+#include <ds/ui/ip/ip_tile_runner.h>
+
 namespace ds {
 namespace ui {
 namespace ip {
 
+namespace {
+// Fade the alpha of a pixel this far from the centre. Everything inside
+// max - 1 is left alone, everything outside max is cleared.
+inline void					mask_pixel(uint8_t& alpha, const float d, const float max) {
+	float					alpha_f = 1.0f;
+	if (d > max) {
+		alpha_f = 0.0f;
+	} else if (d > max - 1.0f) {
+		alpha_f = 1.0f-(d-(max-1.0f));
+	}
+	int32_t					a = static_cast<int32_t>(static_cast<float>(alpha) * alpha_f);
+	if (a < 0) a = 0;
+	else if (a > 255) a = 255;
+	alpha = static_cast<uint8_t>(a);
+}
+
+inline int32_t				clamp_x(const double x, const int32_t w) {
+	if (x < 0.0) return 0;
+	if (x > static_cast<double>(w)) return w;
+	return static_cast<int32_t>(x);
+}
+}
+
 /**
  * \class ds::ui::ip::CircleMask
  */
@@ -11,33 +37,65 @@ CircleMask::CircleMask() {
 }
 
 void CircleMask::on(const std::string& parameters, ci::Surface8u& s) const {
-	if (!s) return;
-	int32_t					w = s.getWidth(), h = s.getHeight();
+	TileRunner				serial;
+	onTiles(parameters, s, serial);
+}
+
+void CircleMask::onTiles(const std::string& parameters, ci::Surface8u& s, TileRunner& runner) const {
+	if (!s || !s.hasAlpha()) return;
+	const int32_t			w = s.getWidth(), h = s.getHeight();
 	if (w < 1 || h < 1) return;
 
-	const ci::Vec2f			cen(static_cast<float>(w)/2.0f, static_cast<float>(h)/2.0f);
-	const float				max = (cen.x <= cen.y ? cen.x : cen.y);
-
-	ci::Surface8u::Iter		iter = s.getIter();
-	int32_t					y = 0;
-	while (iter.line()) {
-		int32_t				x = 0;
-		while (iter.pixel()) {
-			const float		d = cen.distance(ci::Vec2f(static_cast<float>(x), static_cast<float>(y)));
-			float			alpha_f = 1.0f;
-			if (d > max) {
-				alpha_f = 0.0f;
-			} else if (d > max - 1.0f) {
-				alpha_f = 1.0f-(d-(max-1.0f));
-			} 
-			int32_t			a = static_cast<int32_t>(static_cast<float>(iter.a()) * alpha_f);
-			if (a < 0) a = 0;
-			else if (a > 255) a = 255;
-			iter.a() = static_cast<uint8_t>(a);
-			++x;
+	const float				cx = static_cast<float>(w)/2.0f,
+							cy = static_cast<float>(h)/2.0f;
+	const float				max = (cx <= cy ? cx : cy);
+	const int32_t			inc = s.getPixelInc();
+	const int32_t			row_bytes = s.getRowBytes();
+	uint8_t*				data = s.getData() + s.getChannelOrder().getAlphaOffset();
+
+	// Only the pixels near the edge of the circle need a distance. Each row
+	// is split into spans that are certainly outside (cleared), certainly
+	// inside (untouched) and the edge. The spans are padded by a pixel so
+	// rounding can't put a pixel in the wrong one; the edge pixels get the
+	// exact per-pixel calculation.
+	runner.run(h, [=](const int32_t y0, const int32_t y1) {
+		for (int32_t y=y0; y<y1; ++y) {
+			uint8_t*		row = data + y * row_bytes;
+			const float		ey = cy - static_cast<float>(y);
+			const double	dy2 = static_cast<double>(ey) * ey;
+			const double	outer = static_cast<double>(max) + 1.0,
+							inner = static_cast<double>(max) - 2.0;
+
+			// Span of pixels that might not be cleared
+			int32_t			edge0 = 0, edge1 = 0;
+			if (dy2 < outer * outer) {
+				const double	half = sqrt(outer * outer - dy2);
+				edge0 = clamp_x(floor(cx - half), w);
+				edge1 = clamp_x(ceil(cx + half) + 1.0, w);
+			}
+			// Span of pixels that are certainly untouched
+			int32_t			in0 = edge0, in1 = edge0;
+			if (inner > 0.0 && dy2 < inner * inner) {
+				const double	half = sqrt(inner * inner - dy2);
+				in0 = clamp_x(ceil(cx - half), w);
+				in1 = clamp_x(floor(cx + half), w);
+				if (in0 < edge0) in0 = edge0;
+				if (in1 > edge1) in1 = edge1;
+				if (in1 < in0) in1 = in0;
+			}
+
+			for (int32_t x=0; x<edge0; ++x) row[x * inc] = 0;
+			for (int32_t x=edge0; x<in0; ++x) {
+				const float	ex = cx - static_cast<float>(x);
+				mask_pixel(row[x * inc], std::sqrt(ex*ex + ey*ey), max);
+			}
+			for (int32_t x=in1; x<edge1; ++x) {
+				const float	ex = cx - static_cast<float>(x);
+				mask_pixel(row[x * inc], std::sqrt(ex*ex + ey*ey), max);
+			}
+			for (int32_t x=edge1; x<w; ++x) row[x * inc] = 0;
 		}
-		++y;
-	}
+	});
 }
 
 } // namespace ip
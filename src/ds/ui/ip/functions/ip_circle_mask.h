@@ -17,6 +17,7 @@ public:
 	CircleMask();
 		
 	virtual void				on(const std::string& parameters, ci::Surface8u&) const;
+	virtual void				onTiles(const std::string& parameters, ci::Surface8u&, TileRunner&) const;
 };
 
 } // namespace ip
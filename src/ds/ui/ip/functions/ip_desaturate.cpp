@@ -0,0 +1,52 @@
+#include <ds/ui/ip/functions/ip_desaturate.h>
+
+#include <ds/ui/ip/ip_tile_runner.h>
+#include <ds/util/string_util.h>
+
+namespace ds {
+namespace ui {
+namespace ip {
+
+/**
+ * \class ds::ui::ip::Desaturate
+ */
+Desaturate::Desaturate() {
+}
+
+void Desaturate::on(const std::string& parameters, ci::Surface8u& s) const {
+	TileRunner				serial;
+	onTiles(parameters, s, serial);
+}
+
+void Desaturate::onTiles(const std::string& parameters, ci::Surface8u& s, TileRunner& runner) const {
+	if (!s) return;
+	float					amount = 1.0f;
+	if (!parameters.empty()) ds::string_to_value(parameters, amount);
+	if (amount <= 0.0f) return;
+	if (amount > 1.0f) amount = 1.0f;
+
+	// Fixed point, 8 bits of fraction. The luma weights are Rec. 601.
+	const int32_t			k = static_cast<int32_t>(amount * 256.0f + 0.5f);
+	const int32_t			w = s.getWidth();
+	const int32_t			row_bytes = s.getRowBytes();
+	const int32_t			inc = s.getPixelInc();
+	const int32_t			r = s.getChannelOrder().getRedOffset(),
+							g = s.getChannelOrder().getGreenOffset(),
+							b = s.getChannelOrder().getBlueOffset();
+	uint8_t*				data = s.getData();
+	runner.run(s.getHeight(), [=](const int32_t y0, const int32_t y1) {
+		for (int32_t y=y0; y<y1; ++y) {
+			uint8_t*		px = data + y * row_bytes;
+			for (int32_t x=0; x<w; ++x, px+=inc) {
+				const int32_t	luma = (77 * px[r] + 150 * px[g] + 29 * px[b] + 128) >> 8;
+				px[r] = static_cast<uint8_t>(px[r] + (((luma - px[r]) * k) >> 8));
+				px[g] = static_cast<uint8_t>(px[g] + (((luma - px[g]) * k) >> 8));
+				px[b] = static_cast<uint8_t>(px[b] + (((luma - px[b]) * k) >> 8));
+			}
+		}
+	});
+}
+
+} // namespace ip
+} // namespace ui
+} // namespace ds
@@ -0,0 +1,28 @@
+#pragma once
+#ifndef DS_UI_IP_FUNCTIONS_IPDESATURATE_H_
+#define DS_UI_IP_FUNCTIONS_IPDESATURATE_H_
+
+#include <ds/ui/ip/ip_function.h>
+
+namespace ds {
+namespace ui {
+namespace ip {
+
+/**
+ * \class ds::ui::ip::Desaturate
+ * Blend the colour channels toward their luma. The parameter is the amount,
+ * 0 - 1 (default 1, fully grey).
+ */
+class Desaturate : public Function {
+public:
+	Desaturate();
+
+	virtual void				on(const std::string& parameters, ci::Surface8u&) const;
+	virtual void				onTiles(const std::string& parameters, ci::Surface8u&, TileRunner&) const;
+};
+
+} // namespace ip
+} // namespace ui
+} // namespace ds
+
+#endif
@@ -0,0 +1,76 @@
+#include <ds/ui/ip/functions/ip_downscale.h>
+
+#include <algorithm>
+#include <vector>
+#include <ds/ui/ip/ip_tile_runner.h>
+
+namespace ds {
+namespace ui {
+namespace ip {
+
+ci::Vec2i get_downscaled_size(const int32_t w, const int32_t h, const int max_size) {
+	if (max_size < 1 || (w <= max_size && h <= max_size)) return ci::Vec2i(w, h);
+	const double			scale = static_cast<double>(max_size) / static_cast<double>(w >= h ? w : h);
+	int32_t					dw = static_cast<int32_t>(static_cast<double>(w) * scale + 0.5),
+							dh = static_cast<int32_t>(static_cast<double>(h) * scale + 0.5);
+	if (dw < 1) dw = 1;
+	if (dh < 1) dh = 1;
+	return ci::Vec2i(dw, dh);
+}
+
+ci::Surface8u downscale(const ci::Surface8u& src, const int max_size) {
+	TileRunner				serial;
+	return downscale(src, max_size, serial);
+}
+
+ci::Surface8u downscale(const ci::Surface8u& src, const int max_size, TileRunner& runner) {
+	if (!src) return src;
+	const int32_t			sw = src.getWidth(), sh = src.getHeight();
+	const ci::Vec2i			size = get_downscaled_size(sw, sh, max_size);
+	if (size.x >= sw && size.y >= sh) return src;
+
+	const int32_t			dw = size.x, dh = size.y;
+	ci::Surface8u			dst(dw, dh, src.hasAlpha(), src.getChannelOrder());
+	// Every byte of a pixel is averaged the same way, so the channel order doesn't matter.
+	const int32_t			inc = src.getPixelInc();
+	const int32_t			dst_inc = dst.getPixelInc();
+	const int32_t			channels = (inc < dst_inc ? inc : dst_inc);
+
+	// Sum each source column over the rows in the current destination row,
+	// then sum those across the columns in each destination pixel.
+	const uint8_t*			src_data = src.getData();
+	const int32_t			src_row_bytes = src.getRowBytes();
+	uint8_t*				dst_data = dst.getData();
+	const int32_t			dst_row_bytes = dst.getRowBytes();
+	runner.run(dh, [=](const int32_t dy0, const int32_t dy1) {
+		std::vector<uint32_t>	columns(static_cast<size_t>(sw) * inc);
+		for (int32_t dy=dy0; dy<dy1; ++dy) {
+			const int32_t		sy0 = static_cast<int32_t>(static_cast<int64_t>(dy) * sh / dh),
+								sy1 = static_cast<int32_t>(static_cast<int64_t>(dy + 1) * sh / dh);
+			std::fill(columns.begin(), columns.end(), 0);
+			for (int32_t sy=sy0; sy<sy1; ++sy) {
+				const uint8_t*	row = src_data + static_cast<size_t>(sy) * src_row_bytes;
+				uint32_t*		col = &columns[0];
+				for (int32_t k=0, count=sw*inc; k<count; ++k) col[k] += row[k];
+			}
+
+			uint8_t*			out = dst_data + static_cast<size_t>(dy) * dst_row_bytes;
+			for (int32_t dx=0; dx<dw; ++dx) {
+				const int32_t	sx0 = static_cast<int32_t>(static_cast<int64_t>(dx) * sw / dw),
+								sx1 = static_cast<int32_t>(static_cast<int64_t>(dx + 1) * sw / dw);
+				const uint64_t	area = static_cast<uint64_t>(sx1 - sx0) * (sy1 - sy0);
+				for (int32_t c=0; c<channels; ++c) {
+					uint64_t	sum = 0;
+					for (int32_t sx=sx0; sx<sx1; ++sx) sum += columns[sx * inc + c];
+					out[c] = static_cast<uint8_t>((sum + area / 2) / area);
+				}
+				out += dst_inc;
+			}
+		}
+	});
+	return dst;
+}
+
+} // namespace ip
+} // namespace ui
+} // namespace ds
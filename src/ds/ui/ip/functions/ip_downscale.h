@@ -0,0 +1,34 @@
+#pragma once
+#ifndef DS_UI_IP_FUNCTIONS_IPDOWNSCALE_H_
+#define DS_UI_IP_FUNCTIONS_IPDOWNSCALE_H_
+
+#include <cinder/Surface.h>
+
+namespace ds {
+namespace ui {
+namespace ip {
+class TileRunner;
+}
+}
+}
+
+namespace ds {
+namespace ui {
+namespace ip {
+
+// Answer the size of the surface once it's been shrunk so neither side
+// is larger than max_size, keeping the aspect ratio. 0 is no limit.
+ci::Vec2i					get_downscaled_size(const int32_t w, const int32_t h, const int max_size);
+
+// Shrink the surface so neither side is larger than max_size, averaging
+// every source pixel that falls in each destination pixel (an area filter).
+// Answer the surface itself if it's already small enough.
+ci::Surface8u				downscale(const ci::Surface8u&, const int max_size);
+// Destination rows are spread across the runner.
+ci::Surface8u				downscale(const ci::Surface8u&, const int max_size, TileRunner&);
+
+} // namespace ip
+} // namespace ui
+} // namespace ds
+
+#endif
@@ -0,0 +1,99 @@
+#include <ds/ui/ip/functions/ip_premultiply.h>
+
+#include <ds/ui/ip/ip_tile_runner.h>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define DS_IP_PREMULTIPLY_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace ds {
+namespace ui {
+namespace ip {
+
+namespace {
+// c * a / 255, rounded. The SSE2 path does exactly the same arithmetic.
+inline uint8_t				mul_255(const uint32_t c, const uint32_t a) {
+	const uint32_t			t = c * a + 128;
+	return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+}
+
+void						premultiply_row_scalar(uint8_t* row, const int32_t count, const int32_t alpha) {
+	for (int32_t x=0; x<count; ++x, row+=4) {
+		const uint32_t		a = row[alpha];
+		for (int32_t c=0; c<4; ++c) {
+			if (c != alpha) row[c] = mul_255(row[c], a);
+		}
+	}
+}
+
+#ifdef DS_IP_PREMULTIPLY_SSE2
+// Two pixels of 16-bit channels. ALPHA is the channel the alpha is in.
+template <int ALPHA>
+inline __m128i				premultiply_2(const __m128i px, const __m128i alpha_mask, const __m128i k128) {
+	__m128i					a = _mm_shufflelo_epi16(px, _MM_SHUFFLE(ALPHA, ALPHA, ALPHA, ALPHA));
+	a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(ALPHA, ALPHA, ALPHA, ALPHA));
+	// Alpha itself is multiplied by 255, which leaves it as it was.
+	a = _mm_or_si128(_mm_andnot_si128(alpha_mask, a), _mm_and_si128(alpha_mask, _mm_set1_epi16(255)));
+	__m128i					t = _mm_add_epi16(_mm_mullo_epi16(px, a), k128);
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// Four pixels at a time, whatever's left over is done one at a time.
+template <int ALPHA>
+void						premultiply_row_sse2(uint8_t* row, const int32_t count) {
+	const __m128i			zero = _mm_setzero_si128();
+	const __m128i			k128 = _mm_set1_epi16(128);
+	const __m128i			alpha_mask = _mm_set_epi16(	ALPHA == 3 ? -1 : 0, ALPHA == 2 ? -1 : 0, ALPHA == 1 ? -1 : 0, ALPHA == 0 ? -1 : 0,
+														ALPHA == 3 ? -1 : 0, ALPHA == 2 ? -1 : 0, ALPHA == 1 ? -1 : 0, ALPHA == 0 ? -1 : 0);
+	int32_t					x = 0;
+	for (; x+4<=count; x+=4, row+=16) {
+		const __m128i		px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row));
+		const __m128i		lo = premultiply_2<ALPHA>(_mm_unpacklo_epi8(px, zero), alpha_mask, k128);
+		const __m128i		hi = premultiply_2<ALPHA>(_mm_unpackhi_epi8(px, zero), alpha_mask, k128);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(row), _mm_packus_epi16(lo, hi));
+	}
+	premultiply_row_scalar(row, count - x, ALPHA);
+}
+#endif
+
+void						premultiply_row(uint8_t* row, const int32_t count, const int32_t alpha) {
+#ifdef DS_IP_PREMULTIPLY_SSE2
+	if (alpha == 3) {
+		premultiply_row_sse2<3>(row, count);
+		return;
+	}
+	if (alpha == 0) {
+		premultiply_row_sse2<0>(row, count);
+		return;
+	}
+#endif
+	premultiply_row_scalar(row, count, alpha);
+}
+}
+
+/**
+ * \class ds::ui::ip::Premultiply
+ */
+Premultiply::Premultiply() {
+}
+
+void Premultiply::on(const std::string& parameters, ci::Surface8u& s) const {
+	TileRunner				serial;
+	onTiles(parameters, s, serial);
+}
+
+void Premultiply::onTiles(const std::string&, ci::Surface8u& s, TileRunner& runner) const {
+	if (!s || !s.hasAlpha() || s.getPixelInc() != 4) return;
+	const int32_t			w = s.getWidth();
+	const int32_t			row_bytes = s.getRowBytes();
+	const int32_t			alpha = s.getChannelOrder().getAlphaOffset();
+	uint8_t*				data = s.getData();
+	runner.run(s.getHeight(), [=](const int32_t y0, const int32_t y1) {
+		for (int32_t y=y0; y<y1; ++y) premultiply_row(data + y * row_bytes, w, alpha);
+	});
+}
+
+} // namespace ip
+} // namespace ui
+} // namespace ds
@@ -0,0 +1,27 @@
+#pragma once
+#ifndef DS_UI_IP_FUNCTIONS_IPPREMULTIPLY_H_
+#define DS_UI_IP_FUNCTIONS_IPPREMULTIPLY_H_
+
+#include <ds/ui/ip/ip_function.h>
+
+namespace ds {
+namespace ui {
+namespace ip {
+
+/**
+ * \class ds::ui::ip::Premultiply
+ * Multiply the colour channels by alpha. No parameters.
+ */
+class Premultiply : public Function {
+public:
+	Premultiply();
+
+	virtual void				on(const std::string& parameters, ci::Surface8u&) const;
+	virtual void				onTiles(const std::string& parameters, ci::Surface8u&, TileRunner&) const;
+};
+
+} // namespace ip
+} // namespace ui
+} // namespace ds
+
+#endif
@@ -0,0 +1,30 @@
+#include <ds/ui/ip/functions/ip_resize.h>
+
+#include <ds/ui/ip/ip_tile_runner.h>
+#include <ds/ui/ip/functions/ip_downscale.h>
+#include <ds/util/string_util.h>
+
+namespace ds {
+namespace ui {
+namespace ip {
+
+/**
+ * \class ds::ui::ip::Resize
+ */
+Resize::Resize() {
+}
+
+void Resize::on(const std::string& parameters, ci::Surface8u& s) const {
+	TileRunner				serial;
+	onTiles(parameters, s, serial);
+}
+
+void Resize::onTiles(const std::string& parameters, ci::Surface8u& s, TileRunner& runner) const {
+	int						max_size = 0;
+	if (!s || !ds::string_to_value(parameters, max_size) || max_size < 1) return;
+	s = downscale(s, max_size, runner);
+}
+
+} // namespace ip
+} // namespace ui
+} // namespace ds
@@ -0,0 +1,28 @@
+#pragma once
+#ifndef DS_UI_IP_FUNCTIONS_IPRESIZE_H_
+#define DS_UI_IP_FUNCTIONS_IPRESIZE_H_
+
+#include <ds/ui/ip/ip_function.h>
+
+namespace ds {
+namespace ui {
+namespace ip {
+
+/**
+ * \class ds::ui::ip::Resize
+ * Shrink the surface so neither side is larger than the parameter, with an
+ * area filter. Surfaces that are already small enough are left alone.
+ */
+class Resize : public Function {
+public:
+	Resize();
+
+	virtual void				on(const std::string& parameters, ci::Surface8u&) const;
+	virtual void				onTiles(const std::string& parameters, ci::Surface8u&, TileRunner&) const;
+};
+
+} // namespace ip
+} // namespace ui
+} // namespace ds
+
+#endif
@@ -6,9 +6,17 @@ namespace ip {
 
 namespace {
 const std::string		_CIRCLE_MASK("ds:circle_mask");
+const std::string		_PREMULTIPLY("ds:premultiply");
+const std::string		_DESATURATE("ds:desaturate");
+const std::string		_BLUR("ds:blur");
+const std::string		_RESIZE("ds:resize");
 }
 
 const std::string&		CIRCLE_MASK(_CIRCLE_MASK);
+const std::string&		PREMULTIPLY(_PREMULTIPLY);
+const std::string&		DESATURATE(_DESATURATE);
+const std::string&		BLUR(_BLUR);
+const std::string&		RESIZE(_RESIZE);
 
 } // namespace ip
 } // namespace ui
@@ -12,6 +12,14 @@ namespace ip {
 
 // Make everything outside the largest possible circle transparent.
 extern const std::string&	CIRCLE_MASK;
+// Multiply the colour channels by alpha.
+extern const std::string&	PREMULTIPLY;
+// Blend toward grey. Parameter is the amount, 0 - 1.
+extern const std::string&	DESATURATE;
+// Box blur. Parameters are "radius,passes"; 3 passes is close to a gaussian.
+extern const std::string&	BLUR;
+// Shrink so neither side is larger than the parameter.
+extern const std::string&	RESIZE;
 
 } // namespace ip
 } // namespace ui
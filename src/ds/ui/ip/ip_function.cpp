@@ -1,5 +1,7 @@
 #include "ds/ui/ip/ip_function.h"
 
+#include "ds/ui/ip/ip_tile_runner.h"
+
 namespace ds {
 namespace ui {
 namespace ip {
@@ -13,6 +15,10 @@ Function::Function() {
 Function::~Function() {
 }
 
+void Function::onTiles(const std::string& parameters, ci::Surface8u& s, TileRunner&) const {
+	on(parameters, s);
+}
+
 /**
  * \class ds::ui::ip::Function
  */
@@ -27,16 +33,24 @@ FunctionRef::FunctionRef(Function* fn) {
 	mFn.reset(fn);
 }
 
+FunctionRef::FunctionRef(const FunctionRef& o, const std::shared_ptr<TileRunner>& runner)
+		: mFn(o.mFn)
+		, mRunner(runner) {
+}
+
 bool FunctionRef::empty() const {
 	return !mFn;
 }
 
 void FunctionRef::clear() {
 	mFn.reset();
+	mRunner.reset();
 }
 
 void FunctionRef::on(const std::string& parameters, ci::Surface8u& s) const {
-	if (mFn) mFn->on(parameters, s);
+	if (!mFn) return;
+	if (mRunner) mFn->onTiles(parameters, s, *(mRunner.get()));
+	else mFn->on(parameters, s);
 }
 
 } // namespace ip
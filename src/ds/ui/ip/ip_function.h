@@ -2,11 +2,13 @@
 #ifndef DS_UI_IP_IPFUNCTION_H_
 #define DS_UI_IP_IPFUNCTION_H_
 
+#include <memory>
 #include <cinder/Surface.h>
 
 namespace ds {
 namespace ui {
 namespace ip {
+class TileRunner;
 
 /**
  * \class ds::ui::ip::Function
@@ -19,6 +21,9 @@ public:
 	// Parameters can be anything. It's up to the application to
 	// decide an appropriate format for this function.
 	virtual void				on(const std::string& parameters, ci::Surface8u&) const = 0;
+	// Functions that can split their work into bands of rows should override
+	// this and hand the bands to the runner. By default it just calls on().
+	virtual void				onTiles(const std::string& parameters, ci::Surface8u&, TileRunner&) const;
 
 protected:
 	Function();
@@ -35,6 +40,8 @@ public:
 	explicit FunctionRef(const std::shared_ptr<Function>&);
 	// Must supply a raw, unmanaged pointer (and you are relinquishing ownership).
 	explicit FunctionRef(Function*);
+	// The same function, run on the runner's threads.
+	FunctionRef(const FunctionRef&, const std::shared_ptr<TileRunner>&);
 	
 	bool						empty() const;
 	void						clear();
@@ -45,6 +52,7 @@ public:
 
 private:
 	std::shared_ptr<Function>	mFn;
+	std::shared_ptr<TileRunner>	mRunner;
 };
 
 } // namespace ip
@@ -1,5 +1,7 @@
 #include "ds/ui/ip/ip_function_list.h"
 
+#include "ds/ui/ip/ip_tile_runner.h"
+
 namespace ds {
 namespace ui {
 namespace ip {
@@ -10,12 +12,18 @@ namespace ip {
 FunctionList::FunctionList() {
 }
 
+void FunctionList::setThreadCount(const int count) {
+	if (count > 0) mRunner.reset(new TileRunner(count));
+	else mRunner.reset();
+}
+
 FunctionRef FunctionList::find(const std::string& key) const {
 	if (key.empty()) return FunctionRef();
 	if (mFunctions.empty()) return FunctionRef();
 
 	auto f = mFunctions.find(key);
 	if (f == mFunctions.end()) return FunctionRef();
+	if (mRunner) return FunctionRef(f->second, mRunner);
 	return f->second;
 }
 
@@ -2,6 +2,7 @@
 #ifndef DS_UI_IP_IPFUNCTIONLIST_H_
 #define DS_UI_IP_IPFUNCTIONLIST_H_
 
+#include <memory>
 #include <unordered_map>
 #include "ip_function.h"
 
@@ -16,6 +17,11 @@ class FunctionList {
 public:
 	FunctionList();
 
+	// Functions that support it split large images across this many
+	// threads (plus the caller). 0 runs them on the caller only. Set it
+	// before any functions are found.
+	void				setThreadCount(const int);
+
 	FunctionRef			find(const std::string& key) const;
 
 	void				add(const std::string& key, const FunctionRef&);
@@ -23,6 +29,8 @@ public:
 private:
 	std::unordered_map<std::string, FunctionRef>
 						mFunctions;
+	std::shared_ptr<TileRunner>
+						mRunner;
 };
 
 } // namespace ip
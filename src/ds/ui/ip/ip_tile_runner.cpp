@@ -0,0 +1,136 @@
+#include "ds/ui/ip/ip_tile_runner.h"
+
+#include <vector>
+#include <Poco/Mutex.h>
+#include <Poco/Runnable.h>
+#include <Poco/Semaphore.h>
+#include "ds/debug/logger.h"
+
+namespace ds {
+namespace ui {
+namespace ip {
+
+namespace {
+// Split into a few more bands than threads, so a slow band doesn't leave everyone waiting.
+const int32_t				BANDS_PER_THREAD = 4;
+}
+
+/**
+ * \class ds::ui::ip::TileRunner::Job
+ * \brief The state for a single run(), shared by everyone working on it.
+ */
+class TileRunner::Job {
+public:
+	Job(const int32_t rows, const int32_t band_rows, const RowFunction& fn, const int helpers)
+			: mRows(rows)
+			, mBandRows(band_rows)
+			, mFn(fn)
+			, mNext(0)
+			, mHelpersDone(0, helpers > 0 ? helpers : 1) {
+	}
+
+	// Run bands until there are none left.
+	void					work() {
+		while (true) {
+			int32_t			y0;
+			{
+				Poco::FastMutex::ScopedLock		l(mMutex);
+				if (mNext >= mRows) return;
+				y0 = mNext;
+				mNext += mBandRows;
+			}
+			mFn(y0, (y0 + mBandRows < mRows ? y0 + mBandRows : mRows));
+		}
+	}
+
+	const int32_t			mRows,
+							mBandRows;
+	const RowFunction&		mFn;
+	Poco::FastMutex			mMutex;
+	int32_t					mNext;
+	// Set once by each helper as it finishes.
+	Poco::Semaphore			mHelpersDone;
+};
+
+/**
+ * \class ds::ui::ip::TileRunner::Helper
+ */
+class TileRunner::Helper : public Poco::Runnable {
+public:
+	Helper()
+			: mJob(nullptr) {
+	}
+
+	virtual void			run() {
+		try {
+			mJob->work();
+		} catch (std::exception const& ex) {
+			DS_LOG_WARNING("ip::TileRunner band failed (" << ex.what() << ")");
+		}
+		mJob->mHelpersDone.set();
+	}
+
+	Job*					mJob;
+};
+
+/**
+ * \class ds::ui::ip::TileRunner
+ */
+TileRunner::TileRunner(const int threads)
+		: mThreadCount(threads > 0 ? threads : 0) {
+	if (mThreadCount < 1) return;
+	try {
+		mPool.reset(new Poco::ThreadPool(mThreadCount, mThreadCount));
+	} catch (std::exception const& ex) {
+		DS_LOG_WARNING("ip::TileRunner can't start threads, running serially (" << ex.what() << ")");
+	}
+}
+
+TileRunner::~TileRunner() {
+	if (mPool) mPool->joinAll();
+}
+
+int TileRunner::getThreadCount() const {
+	return mPool ? mThreadCount : 0;
+}
+
+void TileRunner::run(const int32_t rows, const RowFunction& fn, const int32_t min_rows) {
+	if (rows < 1) return;
+	const int32_t			band_min = (min_rows > 0 ? min_rows : 1);
+	// Not worth splitting
+	if (!mPool || rows < band_min * 2) {
+		fn(0, rows);
+		return;
+	}
+
+	int32_t					bands = (mThreadCount + 1) * BANDS_PER_THREAD;
+	if (bands > rows / band_min) bands = rows / band_min;
+	const int32_t			band_rows = (rows + bands - 1) / bands;
+	const int				wanted = (bands - 1 < mThreadCount ? bands - 1 : mThreadCount);
+
+	Job						job(rows, band_rows, fn, wanted);
+	std::vector<Helper>		helpers(wanted);
+	int						started = 0;
+	for (; started<wanted; ++started) {
+		helpers[started].mJob = &job;
+		try {
+			mPool->start(helpers[started]);
+		} catch (std::exception const&) {
+			// The pool is busy with someone else's work; I'll do the rest myself.
+			break;
+		}
+	}
+
+	// The helpers refer to the job, so they have to be done before it goes away.
+	try {
+		job.work();
+	} catch (...) {
+		for (int k=0; k<started; ++k) job.mHelpersDone.wait();
+		throw;
+	}
+	for (int k=0; k<started; ++k) job.mHelpersDone.wait();
+}
+
+} // namespace ip
+} // namespace ui
+} // namespace ds
@@ -0,0 +1,52 @@
+#pragma once
+#ifndef DS_UI_IP_IPTILERUNNER_H_
+#define DS_UI_IP_IPTILERUNNER_H_
+
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <Poco/ThreadPool.h>
+
+namespace ds {
+namespace ui {
+namespace ip {
+
+/**
+ * \class ds::ui::ip::TileRunner
+ * \brief Split image processing into bands of rows and run them on a
+ * small pool of threads as well as the calling thread. Any number of
+ * threads can call run() at once; when the pool is busy the bands just
+ * run on the caller, so a decode thread never waits on anyone else's work.
+ */
+class TileRunner {
+public:
+	typedef std::function<void(const int32_t y0, const int32_t y1)>
+								RowFunction;
+
+	// 0 threads runs everything on the caller.
+	TileRunner(const int threads = 0);
+	~TileRunner();
+
+	int							getThreadCount() const;
+
+	// Call fn(y0, y1) on bands of at least min_rows that together cover
+	// [0, rows). Answer once every band is done. fn must be thread safe.
+	void						run(const int32_t rows, const RowFunction& fn, const int32_t min_rows = 32);
+
+private:
+	TileRunner(const TileRunner&);
+	TileRunner&					operator=(const TileRunner&);
+
+	class Job;
+	class Helper;
+
+	const int					mThreadCount;
+	std::unique_ptr<Poco::ThreadPool>
+								mPool;
+};
+
+} // namespace ip
+} // namespace ui
+} // namespace ds
+
+#endif
@@ -0,0 +1,323 @@
+#include "ds/ui/service/font_service.h"
+
+#include <map>
+#include <stdexcept>
+#include "ds/debug/logger.h"
+
+namespace {
+const ds::BitMask	FONT_LOG_M = ds::Logger::newModule("font");
+const int			MAX_INPUT_AVAILABLE = 0x7fffffff;
+// Rough cost of a cached character measurement, including the hash node.
+const size_t		MEASURE_BYTES = sizeof(OGLFT::BBox) + 32;
+// Creating or destroying a face goes through the one FreeType library, which isn't thread safe.
+Poco::Mutex			LOAD_MUTEX;
+}
+
+namespace ds {
+namespace ui {
+
+/**
+ * \class ds::ui::FontKey
+ */
+FontKey::FontKey()
+		: mSize(0.0f) {
+}
+
+FontKey::FontKey(const std::string& filename, const float size)
+		: mFilename(filename)
+		, mSize(size) {
+}
+
+bool FontKey::operator==(const FontKey& o) const {
+	return mSize == o.mSize && mFilename == o.mFilename;
+}
+
+/**
+ * \class ds::ui::FontService
+ */
+FontService::FontService()
+		: mThreadCount(0)
+		, mStarted(false)
+		, mStopping(false)
+		, mInputAvailable(0, MAX_INPUT_AVAILABLE) {
+}
+
+FontService::~FontService() {
+	stopThreads();
+	clear();
+}
+
+void FontService::setThreadCount(const int count) {
+	if (mStarted) return;
+	mThreadCount = (count > 0 ? count : 0);
+}
+
+void FontService::setCacheBudget(const size_t bytes) {
+	Poco::Mutex::ScopedLock		l(mMutex);
+	mCache.setBudget(bytes);
+}
+
+FontPtr FontService::get(const std::string& filename, const float size) {
+	return fetch(FontKey(filename, size), true, false);
+}
+
+void FontService::preload(const std::string& filename, const float size) {
+	if (filename.empty() || size <= 0.0f) return;
+
+	const FontKey				key(filename, size);
+	startThreads();
+	if (mThreads.empty()) {
+		try {
+			fetch(key, false, true);
+		} catch (std::exception const& ex) {
+			DS_LOG_WARNING_M("FontService::preload() " << ex.what(), FONT_LOG_M);
+		}
+		return;
+	}
+	{
+		Poco::Mutex::ScopedLock	l(mMutex);
+		if (mFonts.find(key) != mFonts.end()) return;
+		mInput.push_back(key);
+	}
+	mInputAvailable.set();
+}
+
+ImageCache<FontKey>::Stats FontService::getCacheStats() const {
+	Poco::Mutex::ScopedLock		l(mMutex);
+	return mCache.getStats();
+}
+
+std::vector<FontService::FaceStats> FontService::getFaceStats() const {
+	std::map<std::string, FaceStats>	faces;
+	{
+		Poco::Mutex::ScopedLock			l(mMutex);
+		for (auto it=mFonts.begin(), end=mFonts.end(); it!=end; ++it) {
+			FaceStats&					s = faces[it->first.mFilename];
+			OGLFT::Translucent&			font = *(it->second.mFont);
+			s.mFilename = it->first.mFilename;
+			++s.mSizes;
+			if (it->second.mPinned) ++s.mSizesInUse;
+			s.mGlyphs += font.compiledGlyphCount();
+			s.mBytes += getBytes(font);
+			s.mFileBytes += font.fileSize();
+		}
+	}
+	std::vector<FaceStats>				ans;
+	ans.reserve(faces.size());
+	for (auto it=faces.begin(), end=faces.end(); it!=end; ++it) ans.push_back(it->second);
+	return ans;
+}
+
+void FontService::update() {
+	// Destroyed after the lock is released, here on the main thread.
+	std::vector<FontPtr>		evicted;
+	{
+		Poco::Mutex::ScopedLock	l(mMutex);
+		for (auto it=mFonts.begin(), end=mFonts.end(); it!=end; ++it) {
+			Holder&				h = it->second;
+			// Anyone besides me holding a font is using it.
+			const bool			pinned = !h.mFont.unique();
+			if (pinned) {
+				// Only fonts in use are drawn, so only they can grow.
+				const size_t	bytes = getBytes(*(h.mFont));
+				if (bytes != h.mBytes) {
+					h.mBytes = bytes;
+					mCache.add(it->first, bytes, true);
+					h.mPinned = true;
+				}
+			}
+			if (pinned != h.mPinned) {
+				h.mPinned = pinned;
+				mCache.setPinned(it->first, pinned);
+			}
+		}
+
+		FontKey					key;
+		while (mCache.popEviction(key)) {
+			auto				found = mFonts.find(key);
+			if (found == mFonts.end()) continue;
+			evicted.push_back(found->second.mFont);
+			mFonts.erase(found);
+		}
+	}
+	release(evicted);
+}
+
+void FontService::clear() {
+	std::vector<FontPtr>		fonts;
+	{
+		Poco::Mutex::ScopedLock	l(mMutex);
+		mInput.clear();
+		fonts.reserve(mFonts.size());
+		for (auto it=mFonts.begin(), end=mFonts.end(); it!=end; ++it) fonts.push_back(it->second.mFont);
+		mFonts.clear();
+		mCache.clear();
+	}
+	release(fonts);
+}
+
+FontPtr FontService::fetch(const FontKey& key, const bool pin, const bool warm) {
+	FontPtr						font = find(key, pin);
+	if (font) return font;
+
+	{
+		Poco::Mutex::ScopedLock	l(LOAD_MUTEX);
+		// Someone else might have loaded it while I was waiting.
+		font = find(key, pin);
+		if (font) return font;
+
+		font = FontPtr(new OGLFT::Translucent(key.mFilename.c_str(), key.mSize));
+		if (!font->isValid()) {
+			font.reset();
+			throw std::runtime_error("Font: " + key.mFilename + " was unable to load.");
+		}
+		font->setCompileMode(OGLFT::Face::COMPILE);
+	}
+
+	// Measuring only touches this face, so it doesn't need the library.
+	if (warm) {
+		OGLFT::BBox				bbox;
+		for (wchar_t c=32; c<256; ++c) font->measureRawChar(c, bbox);
+	}
+	return add(key, font, pin);
+}
+
+FontPtr FontService::find(const FontKey& key, const bool pin) {
+	Poco::Mutex::ScopedLock		l(mMutex);
+	auto						found = mFonts.find(key);
+	if (found == mFonts.end()) return FontPtr();
+
+	Holder&						h = found->second;
+	if (pin && !h.mPinned) {
+		h.mPinned = true;
+		mCache.setPinned(key, true);
+	}
+	mCache.recordHit();
+	return h.mFont;
+}
+
+FontPtr FontService::add(const FontKey& key, const FontPtr& font, const bool pin) {
+	Poco::Mutex::ScopedLock		l(mMutex);
+	Holder&						h = mFonts[key];
+	// The duplicate has never been drawn, so it's safe to drop it on any thread.
+	if (h.mFont) {
+		if (pin && !h.mPinned) {
+			h.mPinned = true;
+			mCache.setPinned(key, true);
+		}
+		return h.mFont;
+	}
+
+	h.mFont = font;
+	h.mBytes = getBytes(*font);
+	h.mPinned = pin;
+	mCache.recordMiss();
+	mCache.add(key, h.mBytes, pin);
+	return font;
+}
+
+bool FontService::loadNext() {
+	FontKey						key;
+	{
+		Poco::Mutex::ScopedLock	l(mMutex);
+		if (mStopping || mInput.empty()) return false;
+		key = mInput.back();
+		mInput.pop_back();
+	}
+	try {
+		fetch(key, false, true);
+	} catch (std::exception const& ex) {
+		DS_LOG_WARNING_M("FontService can't preload (" << ex.what() << ")", FONT_LOG_M);
+	}
+	return true;
+}
+
+void FontService::startThreads() {
+	if (mStarted) return;
+	mStarted = true;
+	if (mThreadCount < 1) return;
+
+	try {
+		mWorker.reset(new Worker(*this));
+		mThreads.reserve(mThreadCount);
+		for (int k=0; k<mThreadCount; ++k) {
+			std::unique_ptr<Poco::Thread>	t(new Poco::Thread("ds_font"));
+			t->setPriority(Poco::Thread::PRIO_LOW);
+			t->start(*(mWorker.get()));
+			mThreads.push_back(std::move(t));
+		}
+	} catch (std::exception const& ex) {
+		DS_LOG_WARNING_M("FontService can't start preload threads (" << ex.what() << ")", FONT_LOG_M);
+	}
+}
+
+void FontService::stopThreads() {
+	if (mThreads.empty()) return;
+	{
+		Poco::Mutex::ScopedLock		l(mMutex);
+		mStopping = true;
+		mInput.clear();
+	}
+	try {
+		for (size_t k=0; k<mThreads.size(); ++k) mInputAvailable.set();
+		for (auto it=mThreads.begin(), end=mThreads.end(); it!=end; ++it) (*it)->join();
+	} catch (std::exception const&) {
+	}
+	mThreads.clear();
+}
+
+void FontService::release(std::vector<FontPtr>& fonts) {
+	if (fonts.empty()) return;
+	Poco::Mutex::ScopedLock		l(LOAD_MUTEX);
+	fonts.clear();
+}
+
+size_t FontService::getBytes(OGLFT::Translucent& font) {
+	// Each compiled glyph keeps a luminance-alpha bitmap of about an em square.
+	const size_t				ppem = static_cast<size_t>(font.pointSize() * static_cast<float>(font.resolution()) / 72.0f + 0.5f);
+	return sizeof(OGLFT::Translucent)
+			+ font.compiledGlyphCount() * ppem * ppem * 2
+			+ font.measuredCharCount() * MEASURE_BYTES;
+}
+
+/**
+ * \class ds::ui::FontService::FaceStats
+ */
+FontService::FaceStats::FaceStats()
+		: mSizes(0)
+		, mSizesInUse(0)
+		, mGlyphs(0)
+		, mBytes(0)
+		, mFileBytes(0) {
+}
+
+/**
+ * \class ds::ui::FontService::Holder
+ */
+FontService::Holder::Holder()
+		: mBytes(0)
+		, mPinned(false) {
+}
+
+/**
+ * \class ds::ui::FontService::Worker
+ */
+FontService::Worker::Worker(FontService& owner)
+		: mOwner(owner) {
+}
+
+void FontService::Worker::run() {
+	while (true) {
+		// One set() per input, so there might be nothing left when I wake up.
+		mOwner.mInputAvailable.wait();
+		{
+			Poco::Mutex::ScopedLock		l(mOwner.mMutex);
+			if (mOwner.mStopping) return;
+		}
+		while (mOwner.loadNext()) {
+		}
+	}
+}
+
+} // namespace ui
+} // namespace ds
@@ -0,0 +1,153 @@
+#pragma once
+#ifndef DS_UI_SERVICE_FONTSERVICE_H_
+#define DS_UI_SERVICE_FONTSERVICE_H_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <Poco/Mutex.h>
+#include <Poco/Runnable.h>
+#include <Poco/Semaphore.h>
+#include <Poco/Thread.h>
+#include "ds/ui/service/image_cache.h"
+#include "ds/ui/sprite/text_layout.h"
+
+namespace ds {
+namespace ui {
+
+/**
+ * \class ds::ui::FontKey
+ * \brief Internal class that acts as a key for a cached font.
+ */
+class FontKey {
+public:
+	FontKey();
+	FontKey(const std::string& filename, const float size);
+
+	bool					operator==(const FontKey&) const;
+
+	std::string				mFilename;
+	float					mSize;
+};
+
+} // namespace ui
+} // namespace ds
+
+// Make the FontKey available for hashing functions
+namespace std {
+	template<>
+	struct hash<ds::ui::FontKey> : public unary_function<ds::ui::FontKey, size_t> {
+		size_t operator()(const ds::ui::FontKey& id) const {
+			return std::hash<std::string>()(id.mFilename) ^ (std::hash<float>()(id.mSize) << 1);
+		}
+	};
+}
+
+namespace ds {
+namespace ui {
+
+/**
+ * \class ds::ui::FontService
+ * \brief The engine's fonts, one for each file and size. Anyone holding a
+ * FontPtr keeps that size alive; sizes nobody holds are evicted, least
+ * recently released first, once the cache is over budget. Fonts can be
+ * preloaded on threads of my own. get() can be called from any thread,
+ * everything else is main thread only (fonts that have been drawn own GL
+ * display lists, so they're only ever destroyed in update() and clear()).
+ */
+class FontService {
+public:
+	// What a single font file is holding, across all its sizes.
+	class FaceStats {
+	public:
+		FaceStats();
+
+		std::string			mFilename;
+		int					mSizes,
+							mSizesInUse;
+		// Glyphs compiled into display lists
+		size_t				mGlyphs;
+		// Estimated memory for the glyphs and measurements
+		size_t				mBytes;
+		// Size of the font file, for each size that has it open
+		size_t				mFileBytes;
+	};
+
+public:
+	FontService();
+	~FontService();
+
+	// Preload on this many threads of my own. 0 loads preloads right away, on
+	// the caller's thread. Only applies before the first preload.
+	void					setThreadCount(const int);
+	// Unused sizes are evicted to keep the estimated total under this many
+	// bytes. 0 is unlimited.
+	void					setCacheBudget(const size_t bytes);
+
+	// Answer the font, loading it if no one has. Throws if the font can't be loaded.
+	FontPtr					get(const std::string& filename, const float size);
+	// Load the font in the background, so a later get() doesn't have to.
+	void					preload(const std::string& filename, const float size);
+
+	ImageCache<FontKey>::Stats
+							getCacheStats() const;
+	std::vector<FaceStats>	getFaceStats() const;
+
+	// Update pins and evict. Call once per frame.
+	void					update();
+	void					clear();
+
+private:
+	class Worker : public Poco::Runnable {
+	public:
+		Worker(FontService&);
+		virtual void		run();
+
+	private:
+		FontService&		mOwner;
+	};
+
+	// Answer the cached font, loading it if needed. Pinned fonts are about to be
+	// held by the caller. Warmed fonts have their Latin-1 measurements cached.
+	FontPtr					fetch(const FontKey&, const bool pin, const bool warm);
+	// Answer the cached font, or empty.
+	FontPtr					find(const FontKey&, const bool pin);
+	// Add the font to the cache, unless someone beat me to it, and answer the cached one.
+	FontPtr					add(const FontKey&, const FontPtr&, const bool pin);
+	// Load the next preload. Answer false if there was none.
+	bool					loadNext();
+	void					startThreads();
+	void					stopThreads();
+	// Destroy the fonts, holding the FreeType library.
+	static void				release(std::vector<FontPtr>&);
+	static size_t			getBytes(OGLFT::Translucent&);
+
+	class Holder {
+	public:
+		Holder();
+
+		FontPtr				mFont;
+		size_t				mBytes;
+		bool				mPinned;
+	};
+
+	mutable Poco::Mutex		mMutex;
+	std::unordered_map<FontKey, Holder>
+							mFonts;
+	ImageCache<FontKey>		mCache;
+	std::vector<FontKey>	mInput;
+
+	int						mThreadCount;
+	bool					mStarted,
+							mStopping;
+	std::unique_ptr<Worker>	mWorker;
+	std::vector<std::unique_ptr<Poco::Thread>>
+							mThreads;
+	Poco::Semaphore			mInputAvailable;
+};
+
+} // namespace ui
+} // namespace ds
+
+#endif // DS_UI_SERVICE_FONTSERVICE_H_
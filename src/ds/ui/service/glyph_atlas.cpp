@@ -0,0 +1,272 @@
+#include "ds/ui/service/glyph_atlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include "ds/debug/logger.h"
+
+namespace ds {
+namespace ui {
+
+namespace {
+// Empty pixels between glyphs, so filtering never picks up a neighbour.
+const int					PADDING = 1;
+const int					BYTES_PER_PIXEL = 2;
+}
+
+/**
+ * \class ds::ui::GlyphQuad
+ */
+GlyphQuad::GlyphQuad()
+		: mPage(-1) {
+}
+
+/**
+ * \class ds::ui::GlyphAtlas
+ */
+GlyphAtlas::GlyphAtlas(const int page_size, const int resolution)
+		: mPageSize(page_size > 64 ? page_size : 64)
+		, mResolution(resolution > 0 ? resolution : 100)
+		, mLibrary(nullptr)
+		, mGlyphCount(0) {
+	FT_Library				lib = nullptr;
+	if (FT_Init_FreeType(&lib) != 0) {
+		DS_LOG_WARNING("GlyphAtlas can't start FreeType");
+		return;
+	}
+	mLibrary = lib;
+}
+
+GlyphAtlas::~GlyphAtlas() {
+	for (auto it=mFonts.begin(), end=mFonts.end(); it!=end; ++it) {
+		if (it->mFace) FT_Done_Face(it->mFace);
+	}
+	if (mLibrary) FT_Done_FreeType(mLibrary);
+}
+
+int GlyphAtlas::getFont(const std::string& filename, const float size) {
+	std::stringstream		buf;
+	buf << size << ":" << filename;
+	const std::string		key = buf.str();
+	auto					found = mFontIds.find(key);
+	if (found != mFontIds.end()) return found->second;
+
+	// Failures are remembered too, so a bad font isn't opened every frame.
+	int						id = -1;
+	FT_Face					face = nullptr;
+	if (mLibrary && size > 0.0f && FT_New_Face(mLibrary, filename.c_str(), 0, &face) == 0) {
+		if (FT_Set_Char_Size(face, static_cast<FT_F26Dot6>(size * 64), static_cast<FT_F26Dot6>(size * 64), mResolution, mResolution) == 0) {
+			id = static_cast<int>(mFonts.size());
+			mFonts.push_back(Font());
+			mFonts.back().mFace = face;
+		} else {
+			FT_Done_Face(face);
+		}
+	}
+	if (id < 0) DS_LOG_WARNING("GlyphAtlas can't load font " << filename << " at size " << size);
+	mFontIds[key] = id;
+	return id;
+}
+
+const GlyphAtlas::Glyph* GlyphAtlas::getGlyph(const int font, const wchar_t c) {
+	if (font < 0 || font >= static_cast<int>(mFonts.size())) return nullptr;
+	Font&					f = mFonts[font];
+	auto					found = f.mGlyphs.find(c);
+	if (found == f.mGlyphs.end()) {
+		Glyph				g;
+		// A glyph that can't be rendered is left with no advance, and isn't tried again.
+		if (!rasterize(f, c, g)) g.mAdvance = -1.0f;
+		found = f.mGlyphs.insert(std::pair<wchar_t, Glyph>(c, g)).first;
+	}
+	if (found->second.mAdvance < 0.0f) return nullptr;
+	return &found->second;
+}
+
+float GlyphAtlas::layout(	const int font, const std::wstring& text, const float x, const float y,
+							std::vector<GlyphQuad>& out) {
+	const size_t			first = out.size();
+	const float				page_size = static_cast<float>(mPageSize);
+	float					pen = 0.0f,
+							ink_left = 0.0f,
+							ink_right = 0.0f;
+	bool					has_ink = false;
+	for (auto it=text.begin(), end=text.end(); it!=end; ++it) {
+		const Glyph*		g = getGlyph(font, *it);
+		if (!g) continue;
+		if (g->mPage >= 0) {
+			// Glyphs land on whole pixels, the way glDrawPixels places them.
+			const float		left = floorf(pen + 0.5f) + static_cast<float>(g->mLeft);
+			const float		top = -static_cast<float>(g->mTop);
+			GlyphQuad		q;
+			q.mPage = g->mPage;
+			q.mRect = ci::Rectf(left, top, left + static_cast<float>(g->mW), top + static_cast<float>(g->mH));
+			q.mUv = ci::Rectf(	static_cast<float>(g->mX) / page_size, static_cast<float>(g->mY) / page_size,
+								static_cast<float>(g->mX + g->mW) / page_size, static_cast<float>(g->mY + g->mH) / page_size);
+			out.push_back(q);
+			if (!has_ink || q.mRect.x1 < ink_left) ink_left = q.mRect.x1;
+			if (!has_ink || q.mRect.x2 > ink_right) ink_right = q.mRect.x2;
+			has_ink = true;
+		}
+		pen += g->mAdvance;
+	}
+
+	// Move everything so the ink starts at x, on the baseline at y.
+	const float				dx = floorf(x + 0.5f) - ink_left,
+							dy = floorf(y + 0.5f);
+	for (auto it=out.begin()+first, end=out.end(); it!=end; ++it) {
+		it->mRect.offset(ci::Vec2f(dx, dy));
+	}
+	return ink_right + dx;
+}
+
+int GlyphAtlas::getPageSize() const {
+	return mPageSize;
+}
+
+size_t GlyphAtlas::getPageCount() const {
+	return mPages.size();
+}
+
+const uint8_t* GlyphAtlas::getPixels(const size_t page) const {
+	if (page >= mPages.size()) return nullptr;
+	return &mPages[page].mPixels[0];
+}
+
+bool GlyphAtlas::takeDirty(const size_t page, int& y0, int& y1) {
+	if (page >= mPages.size()) return false;
+	Page&					p = mPages[page];
+	if (p.mDirtyY1 <= p.mDirtyY0) return false;
+	y0 = p.mDirtyY0;
+	y1 = p.mDirtyY1;
+	p.mDirtyY0 = mPageSize;
+	p.mDirtyY1 = 0;
+	return true;
+}
+
+GlyphAtlas::Stats GlyphAtlas::getStats() const {
+	Stats					s;
+	s.mFonts = mFonts.size();
+	s.mGlyphs = mGlyphCount;
+	s.mPages = mPages.size();
+	s.mBytes = mPages.size() * static_cast<size_t>(mPageSize) * mPageSize * BYTES_PER_PIXEL;
+	return s;
+}
+
+bool GlyphAtlas::rasterize(Font& f, const wchar_t c, Glyph& g) {
+	FT_Face					face = f.mFace;
+	if (!face) return false;
+	const FT_UInt			index = FT_Get_Char_Index(face, static_cast<FT_ULong>(c));
+	if (index == 0) return false;
+	if (FT_Load_Glyph(face, index, FT_LOAD_DEFAULT) != 0) return false;
+	if (FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL) != 0) return false;
+
+	const FT_GlyphSlot		slot = face->glyph;
+	const FT_Bitmap&		bm = slot->bitmap;
+	g.mAdvance = static_cast<float>(slot->advance.x) / 64.0f;
+	g.mLeft = slot->bitmap_left;
+	g.mTop = slot->bitmap_top;
+	g.mW = bm.width;
+	g.mH = bm.rows;
+	if (g.mW < 1 || g.mH < 1) {
+		g.mPage = -1;
+		return true;
+	}
+	if (bm.pixel_mode != FT_PIXEL_MODE_GRAY) return false;
+	if (!pack(g.mW, g.mH, g.mPage, g.mX, g.mY)) return false;
+
+	Page&					page = mPages[g.mPage];
+	for (int y=0; y<g.mH; ++y) {
+		const uint8_t*		src = bm.buffer + y * bm.pitch;
+		uint8_t*			dst = &page.mPixels[((g.mY + y) * mPageSize + g.mX) * BYTES_PER_PIXEL];
+		for (int x=0; x<g.mW; ++x) {
+			*dst++ = 255;
+			*dst++ = *src++;
+		}
+	}
+	page.mDirtyY0 = std::min(page.mDirtyY0, g.mY);
+	page.mDirtyY1 = std::max(page.mDirtyY1, g.mY + g.mH);
+	++mGlyphCount;
+	return true;
+}
+
+bool GlyphAtlas::pack(const int w, const int h, int& out_page, int& out_x, int& out_y) {
+	const int				pw = w + PADDING, ph = h + PADDING;
+	if (pw > mPageSize || ph > mPageSize) return false;
+
+	// Only the last page has room; earlier pages are full.
+	if (!mPages.empty()) {
+		Page&				p = mPages.back();
+		if (p.mShelfX + pw > mPageSize) {
+			p.mShelfY += p.mShelfH;
+			p.mShelfX = 0;
+			p.mShelfH = 0;
+		}
+		if (p.mShelfY + ph <= mPageSize) {
+			out_page = static_cast<int>(mPages.size() - 1);
+			out_x = p.mShelfX;
+			out_y = p.mShelfY;
+			p.mShelfX += pw;
+			p.mShelfH = std::max(p.mShelfH, ph);
+			return true;
+		}
+	}
+
+	mPages.push_back(Page(mPageSize));
+	Page&					p = mPages.back();
+	out_page = static_cast<int>(mPages.size() - 1);
+	out_x = 0;
+	out_y = 0;
+	p.mShelfX = pw;
+	p.mShelfH = ph;
+	return true;
+}
+
+/**
+ * \class ds::ui::GlyphAtlas::Glyph
+ */
+GlyphAtlas::Glyph::Glyph()
+		: mPage(-1)
+		, mX(0)
+		, mY(0)
+		, mW(0)
+		, mH(0)
+		, mLeft(0)
+		, mTop(0)
+		, mAdvance(0.0f) {
+}
+
+/**
+ * \class ds::ui::GlyphAtlas::Stats
+ */
+GlyphAtlas::Stats::Stats()
+		: mFonts(0)
+		, mGlyphs(0)
+		, mPages(0)
+		, mBytes(0) {
+}
+
+/**
+ * \class ds::ui::GlyphAtlas::Font
+ */
+GlyphAtlas::Font::Font()
+		: mFace(nullptr) {
+}
+
+/**
+ * \class ds::ui::GlyphAtlas::Page
+ */
+GlyphAtlas::Page::Page(const int size)
+		: mPixels(static_cast<size_t>(size) * size * BYTES_PER_PIXEL, 0)
+		, mShelfX(0)
+		, mShelfY(0)
+		, mShelfH(0)
+		, mDirtyY0(size)
+		, mDirtyY1(0) {
+	// White everywhere, so filtering at the glyph edges only fades the alpha.
+	for (size_t k=0, count=mPixels.size(); k<count; k+=BYTES_PER_PIXEL) mPixels[k] = 255;
+}
+
+} // namespace ui
+} // namespace ds
@@ -0,0 +1,130 @@
+#pragma once
+#ifndef DS_UI_SERVICE_GLYPHATLAS_H_
+#define DS_UI_SERVICE_GLYPHATLAS_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include <cinder/Rect.h>
+
+struct FT_LibraryRec_;
+struct FT_FaceRec_;
+
+namespace ds {
+namespace ui {
+
+/**
+ * \class ds::ui::GlyphQuad
+ * \brief One glyph, placed. The rect is in the text's coordinates, the
+ * uv is in its page, with the glyph's top row at uv.y1.
+ */
+class GlyphQuad {
+public:
+	GlyphQuad();
+
+	int						mPage;
+	ci::Rectf				mRect,
+							mUv;
+};
+
+/**
+ * \class ds::ui::GlyphAtlas
+ * \brief Rasterize glyphs with FreeType, once per font file and size, into
+ * shared pages of luminance-alpha pixels, and lay strings out as quads into
+ * those pages. Glyphs are rasterized and placed the same way the OGLFT
+ * Translucent fonts draw them. This is only the CPU side, so it works
+ * without a GL context; the GlyphAtlasService puts the pages on the card.
+ * Not thread safe.
+ */
+class GlyphAtlas {
+public:
+	class Glyph {
+	public:
+		Glyph();
+
+		// -1 for glyphs with no pixels (i.e. spaces)
+		int					mPage;
+		int					mX, mY,
+							mW, mH;
+		// Offset from the pen position to the top left of the bitmap, y up.
+		int					mLeft, mTop;
+		float				mAdvance;
+	};
+
+	class Stats {
+	public:
+		Stats();
+
+		size_t				mFonts;
+		size_t				mGlyphs;
+		size_t				mPages;
+		size_t				mBytes;
+	};
+
+public:
+	// resolution is in DPI, and should match the OGLFT fonts (which default to 100).
+	GlyphAtlas(const int page_size = 1024, const int resolution = 100);
+	~GlyphAtlas();
+
+	// Answer an id for the font, or -1 if it can't be loaded.
+	int						getFont(const std::string& filename, const float size);
+	// Answer nullptr if the font doesn't have the character or it's too big for a page.
+	const Glyph*			getGlyph(const int font, const wchar_t);
+
+	// Add the quads for a line of text, with the left edge of the ink at x
+	// and the baseline at y. Answer the right edge of the ink.
+	float					layout(	const int font, const std::wstring&, const float x, const float y,
+									std::vector<GlyphQuad>&);
+
+	int						getPageSize() const;
+	size_t					getPageCount() const;
+	// page_size * page_size pixels, 2 bytes each.
+	const uint8_t*			getPixels(const size_t page) const;
+	// Answer the rows that changed since the last call, if any.
+	bool					takeDirty(const size_t page, int& y0, int& y1);
+
+	Stats					getStats() const;
+
+private:
+	GlyphAtlas(const GlyphAtlas&);
+	GlyphAtlas&				operator=(const GlyphAtlas&);
+
+	class Font {
+	public:
+		Font();
+
+		FT_FaceRec_*		mFace;
+		std::unordered_map<wchar_t, Glyph>
+							mGlyphs;
+	};
+
+	// Shelf packed: glyphs fill rows left to right, and a new shelf starts
+	// below the tallest glyph in the current one.
+	class Page {
+	public:
+		Page(const int size);
+
+		std::vector<uint8_t>	mPixels;
+		int					mShelfX, mShelfY, mShelfH;
+		int					mDirtyY0, mDirtyY1;
+	};
+
+	bool					rasterize(Font&, const wchar_t, Glyph&);
+	// Find space for a w by h bitmap, adding a page if needed.
+	bool					pack(const int w, const int h, int& page, int& x, int& y);
+
+	const int				mPageSize;
+	const int				mResolution;
+	FT_LibraryRec_*			mLibrary;
+	std::vector<Font>		mFonts;
+	std::unordered_map<std::string, int>
+							mFontIds;
+	std::vector<Page>		mPages;
+	size_t					mGlyphCount;
+};
+
+} // namespace ui
+} // namespace ds
+
+#endif // DS_UI_SERVICE_GLYPHATLAS_H_
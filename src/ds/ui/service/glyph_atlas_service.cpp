@@ -0,0 +1,58 @@
+#include "ds/ui/service/glyph_atlas_service.h"
+
+namespace ds {
+namespace ui {
+
+namespace {
+const std::string			_GLYPH_ATLAS_SERVICE("ds:glyphatlas");
+}
+
+const std::string&			GLYPH_ATLAS_SERVICE(_GLYPH_ATLAS_SERVICE);
+
+/**
+ * \class ds::ui::GlyphAtlasService
+ */
+GlyphAtlasService::GlyphAtlasService(const bool enabled, const int page_size)
+		: mEnabled(enabled)
+		, mAtlas(page_size) {
+}
+
+bool GlyphAtlasService::isEnabled() const {
+	return mEnabled;
+}
+
+GlyphAtlas& GlyphAtlasService::getAtlas() {
+	return mAtlas;
+}
+
+const ci::gl::Texture& GlyphAtlasService::getTexture(const int page) {
+	if (page < 0 || page >= static_cast<int>(mAtlas.getPageCount())) return mEmpty;
+
+	const int				size = mAtlas.getPageSize();
+	int						y0, y1;
+	// New pages go up whole, after that only the rows with new glyphs.
+	while (static_cast<int>(mTextures.size()) <= page) {
+		const int			p = static_cast<int>(mTextures.size());
+		ci::gl::Texture::Format	fmt;
+		fmt.setTarget(GL_TEXTURE_2D);
+		fmt.setInternalFormat(GL_LUMINANCE_ALPHA);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		mTextures.push_back(ci::gl::Texture(mAtlas.getPixels(p), GL_LUMINANCE_ALPHA, size, size, fmt));
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		mAtlas.takeDirty(p, y0, y1);
+	}
+
+	ci::gl::Texture&		tex = mTextures[page];
+	if (tex && mAtlas.takeDirty(page, y0, y1)) {
+		tex.bind();
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y0, size, y1 - y0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE,
+						mAtlas.getPixels(page) + static_cast<size_t>(y0) * size * 2);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		tex.unbind();
+	}
+	return tex;
+}
+
+} // namespace ui
+} // namespace ds
@@ -0,0 +1,42 @@
+#pragma once
+#ifndef DS_UI_SERVICE_GLYPHATLASSERVICE_H_
+#define DS_UI_SERVICE_GLYPHATLASSERVICE_H_
+
+#include <vector>
+#include <cinder/gl/Texture.h>
+#include "ds/app/engine/engine_service.h"
+#include "ds/ui/service/glyph_atlas.h"
+
+namespace ds {
+namespace ui {
+
+extern const std::string&	GLYPH_ATLAS_SERVICE;
+
+/**
+ * \class ds::ui::GlyphAtlasService
+ * \brief The engine's shared GlyphAtlas, and a texture for each of its
+ * pages. Text sprites lay themselves out as quads into the atlas instead
+ * of rendering their own textures. Main thread only.
+ */
+class GlyphAtlasService : public ds::EngineService {
+public:
+	GlyphAtlasService(const bool enabled = true, const int page_size = 1024);
+
+	// When off, text sprites render their own textures.
+	bool					isEnabled() const;
+	GlyphAtlas&				getAtlas();
+	// Answer the texture for a page, with any new glyphs uploaded.
+	const ci::gl::Texture&	getTexture(const int page);
+
+private:
+	const bool				mEnabled;
+	GlyphAtlas				mAtlas;
+	std::vector<ci::gl::Texture>
+							mTextures;
+	const ci::gl::Texture	mEmpty;
+};
+
+} // namespace ui
+} // namespace ds
+
+#endif // DS_UI_SERVICE_GLYPHATLASSERVICE_H_
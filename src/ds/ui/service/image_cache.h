@@ -0,0 +1,183 @@
+#pragma once
+#ifndef DS_UI_SERVICE_IMAGECACHE_H_
+#define DS_UI_SERVICE_IMAGECACHE_H_
+
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <stdint.h>
+
+namespace ds {
+namespace ui {
+
+/**
+ * \class ds::ui::ImageCache
+ * \brief Byte accounting and eviction order for resident images. Nothing
+ * here knows about textures, it just tracks the size of each resident
+ * key. Pinned keys (the ones someone holds a reference to) are never
+ * evicted; unpinned keys sit in a least-recently-used list and are
+ * evicted oldest first whenever the total is over budget.
+ */
+template <typename Key>
+class ImageCache {
+public:
+	class Stats {
+	public:
+		Stats();
+
+		size_t					mResidentBytes;
+		size_t					mResidentCount;
+		uint64_t				mHits;
+		uint64_t				mMisses;
+		uint64_t				mEvictions;
+	};
+
+public:
+	// A budget of 0 is unlimited.
+	ImageCache(const size_t budget = 0);
+
+	void						setBudget(const size_t bytes);
+	size_t						getBudget() const;
+
+	// The key now has a resident image of the given size. Replaces any previous size.
+	void						add(const Key&, const size_t bytes, const bool pinned);
+	// The key's image is gone.
+	void						remove(const Key&);
+	// Unpinning a key makes it the most recently used.
+	void						setPinned(const Key&, const bool);
+	bool						contains(const Key&) const;
+
+	// If over budget, answer the next key to evict and stop tracking it.
+	bool						popEviction(Key&);
+
+	void						recordHit();
+	void						recordMiss();
+	const Stats&				getStats() const;
+
+	void						clear();
+
+private:
+	class Entry {
+	public:
+		Entry();
+
+		size_t					mBytes;
+		bool					mPinned;
+		// Only valid when not pinned
+		typename std::list<Key>::iterator
+								mLru;
+	};
+
+	size_t						mBudget;
+	std::unordered_map<Key, Entry>
+								mEntries;
+	// Front is the least recently used
+	std::list<Key>				mLru;
+	Stats						mStats;
+};
+
+/**
+ * implementation
+ */
+template <typename Key>
+ImageCache<Key>::ImageCache(const size_t budget)
+		: mBudget(budget) {
+}
+
+template <typename Key>
+void ImageCache<Key>::setBudget(const size_t bytes) {
+	mBudget = bytes;
+}
+
+template <typename Key>
+size_t ImageCache<Key>::getBudget() const {
+	return mBudget;
+}
+
+template <typename Key>
+void ImageCache<Key>::add(const Key& key, const size_t bytes, const bool pinned) {
+	remove(key);
+	Entry&						e = mEntries[key];
+	e.mBytes = bytes;
+	e.mPinned = true;
+	mStats.mResidentBytes += bytes;
+	++mStats.mResidentCount;
+	if (!pinned) setPinned(key, false);
+}
+
+template <typename Key>
+void ImageCache<Key>::remove(const Key& key) {
+	auto						it = mEntries.find(key);
+	if (it == mEntries.end()) return;
+	if (!it->second.mPinned) mLru.erase(it->second.mLru);
+	mStats.mResidentBytes -= it->second.mBytes;
+	--mStats.mResidentCount;
+	mEntries.erase(it);
+}
+
+template <typename Key>
+void ImageCache<Key>::setPinned(const Key& key, const bool pinned) {
+	auto						it = mEntries.find(key);
+	if (it == mEntries.end()) return;
+	Entry&						e = it->second;
+	if (!e.mPinned) mLru.erase(e.mLru);
+	e.mPinned = pinned;
+	if (!pinned) e.mLru = mLru.insert(mLru.end(), key);
+}
+
+template <typename Key>
+bool ImageCache<Key>::contains(const Key& key) const {
+	return mEntries.find(key) != mEntries.end();
+}
+
+template <typename Key>
+bool ImageCache<Key>::popEviction(Key& out) {
+	if (mBudget < 1 || mStats.mResidentBytes <= mBudget || mLru.empty()) return false;
+	out = mLru.front();
+	remove(out);
+	++mStats.mEvictions;
+	return true;
+}
+
+template <typename Key>
+void ImageCache<Key>::recordHit() {
+	++mStats.mHits;
+}
+
+template <typename Key>
+void ImageCache<Key>::recordMiss() {
+	++mStats.mMisses;
+}
+
+template <typename Key>
+const typename ImageCache<Key>::Stats& ImageCache<Key>::getStats() const {
+	return mStats;
+}
+
+template <typename Key>
+void ImageCache<Key>::clear() {
+	mEntries.clear();
+	mLru.clear();
+	mStats.mResidentBytes = 0;
+	mStats.mResidentCount = 0;
+}
+
+template <typename Key>
+ImageCache<Key>::Stats::Stats()
+		: mResidentBytes(0)
+		, mResidentCount(0)
+		, mHits(0)
+		, mMisses(0)
+		, mEvictions(0) {
+}
+
+template <typename Key>
+ImageCache<Key>::Entry::Entry()
+		: mBytes(0)
+		, mPinned(true) {
+}
+
+} // namespace ui
+} // namespace ds
+
+#endif // DS_UI_SERVICE_IMAGECACHE_H_
@@ -2,14 +2,34 @@
 
 #include <cinder/ImageIo.h>
 #include "ds/app/environment.h"
+#include "ds/cfg/settings.h"
 #include "ds/debug/debug_defines.h"
 #include "ds/debug/logger.h"
+#include "ds/ui/ip/functions/ip_downscale.h"
 #include "ds/ui/sprite/image.h"
 
 namespace {
 const ds::BitMask	LOAD_IMAGE_LOG_M = ds::Logger::newModule("load_image");
 // A mask of all the image flags that impact the key.
 const int			IMAGE_FLAGS_KEY_MASK(ds::ui::Image::IMG_CACHE_F);
+const int			MAX_INPUT_AVAILABLE = 0x7fffffff;
+
+class GlTextureAllocator : public ds::ui::ImageTextureAllocator {
+public:
+	virtual ci::gl::Texture		create(const ci::Surface8u& s, const int flags) {
+		ci::gl::Texture::Format	fmt;
+		if ((flags&ds::ui::Image::IMG_ENABLE_MIPMAP_F) != 0) {
+			fmt.enableMipmapping(true);
+			fmt.setMinFilter(GL_LINEAR_MIPMAP_LINEAR);
+		}
+		ci::gl::Texture			tex(s, fmt);
+		if (glGetError() == GL_OUT_OF_MEMORY) {
+			DS_LOG_ERROR_M("LoadImageService::update() received an out of memory error. Image may be too big.", LOAD_IMAGE_LOG_M);
+		}
+		DS_REPORT_GL_ERRORS();
+		return tex;
+	}
+};
 }
 
 namespace ds {
@@ -19,19 +39,22 @@ namespace ui {
  * \class ds::ui::ImageKey
  */
 ImageKey::ImageKey()
-		: mFlags(0) {
+		: mFlags(0)
+		, mMaxSize(0) {
 }
 
-ImageKey::ImageKey(const std::string& filename, const std::string& ip_key, const std::string& ip_params, const int flags)
+ImageKey::ImageKey(	const std::string& filename, const std::string& ip_key, const std::string& ip_params,
+					const int flags, const int max_size)
 		: mFilename(filename)
 		, mIpKey(ip_key)
 		, mIpParams(ip_params)
-		, mFlags(flags&IMAGE_FLAGS_KEY_MASK) {
+		, mFlags(flags&IMAGE_FLAGS_KEY_MASK)
+		, mMaxSize(max_size > 0 ? max_size : 0) {
 }
 
 bool ImageKey::operator==(const ImageKey& o) const {
 	if (this == &o) return true;
-	return mFilename == o.mFilename && mIpKey == o.mIpKey && mIpParams == o.mIpParams && mFlags == o.mFlags;
+	return mFilename == o.mFilename && mIpKey == o.mIpKey && mIpParams == o.mIpParams && mFlags == o.mFlags && mMaxSize == o.mMaxSize;
 }
 
 void ImageKey::clear() {
@@ -39,6 +62,7 @@ void ImageKey::clear() {
 	mIpKey.clear();
 	mIpParams.clear();
 	mFlags = 0;
+	mMaxSize = 0;
 }
 
 /**
@@ -62,7 +86,8 @@ bool ImageToken::canAcquire() const {
 }
 
 void ImageToken::acquire(	const std::string& _filename, const std::string& ip_key,
-							const std::string& ip_params, const int flags) {
+							const std::string& ip_params, const int flags,
+							const int max_size, const ImagePriority priority) {
 	if (mAcquired) return;
 
 	if (_filename.empty()) {
@@ -70,10 +95,11 @@ void ImageToken::acquire(	const std::string& _filename, const std::string& ip_ke
 //		DS_LOG_WARNING_M("ImageToken: Unable to load image resource (no filename)", LOAD_IMAGE_LOG_M);
 		return;
 	}
-	const ImageKey			key(_filename, ip_key, ip_params, flags);
-	mAcquired = mSrv.acquire(key, flags);
+	const ImageKey			key(_filename, ip_key, ip_params, flags, max_size);
+	mAcquired = mSrv.acquire(key, flags, priority);
 	if (mAcquired) {
 		mKey = key;
+		mPriority = priority;
 	}
 }
 
@@ -86,6 +112,11 @@ ci::gl::Texture ImageToken::getImage(float& fade) {
 	if (!mAcquired) return ci::gl::Texture();
 
 	if (!mTexture) {
+		// Someone wants to draw me, so I'm no longer just a preload
+		if (mPriority < IMAGE_PRIORITY_NORMAL) {
+			mPriority = IMAGE_PRIORITY_NORMAL;
+			mSrv.prioritize(mKey, mPriority);
+		}
 		return (mTexture = mSrv.getImage(mKey, fade));
 	}
 
@@ -101,6 +132,7 @@ void ImageToken::init() {
 	mKey.clear();
 	mAcquired = false;
 	mError = false;
+	mPriority = IMAGE_PRIORITY_NORMAL;
 	mTexture.reset();
 }
 
@@ -108,33 +140,74 @@ void ImageToken::init() {
  ******************************************************************/
 LoadImageService::LoadImageService(GlThread& t, ds::ui::ip::FunctionList& list)
 		: GlThreadClient<LoadImageService>(t)
-		, mFunctions(list) {
+		, mFunctions(list)
+		, mThreadCount(0)
+		, mStarted(false)
+		, mStopping(false)
+		, mInputAvailable(0, MAX_INPUT_AVAILABLE)
+		, mAllocator(new GlTextureAllocator())
+		, mUploader(*this) {
 	mInput.reserve(64);
 	mOutput.reserve(64);
-	mTmp.reserve(64);
 }
 
 LoadImageService::~LoadImageService()
 {
+	stopThreads();
 	clear();
 }
 
-bool LoadImageService::acquire(const ImageKey& key, const int flags) {
+void LoadImageService::configure(const ds::cfg::Settings& settings) {
+	setThreadCount(settings.getInt("load_image:threads", 0, 4));
+	const int			cache_mb = settings.getInt("load_image:cache_mb", 0, 0);
+	if (cache_mb > 0) setCacheBudget(static_cast<size_t>(cache_mb) * 1024 * 1024);
+	const int			upload_mb = settings.getInt("load_image:upload_mb", 0, 32);
+	setUploadBudget(	static_cast<size_t>(upload_mb > 0 ? upload_mb : 0) * 1024 * 1024,
+						settings.getFloat("load_image:upload_ms", 0, 4.0f) / 1000.0);
+	const int			disk_cache_mb = settings.getInt("load_image:disk_cache_mb", 0, 0);
+	if (disk_cache_mb > 0) {
+		setDiskCache(	settings.getText("load_image:disk_cache_path", 0, "%LOCAL%/cache/%PP%/images/"),
+						static_cast<size_t>(disk_cache_mb) * 1024 * 1024);
+	}
+}
+
+void LoadImageService::setThreadCount(const int count) {
+	if (mStarted) return;
+	mThreadCount = (count > 0 ? count : 0);
+}
+
+bool LoadImageService::acquire(const ImageKey& key, const int flags, const ImagePriority priority) {
 	holder&		h = mImageResource[key];
+	if (h.mTexture) mCache.recordHit();
+	else mCache.recordMiss();
 	// We have to test multiple conditions here -- if our refs fall below 1 AND we have no
 	// current image, then we need to load one in.  But if the refs are > 0, then there's
 	// either an image or one's being loaded.  And if there's an image but the refs are < 1,
 	// then it's being cached.
 	if ((!h.mTexture) && h.mRefs < 1) {
 //    DS_LOG_INFO_M("ImageService: acquire resource '" << filename << "' flags=" << flags << " refs=" << h.mRefs, LOAD_IMAGE_LOG_M);
-		// There's no image, so push on an operation to start one
+		// There's no image, so push on an operation to start one, unless one
+		// is still in flight from before the last release.
+		bool							added = false;
 		{
 			Poco::Mutex::ScopedLock		l(mMutex);
-			mInput.push_back(op(key, flags, mFunctions.find(key.mIpKey)));
+			if (mInFlight.insert(key).second) {
+				mInput.push_back(op(key, flags, priority, mFunctions.find(key.mIpKey)));
+				added = true;
+			}
  		}
-		performOnWorkerThread(&LoadImageService::_load);
+		if (added) {
+			startThreads();
+			if (!mThreads.empty()) mInputAvailable.set();
+			else performOnWorkerThread(&LoadImageService::_load);
+		} else {
+			prioritize(key, priority);
+		}
+	} else if (!h.mTexture) {
+		prioritize(key, priority);
 	}
 	h.mRefs++;
+	if (h.mRefs == 1) mCache.setPinned(key, true);
 	if ((flags&Image::IMG_CACHE_F) != 0) h.mFlags |= Image::IMG_CACHE_F;
 	if ((flags&Image::IMG_ENABLE_MIPMAP_F) != 0) h.mFlags |= Image::IMG_ENABLE_MIPMAP_F;
 
@@ -153,21 +226,36 @@ void LoadImageService::release(const ImageKey& key) {
 	if (it != mImageResource.end()) {
 		holder&		h = it->second;
 		h.mRefs--;
-		// If I'm caching this image, never release it
-		if ((h.mFlags&Image::IMG_CACHE_F) == 0 && h.mRefs <= 0) {
-			mImageResource.erase(key);
+		// If I'm caching this image, keep it until the cache needs the room
+		if (h.mRefs <= 0) {
+			if ((h.mFlags&Image::IMG_CACHE_F) == 0) {
+				mImageResource.erase(key);
+				mCache.remove(key);
+			} else {
+				mCache.setPinned(key, false);
+				evict();
+			}
 		}
 	} else {
 		DS_LOG_WARNING_M("LoadImageService::release() called on filename that doesn't exist (" << key.mFilename << ")", LOAD_IMAGE_LOG_M);
 	}
 }
 
-ci::gl::Texture LoadImageService::getImage(const ImageKey& key, float& fade) {
-	// Anytime someone asks for an image, flush out the buffer.
-	update();
+void LoadImageService::prioritize(const ImageKey& key, const ImagePriority priority) {
+	{
+		Poco::Mutex::ScopedLock		l(mMutex);
+		for (auto it=mInput.begin(), end=mInput.end(); it!=end; ++it) {
+			if (it->mPriority < priority && it->mKey == key) it->mPriority = priority;
+		}
+	}
+	mUploads.prioritize([&key](const op& o) { return o.mKey == key; }, priority);
+}
 
+ci::gl::Texture LoadImageService::getImage(const ImageKey& key, float& fade) {
 	if (mImageResource.empty()) return ci::gl::Texture();
 	holder& h = mImageResource[key];
+	// Someone's drawing this one, so it's uploaded before anything else.
+	if (!h.mTexture) prioritize(key, IMAGE_PRIORITY_HIGH);
 	fade = 1;
 	return h.mTexture;
 }
@@ -182,6 +270,32 @@ const ci::gl::Texture LoadImageService::peekImage(const ImageKey& key) const {
 	return ci::gl::Texture();
 }
 
+void LoadImageService::setCacheBudget(const size_t bytes) {
+	mCache.setBudget(bytes);
+	evict();
+}
+
+const ImageCache<ImageKey>::Stats& LoadImageService::getCacheStats() const {
+	return mCache.getStats();
+}
+
+void LoadImageService::setTextureAllocator(std::unique_ptr<ImageTextureAllocator>& a) {
+	if (a) mAllocator = std::move(a);
+	else mAllocator.reset(new GlTextureAllocator());
+}
+
+void LoadImageService::setUploadBudget(const size_t bytes, const double seconds) {
+	mUploads.setBudget(bytes, seconds);
+}
+
+const UploadStats& LoadImageService::getUploadStats() const {
+	return mUploads.getStats();
+}
+
+void LoadImageService::setDiskCache(const std::string& path, const size_t max_bytes) {
+	mDiskCache.setTo(path.empty() ? path : ds::Environment::expand(path), max_bytes);
+}
+
 bool LoadImageService::peekToken(const ImageKey& key, int* flags) const {
 	if (mImageResource.empty()) return false;
 	auto it = mImageResource.find(key);
@@ -194,70 +308,172 @@ bool LoadImageService::peekToken(const ImageKey& key, int* flags) const {
 }
 
 void LoadImageService::update() {
-	Poco::Mutex::ScopedLock			l(mMutex);
-	for (int k=0; k<mOutput.size(); k++) {
-		op&							out = mOutput[k];
-		holder&						h = mImageResource[out.mKey];
+	{
+		Poco::Mutex::ScopedLock		l(mMutex);
+		for (auto it=mOutput.begin(), end=mOutput.end(); it!=end; ++it) {
+			mUploads.push(*it, it->mPriority);
+		}
+		mOutput.clear();
+	}
+	mUploads.run(mUploader);
+	evict();
+}
+
+void LoadImageService::clear()
+{
+	{
+		// Anything in flight would never be loaded again, since acquire() thinks it's coming.
+		Poco::Mutex::ScopedLock		l(mMutex);
+		mInFlight.clear();
+		mInput.clear();
+		mOutput.clear();
+	}
+	mUploads.clear();
+	mImageResource.clear();
+	mCache.clear();
+}
+
+size_t LoadImageService::upload(op& out)
+{
+	{
+		Poco::Mutex::ScopedLock		l(mMutex);
+		mInFlight.erase(out.mKey);
+	}
+	size_t							bytes = 0;
+	// If it was released while waiting, there's nobody to upload it for.
+	auto							it = (mImageResource.empty() ? mImageResource.end() : mImageResource.find(out.mKey));
+	if (it != mImageResource.end()) {
+		holder&						h = it->second;
 		if (h.mTexture) {
 #ifdef _DEBUG
 			std::cout << "WHHAAAAT?  Duplicate images for id=" << out.mKey.mFilename << " refs=" << h.mRefs << std::endl;
 #endif
 		} else {
-			ci::gl::Texture::Format	fmt;
-			if ((h.mFlags&ds::ui::Image::IMG_ENABLE_MIPMAP_F) != 0) {
-				fmt.enableMipmapping(true);
-				fmt.setMinFilter(GL_LINEAR_MIPMAP_LINEAR);
+			h.mTexture = mAllocator->create(out.mSurface, h.mFlags);
+			if (h.mTexture) {
+				bytes = mAllocator->getBytes(out.mSurface, h.mFlags);
+				mCache.add(out.mKey, bytes, h.mRefs > 0);
 			}
-			h.mTexture = ci::gl::Texture(out.mSurface, fmt);
-			if (glGetError() == GL_OUT_OF_MEMORY) {
-				DS_LOG_ERROR_M("LoadImageService::update() called on filename: " << out.mKey.mFilename << " received an out of memory error. Image may be too big.", LOAD_IMAGE_LOG_M);
-			}
-			DS_REPORT_GL_ERRORS();
 		}
-		out.clear();
 	}
-	mOutput.clear();
+	out.clear();
+	return bytes;
 }
 
-void LoadImageService::clear()
+void LoadImageService::evict()
 {
-	mImageResource.clear();
+	ImageKey						key;
+	while (mCache.popEviction(key)) {
+		mImageResource.erase(key);
+	}
 }
 
 void LoadImageService::_load()
 {
-	// Pop off the items I need
-	mTmp.clear();
+	// Load everything that's waiting
+	DS_REPORT_GL_ERRORS();
+	while (decodeNext()) {
+	}
+	DS_REPORT_GL_ERRORS();
+}
+
+bool LoadImageService::decodeNext()
+{
+	// Pop off the most urgent item, oldest first
+	op									top;
 	{
 		Poco::Mutex::ScopedLock			l(mMutex);
-		mInput.swap(mTmp);
+		if (mInput.empty()) return false;
+		size_t							best = 0;
+		for (size_t k=1; k<mInput.size(); ++k) {
+			if (mInput[k].mPriority > mInput[best].mPriority) best = k;
+		}
+		top = mInput[best];
+		mInput.erase(mInput.begin() + best);
 	}
-	// Load them all
-	DS_REPORT_GL_ERRORS();
-	for (int k=0; k<mTmp.size(); k++) {
-		op&						           top = mTmp[k];
-		try {
-//			DS_LOG_INFO_M("LoadImageService::_load() on file (" << top.mFilename << ")", LOAD_IMAGE_LOG_M);
-			// If there's a function, then require this image have an alpha channel, because
-			// who knows what the function will need. Otherwise let cinder do its thing.
-			boost::tribool					alpha = boost::logic::indeterminate;
-			if (!top.mIpFunction.empty()) alpha = boost::tribool(true);
-			const std::string				fn = ds::Environment::expand(top.mKey.mFilename);
+
+	bool								loaded = false;
+	try {
+//		DS_LOG_INFO_M("LoadImageService::_load() on file (" << top.mFilename << ")", LOAD_IMAGE_LOG_M);
+		// If there's a function, then require this image have an alpha channel, because
+		// who knows what the function will need. Otherwise let cinder do its thing.
+		boost::tribool					alpha = boost::logic::indeterminate;
+		if (!top.mIpFunction.empty()) alpha = boost::tribool(true);
+		const std::string				fn = ds::Environment::expand(top.mKey.mFilename);
+		// The disk cache has the finished surface, so there's nothing more to do with it.
+		if (!mDiskCache.load(top.mKey, fn, top.mSurface)) {
 			top.mSurface = ci::Surface8u(ci::loadImage(fn), ci::SurfaceConstraintsDefault(), alpha);
-			DS_REPORT_GL_ERRORS();
+			// Shrink before the function, so it has less to do.
+			if (top.mSurface && top.mKey.mMaxSize > 0) top.mSurface = ds::ui::ip::downscale(top.mSurface, top.mKey.mMaxSize);
 			if (top.mSurface) {
 				top.mIpFunction.on(top.mKey.mIpParams, top.mSurface);
-				// This is to immediately place operations on the output...
-				Poco::Mutex::ScopedLock		l(mMutex);
-				mOutput.push_back(op(top));
+				mDiskCache.save(top.mKey, fn, top.mSurface);
 			}
-		} catch (std::exception const& ex) {
-			DS_LOG_WARNING_M("LoadImageService::_load() failed ex=" << ex.what() << " (file=" << top.mKey.mFilename << ")", LOAD_IMAGE_LOG_M);
 		}
-		top.clear();
-		DS_REPORT_GL_ERRORS();
+		if (top.mSurface) {
+			// This is to immediately place operations on the output...
+			Poco::Mutex::ScopedLock		l(mMutex);
+			mOutput.push_back(op(top));
+			loaded = true;
+		}
+	} catch (std::exception const& ex) {
+		DS_LOG_WARNING_M("LoadImageService::_load() failed ex=" << ex.what() << " (file=" << top.mKey.mFilename << ")", LOAD_IMAGE_LOG_M);
+	}
+	// Failures aren't retried until the image is released and acquired again
+	if (!loaded) {
+		Poco::Mutex::ScopedLock			l(mMutex);
+		mInFlight.erase(top.mKey);
+	}
+	return true;
+}
+
+void LoadImageService::startThreads()
+{
+	if (mStarted) return;
+	mStarted = true;
+	if (mThreadCount < 1) return;
+
+	try {
+		mWorker.reset(new Worker(*this));
+		mThreads.reserve(mThreadCount);
+		for (int k=0; k<mThreadCount; ++k) {
+			std::unique_ptr<Poco::Thread>	t(new Poco::Thread("ds_load_image"));
+			t->setPriority(Poco::Thread::PRIO_LOW);
+			t->start(*(mWorker.get()));
+			mThreads.push_back(std::move(t));
+		}
+	} catch (std::exception const& ex) {
+		DS_LOG_WARNING_M("LoadImageService can't start decode threads (" << ex.what() << ")", LOAD_IMAGE_LOG_M);
+	}
+	// Whatever's already waiting was sent to the GlThread
+}
+
+void LoadImageService::stopThreads()
+{
+	if (mThreads.empty()) return;
+	{
+		Poco::Mutex::ScopedLock			l(mMutex);
+		mStopping = true;
+		mInput.clear();
 	}
-	mTmp.clear();
+	try {
+		for (size_t k=0; k<mThreads.size(); ++k) mInputAvailable.set();
+		for (auto it=mThreads.begin(), end=mThreads.end(); it!=end; ++it) (*it)->join();
+	} catch (std::exception const&) {
+	}
+	mThreads.clear();
+}
+
+/**
+ * \class ds::ui::ImageTextureAllocator
+ */
+ImageTextureAllocator::~ImageTextureAllocator() {
+}
+
+size_t ImageTextureAllocator::getBytes(const ci::Surface8u& s, const int flags) const {
+	size_t							bytes = static_cast<size_t>(s.getWidth()) * s.getHeight() * (s.hasAlpha() ? 4 : 3);
+	if ((flags&ds::ui::Image::IMG_ENABLE_MIPMAP_F) != 0) bytes += bytes / 3;
+	return bytes;
 }
 
 /**
@@ -273,16 +489,18 @@ LoadImageService::holder::holder()
  * \class ds::ui::LoadImageService::op
  */
 LoadImageService::op::op()
-		: mFlags(0) {
+		: mFlags(0)
+		, mPriority(IMAGE_PRIORITY_NORMAL) {
 }
 
 LoadImageService::op::op(const op& o) {
 	*this = o;
 }
 
-LoadImageService::op::op(const ImageKey& key, const int flags, const ds::ui::ip::FunctionRef& fn)
+LoadImageService::op::op(const ImageKey& key, const int flags, const ImagePriority priority, const ds::ui::ip::FunctionRef& fn)
 		: mKey(key)
 		, mFlags(flags)
+		, mPriority(priority)
 		, mIpFunction(fn) {
 }
 
@@ -290,8 +508,40 @@ void LoadImageService::op::clear() {
 	mKey.clear();
 	mSurface.reset();
 	mFlags = 0;
+	mPriority = IMAGE_PRIORITY_NORMAL;
 	mIpFunction.clear();
 }
 
+/**
+ * \class ds::ui::LoadImageService::Worker
+ */
+LoadImageService::Worker::Worker(LoadImageService& owner)
+		: mOwner(owner) {
+}
+
+void LoadImageService::Worker::run() {
+	while (true) {
+		// One set() per input, so there might be nothing left when I wake up.
+		mOwner.mInputAvailable.wait();
+		{
+			Poco::Mutex::ScopedLock		l(mOwner.mMutex);
+			if (mOwner.mStopping) return;
+		}
+		while (mOwner.decodeNext()) {
+		}
+	}
+}
+
+/**
+ * \class ds::ui::LoadImageService::Uploader
+ */
+LoadImageService::Uploader::Uploader(LoadImageService& owner)
+		: mOwner(owner) {
+}
+
+size_t LoadImageService::Uploader::upload(op& o) {
+	return mOwner.upload(o);
+}
+
 } // namespace ui
 } // namespace ds
\ No newline at end of file
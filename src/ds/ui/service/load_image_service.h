@@ -2,15 +2,27 @@
 #ifndef DS_UI_SERVICE_LOADIMAGESERVICE_H_
 #define DS_UI_SERVICE_LOADIMAGESERVICE_H_
 
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include <Poco/Runnable.h>
+#include <Poco/Semaphore.h>
+#include <Poco/Thread.h>
 #include <cinder/Surface.h>
 #include <cinder/gl/Texture.h>
 #include "ds/app/engine/engine_service.h"
 #include "ds/thread/gl_thread.h"
 #include "ds/ui/ip/ip_function_list.h"
+#include "ds/ui/service/image_cache.h"
+#include "ds/ui/service/surface_disk_cache.h"
+#include "ds/ui/service/upload_scheduler.h"
 
 namespace ds {
+namespace cfg {
+class Settings;
+}
+
 namespace ui {
 class LoadImageService;
 
@@ -21,7 +33,8 @@ class LoadImageService;
 class ImageKey {
 public:
 	ImageKey();
-	ImageKey(const std::string& filename, const std::string& ip_key, const std::string& ip_params, const int flags);
+	ImageKey(	const std::string& filename, const std::string& ip_key, const std::string& ip_params,
+				const int flags, const int max_size = 0);
 
 	bool					operator==(const ImageKey&) const;
 	void					clear();
@@ -30,8 +43,13 @@ public:
 							mIpKey,
 							mIpParams;
 	int						mFlags;
+	// Decode so neither side is larger than this. 0 is full size.
+	int						mMaxSize;
 };
 
+// How soon an image is needed. Images about to be drawn are decoded before preloads.
+enum ImagePriority			{ IMAGE_PRIORITY_LOW, IMAGE_PRIORITY_NORMAL, IMAGE_PRIORITY_HIGH };
+
 } // namespace ui
 } // namespace ds
 
@@ -42,7 +60,7 @@ namespace std {
 		size_t operator()(const ds::ui::ImageKey& id) const {
 			std::size_t h1 = std::hash<std::string>()(id.mFilename);
 			std::size_t h2 = std::hash<std::string>()(id.mIpKey);
-			return h1 ^ (h2 << 1);
+			return (h1 ^ (h2 << 1)) ^ (static_cast<std::size_t>(id.mMaxSize) << 2);
 		}
 	};
 }
@@ -71,9 +89,12 @@ public:
 	 * \param ip_params is parameters to the IpFunction. Format is dependent
 	 * on the function.
 	 * \param flags provides scope info (i.e. ds::IMG_CACHE).
+	 * \param max_size shrinks the image as it's loaded so neither side is
+	 * larger. 0 loads it at full size.
 	 */
 	void					acquire(const std::string& filename, const std::string& ip_key,
-									const std::string& ip_params, const int flags);
+									const std::string& ip_params, const int flags,
+									const int max_size = 0, const ImagePriority = IMAGE_PRIORITY_NORMAL);
 	void					release();
 
 	ci::gl::Texture			getImage(float& fade);
@@ -88,9 +109,26 @@ private:
 //	std::string				mFilename;
 	bool					mAcquired;
 	bool					mError;
+	ImagePriority			mPriority;
 	ci::gl::Texture			mTexture;
 };
 
+/**
+ * \class ds::ui::ImageTextureAllocator
+ * \brief Turn decoded surfaces into textures for the LoadImageService, and
+ * report how much memory each one takes. Replace it to run the service
+ * without a GL context.
+ */
+class ImageTextureAllocator {
+public:
+	virtual ~ImageTextureAllocator();
+
+	// flags are the image flags (i.e. ds::ui::Image::IMG_ENABLE_MIPMAP_F).
+	virtual ci::gl::Texture		create(const ci::Surface8u&, const int flags) = 0;
+	// By default, the size of the pixels plus a third for any mipmaps.
+	virtual size_t				getBytes(const ci::Surface8u&, const int flags) const;
+};
+
 /**
  * \class ds::ui::LoadImageService
  * \brief Manage and load images.
@@ -100,16 +138,42 @@ public:
 	LoadImageService(GlThread&, ds::ui::ip::FunctionList&);
 	~LoadImageService();
 
+	// Apply the load_image:* engine settings (threads, cache, upload and disk cache budgets).
+	void						configure(const ds::cfg::Settings&);
+	// Decode on this many threads of my own. 0 decodes on the GlThread.
+	// Only applies before the first image is requested.
+	void						setThreadCount(const int);
+
 	// Clients should call release() for every successful acquire
-	bool						acquire(const ImageKey& key, const int flags);
+	bool						acquire(const ImageKey& key, const int flags, const ImagePriority = IMAGE_PRIORITY_NORMAL);
 	void						release(const ImageKey& key);
+	// Raise the priority of an image that's waiting to be decoded.
+	void						prioritize(const ImageKey&, const ImagePriority);
+
+	// Unreferenced IMG_CACHE_F images are evicted, least recently used first,
+	// to keep the resident images under this many bytes. 0 is unlimited.
+	void						setCacheBudget(const size_t bytes);
+	const ImageCache<ImageKey>::Stats&
+								getCacheStats() const;
+	// I take ownership. An empty pointer restores the GL allocator.
+	void						setTextureAllocator(std::unique_ptr<ImageTextureAllocator>&);
+	// Each update() uploads textures until it's uploaded this many bytes or
+	// taken this long, and leaves the rest for later frames. 0 is unlimited.
+	void						setUploadBudget(const size_t bytes, const double seconds);
+	const UploadStats&			getUploadStats() const;
+	// Keep finished surfaces in this folder (environment variables are expanded),
+	// trimmed to max_bytes, so they don't need to be decoded and processed again.
+	// An empty path or 0 bytes turns it off.
+	void						setDiskCache(const std::string& path, const size_t max_bytes);
 
+	// Textures are only made in update(), but asking for one moves it to the front.
 	ci::gl::Texture				getImage(const ImageKey&, float& fade);
 	// No refs are acquired, no image is loaded -- if it exists, answer it
 	const ci::gl::Texture		peekImage(const ImageKey&) const;
 	// Answer true if the token exists (though the image might not be loaded), supplying the flags if you like
 	bool						peekToken(const ImageKey&, int* flags = nullptr) const;
 
+	// Upload this frame's share of the decoded images. Call once per frame.
 	void						update();
 	void						clear();
 
@@ -128,7 +192,7 @@ private:
 	struct op {
 		op();
 		op(const op&);
-		op(const ImageKey&, const int flags, const ds::ui::ip::FunctionRef&);
+		op(const ImageKey&, const int flags, const ImagePriority, const ds::ui::ip::FunctionRef&);
 
 		void					clear();
 
@@ -137,21 +201,70 @@ private:
 //		ci::gl::Texture			mTexture;
 		ci::Surface8u			mSurface;
 		int						mFlags;
+		ImagePriority			mPriority;
 		ds::ui::ip::FunctionRef	mIpFunction;
 	};
 
+	// Decode thread entry
+	class Worker : public Poco::Runnable {
+	public:
+		Worker(LoadImageService&);
+		virtual void			run();
+
+	private:
+		LoadImageService&		mOwner;
+	};
+
+	class Uploader : public UploadScheduler<op>::Uploader {
+	public:
+		Uploader(LoadImageService&);
+		virtual size_t			upload(op&);
+
+	private:
+		LoadImageService&		mOwner;
+	};
+
 private:
+	// GlThread entry, when I don't have threads of my own.
 	void						_load();
+	// Decode the highest priority input. Answer false if there was none.
+	bool						decodeNext();
+	// Start the decode threads, if there should be any and they haven't been.
+	void						startThreads();
+	void						stopThreads();
+	// Drop cached images until the cache is under budget.
+	void						evict();
+	// Make the texture for a decoded image. Answer its size.
+	size_t						upload(op&);
 
 	ds::ui::ip::FunctionList&	mFunctions;
 	// Hmm, had problems getting the hashing implemented for ImageKey
 //	std::unordered_map<ImageKey, holder>
 	std::unordered_map<ImageKey, holder>
 								mImageResource;
+	ImageCache<ImageKey>		mCache;
+	SurfaceDiskCache			mDiskCache;
+	std::unique_ptr<ImageTextureAllocator>
+								mAllocator;
+	// Decoded images waiting for a texture. Main thread only.
+	UploadScheduler<op>			mUploads;
+	Uploader					mUploader;
 
 	Poco::Mutex					mMutex;
 	// Input and output stacks for thread processing
-	std::vector<op>				mInput, mOutput, mTmp;
+	std::vector<op>				mInput, mOutput;
+	// Everything in the input, being decoded, or in the output. Use the mutex.
+	std::unordered_set<ImageKey>
+								mInFlight;
+
+	int							mThreadCount;
+	bool						mStarted,
+								mStopping;
+	std::unique_ptr<Worker>		mWorker;
+	std::vector<std::unique_ptr<Poco::Thread>>
+								mThreads;
+	// Set once per input, so it's never less than the number waiting.
+	Poco::Semaphore				mInputAvailable;
 };
 
 } // namespace ui
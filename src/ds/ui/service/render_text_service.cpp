@@ -1,20 +1,16 @@
 ﻿#include "ds/ui/service/render_text_service.h"
 
-#include <cinder/ImageIo.h>
+#include <cmath>
 #include "ds/debug/debug_defines.h"
 #include "ds/debug/logger.h"
-#include "ds/ui/sprite/image.h"
-#include "ds/ui/sprite/fbo/fbo.h"
-
-#include "ds/ui/sprite/text_layout.h"
-
-// tmp
-#include <cinder/Surface.h>
-#include <cinder/ImageIo.h>
-#include <cinder/Camera.h>
+#include "ds/ui/service/glyph_atlas.h"
 
 namespace {
 const ds::BitMask     RENDER_TEXT_LOG_M = ds::Logger::newModule("render_text");
+const int			MAX_INPUT_AVAILABLE = 0x7fffffff;
+// Each thread's atlas is started over once it has this many pages, so a
+// long running app that shows a lot of different text doesn't keep them all.
+const size_t		MAX_ATLAS_PAGES = 4;
 }
 
 namespace ds {
@@ -30,13 +26,13 @@ RenderTextShared::RenderTextShared()
 
 void RenderTextShared::setLatestRequestId(const int id)
 {
-    boost::lock_guard<boost::mutex> lock(mLock);
+	Poco::Mutex::ScopedLock		l(mLock);
 	mLatestRequestId = id;
 }
 
 int RenderTextShared::getLatestRequestId()
 {
-    boost::lock_guard<boost::mutex> lock(mLock);
+	Poco::Mutex::ScopedLock		l(mLock);
 	return mLatestRequestId;
 }
 
@@ -44,6 +40,8 @@ int RenderTextShared::getLatestRequestId()
  * \class ds::ui::RenderTextFinished
  */
 RenderTextFinished::RenderTextFinished()
+	: mRequestId(-1)
+	, mError(false)
 {
 }
 
@@ -62,10 +60,22 @@ RenderTextClient::~RenderTextClient()
 	mService.unregisterClient(this);
 }
 
+bool RenderTextClient::isEnabled() const
+{
+	return mService.isEnabled();
+}
+
 void RenderTextClient::start(	const std::string& fontFilename, const float fontSize,
-								std::weak_ptr<RenderTextShared> shared, int code)
+								const std::vector<TextLayout::Line>& lines, const ci::Vec2f& offset,
+								const int width, const int height,
+								std::weak_ptr<RenderTextShared> shared, const int requestId)
 {
-	mService.start(std::unique_ptr<RenderTextWorker>(new RenderTextWorker(this, shared, fontFilename, fontSize, code)));
+	std::unique_ptr<RenderTextWorker>	w(new RenderTextWorker(this, shared, fontFilename, fontSize, requestId));
+	w->mLines = lines;
+	w->mOffset = offset;
+	w->mWidth = width;
+	w->mHeight = height;
+	mService.start(w);
 }
 
 /**
@@ -75,31 +85,60 @@ RenderTextWorker::RenderTextWorker(	const void* clientId,
 									std::weak_ptr<RenderTextShared> shared,
 									const std::string& fontFilename,
 									const float fontSize,
-									int code)
+									const int requestId)
 	: mClientId(clientId)
 	, mShared(shared)
 	, mFontFilename(fontFilename)
 	, mFontSize(fontSize)
-	, mCode(code)
+	, mRequestId(requestId)
+	, mWidth(0)
+	, mHeight(0)
 {
+	mFinished.mRequestId = requestId;
 }
 
 void RenderTextWorker::clear()
 {
 	mShared.reset();
+	mLines.clear();
+	mSurface.reset();
 	mFinished.mTexture = ci::gl::Texture();
 }
 
+bool RenderTextWorker::isStale()
+{
+	std::shared_ptr<RenderTextShared>	shared(mShared.lock());
+	return !shared || shared->getLatestRequestId() != mRequestId;
+}
+
 /**
  * \class ds::ui::RenderTextService
  */
-RenderTextService::RenderTextService(GlThread& t)
-	: GlThreadClient<RenderTextService>(t)
+RenderTextService::RenderTextService()
+	: mThreadCount(0)
+	, mStarted(false)
+	, mStopping(false)
+	, mInputAvailable(0, MAX_INPUT_AVAILABLE)
 {
 	mInput.reserve(32);
 	mOutput.reserve(32);
 	mMainThreadTmp.reserve(32);
-	mWorkerThreadTmp.reserve(32);
+}
+
+RenderTextService::~RenderTextService()
+{
+	stopThreads();
+}
+
+void RenderTextService::setThreadCount(const int count)
+{
+	if (mStarted) return;
+	mThreadCount = (count > 0 ? count : 0);
+}
+
+bool RenderTextService::isEnabled() const
+{
+	return mThreadCount > 0;
 }
 
 void RenderTextService::registerClient(	const void* clientId,
@@ -118,144 +157,202 @@ void RenderTextService::unregisterClient(const void* clientId)
 
 void RenderTextService::start(std::unique_ptr<RenderTextWorker>& worker)
 {
+	if (!worker) return;
+	startThreads();
+	if (mThreads.empty()) {
+		// Nothing will ever run it, so let the client draw for itself.
+		worker->mFinished.mError = true;
+		Poco::Mutex::ScopedLock		l(mLock);
+		mOutput.push_back(std::move(worker));
+		return;
+	}
 	{
-		boost::lock_guard<boost::mutex> lock(mLock);
+		Poco::Mutex::ScopedLock		l(mLock);
 		mInput.push_back(std::move(worker));
 	}
-	performOnWorkerThread(&RenderTextService::_run);
+	mInputAvailable.set();
 }
 
 void RenderTextService::update()
 {
 	mMainThreadTmp.clear();
 	{
-		boost::lock_guard<boost::mutex> lock(mLock);
-		mMainThreadTmp.swap(mOutput); 
+		Poco::Mutex::ScopedLock		l(mLock);
+		if (mOutput.empty()) return;
+		mMainThreadTmp.swap(mOutput);
 	}
-	if (mClientRegistry.empty()) return;
 	for (auto it=mMainThreadTmp.begin(), end=mMainThreadTmp.end(); it!=end; ++it) {
 		RenderTextWorker*		worker = it->get();
 		if (!worker) continue;
 
 		auto found = mClientRegistry.find(worker->mClientId);
-		if (found != mClientRegistry.end()) {
-			if (found->second) found->second(worker->mFinished);
+		if (found != mClientRegistry.end() && found->second && !worker->isStale()) {
+			if (worker->mSurface) {
+				ci::gl::Texture::Format	format;
+				format.setTarget(GL_TEXTURE_2D);
+				worker->mFinished.mTexture = ci::gl::Texture(worker->mSurface, format);
+				DS_REPORT_GL_ERRORS();
+			}
+			found->second(worker->mFinished);
 		}
 		worker->clear();
 		it->reset();
 	}
-//      if (glGetError() == GL_OUT_OF_MEMORY) {
-//        DS_LOG_ERROR_M("LoadImageService::update() called on filename: " << out.mFilename << " recieved an out of memory error. Image my be too big.", LOAD_IMAGE_LOG_M);
-//      }
-//      DS_REPORT_GL_ERRORS();
+	mMainThreadTmp.clear();
 }
 
-void RenderTextService::_run()
+bool RenderTextService::renderNext()
 {
-	// Pop off the items I need
-	mWorkerThreadTmp.clear();
+	std::unique_ptr<RenderTextWorker>	worker;
 	{
-		boost::lock_guard<boost::mutex> lock(mLock);
-		mInput.swap(mWorkerThreadTmp);
+		Poco::Mutex::ScopedLock			l(mLock);
+		if (mInput.empty()) return false;
+		worker = std::move(mInput.front());
+		mInput.erase(mInput.begin());
 	}
+	// Something newer was asked for while this was waiting.
+	if (!worker || worker->isStale()) return true;
 
-	DS_REPORT_GL_ERRORS();
-#if 1
-	static FontPtr	TMP_FONT = FontPtr(new OGLFT::Translucent("C:\\Users\\erich\\Documents\\downstream\\resources\\jci\\table\\ui\\fonts\\FRUTIGER45LIGHT.otf", 14));
-	if (TMP_FONT->isValid()) {
-		TMP_FONT->setCompileMode(OGLFT::Face::COMPILE);
+	std::unique_ptr<GlyphAtlas>			atlas;
+	{
+		Poco::Mutex::ScopedLock			l(mLock);
+		if (!mAtlases.empty()) {
+			atlas = std::move(mAtlases.back());
+			mAtlases.pop_back();
+		}
 	}
-#endif
-	FboGeneral		fbo;
 
-	ci::gl::enableAlphaBlending();
+	try {
+		if (!atlas) atlas.reset(new GlyphAtlas());
+		worker->mFinished.mError = !render(*worker, *atlas);
+	} catch (std::exception const& ex) {
+		DS_LOG_WARNING_M("RenderTextService::renderNext() failed ex=" << ex.what() << " (font=" << worker->mFontFilename << ")", RENDER_TEXT_LOG_M);
+		worker->mFinished.mError = true;
+	}
 
-	for (auto it=mWorkerThreadTmp.begin(), end=mWorkerThreadTmp.end(); it!=end; ++it) {
-		RenderTextWorker*	worker = it->get();
-		if (!worker) continue;
+	Poco::Mutex::ScopedLock				l(mLock);
+	if (atlas && atlas->getPageCount() <= MAX_ATLAS_PAGES) mAtlases.push_back(std::move(atlas));
+	mOutput.push_back(std::move(worker));
+	return true;
+}
 
-		{
-			ci::gl::Texture::Format format;
-			format.setTarget(GL_TEXTURE_2D);
-			ci::gl::Texture		tex;
-			int					size = 30;
-			if (worker->mCode == 900) size = 50;
-			if (worker->mCode == 400) size = 20;
-			tex = ci::gl::Texture(size, size, format);
-			worker->mFinished.mTexture = tex;
-			worker->mFinished.mCode = worker->mCode;
-
-			{
-				fbo.setup(true);
-				FboGeneral::AutoAttach	attach(fbo, tex);
-				{
-					FboGeneral::AutoRun	run(fbo);
-					ci::gl::clear(ci::ColorA(1.0f, 0.0f, 1.0f, 1.0f));
-
-					#if 0
-					glPushAttrib(GL_COLOR);
-					ci::gl::color(ci::ColorA(0.0f, 1.0f, 0.0f, 1.0f));
-					ci::gl::drawSolidRect(ci::Rectf(0.0f, 0.0f, size, size));
-					glPopAttrib();
-					#endif
-#if 1
-//					FontPtr font = FontPtr(new OGLFT::Translucent(worker->mFontFilename.c_str(), worker->mFontSize));
-					if (TMP_FONT->isValid()) {
-//						font->setCompileMode(OGLFT::Face::COMPILE);
-
-      ci::Area fboBounds(0, 0, fbo.getWidth(), fbo.getHeight());
-      ci::gl::setViewport(fboBounds);
-      ci::CameraOrtho camera;
-      camera.setOrtho(static_cast<float>(fboBounds.getX1()), static_cast<float>(fboBounds.getX2()), static_cast<float>(fboBounds.getY2()), static_cast<float>(fboBounds.getY1()), -1.0f, 1.0f);
-
-      ci::gl::setMatrices(camera);
-
-
-						TMP_FONT->setForegroundColor( 1.0f, 1.0f, 1.0f, 0.99f );
-						TMP_FONT->setBackgroundColor( 1.0f, 1.0f, 1.0f, 0.0f );
-						TMP_FONT->draw(10, 20, "Helllo");
-					}
-#endif
-				}
+bool RenderTextService::render(RenderTextWorker& w, GlyphAtlas& atlas)
+{
+	const int							font = atlas.getFont(w.mFontFilename, w.mFontSize);
+	if (font < 0) return false;
+	if (w.mWidth < 1 || w.mHeight < 1) return true;
+
+	std::vector<GlyphQuad>				quads;
+	for (auto it=w.mLines.begin(), end=w.mLines.end(); it!=end; ++it) {
+		atlas.layout(font, it->mText, it->mPos.x + w.mOffset.x, it->mPos.y + w.mOffset.y + w.mFontSize, quads);
+	}
+
+	// White, with the glyph coverage in the alpha, the same as the atlas pages.
+	ci::Surface8u						s(w.mWidth, w.mHeight, true, ci::SurfaceChannelOrder::RGBA);
+	const int							inc = s.getPixelInc(),
+										row_bytes = s.getRowBytes(),
+										ro = s.getChannelOrder().getRedOffset(),
+										go = s.getChannelOrder().getGreenOffset(),
+										bo = s.getChannelOrder().getBlueOffset(),
+										ao = s.getChannelOrder().getAlphaOffset();
+	uint8_t*							data = s.getData();
+	for (int y=0; y<w.mHeight; ++y) {
+		uint8_t*						p = data + y*row_bytes;
+		for (int x=0; x<w.mWidth; ++x, p+=inc) {
+			p[ro] = p[go] = p[bo] = 255;
+			p[ao] = 0;
+		}
+	}
+
+	const int							page_size = atlas.getPageSize();
+	for (auto it=quads.begin(), end=quads.end(); it!=end; ++it) {
+		const GlyphQuad&				q(*it);
+		const uint8_t*					page = atlas.getPixels(q.mPage);
+		if (!page) continue;
+		// Quads are on whole pixels, so these are exact.
+		const int						dx = static_cast<int>(floorf(q.mRect.x1 + 0.5f)),
+										dy = static_cast<int>(floorf(q.mRect.y1 + 0.5f)),
+										gw = static_cast<int>(floorf(q.mRect.getWidth() + 0.5f)),
+										gh = static_cast<int>(floorf(q.mRect.getHeight() + 0.5f)),
+										sx = static_cast<int>(floorf(q.mUv.x1 * page_size + 0.5f)),
+										sy = static_cast<int>(floorf(q.mUv.y1 * page_size + 0.5f));
+		for (int y=0; y<gh; ++y) {
+			const int					ty = dy + y;
+			if (ty < 0 || ty >= w.mHeight) continue;
+			// Rows are stored bottom up, the way the FBO textures come out.
+			uint8_t*					dst_row = data + (w.mHeight - 1 - ty)*row_bytes;
+			const uint8_t*				src_row = page + ((sy + y)*page_size + sx)*2;
+			for (int x=0; x<gw; ++x) {
+				const int				tx = dx + x;
+				if (tx < 0 || tx >= w.mWidth) continue;
+				const int				src = src_row[x*2 + 1];
+				if (src == 0) continue;
+				uint8_t&				dst = dst_row[tx*inc + ao];
+				// Overlapping glyphs are composited over each other.
+				dst = static_cast<uint8_t>(dst + src - (dst*src + 127) / 255);
 			}
 		}
+	}
+	w.mSurface = s;
+	return true;
+}
 
-		{
-//			if (worker->mCode > 0) {
-				ci::Surface8u	s(worker->mFinished.mTexture);
-//				std::stringstream	buf;
-//				buf << "C:\\Users\\erich\\Documents\\downstream\\wtf_" << worker->mCode << ".png";
-//				ci::writeImage(buf.str(), s);
-//			}
+void RenderTextService::startThreads()
+{
+	if (mStarted) return;
+	mStarted = true;
+	if (mThreadCount < 1) return;
+
+	try {
+		mRunner.reset(new Runner(*this));
+		mThreads.reserve(mThreadCount);
+		for (int k=0; k<mThreadCount; ++k) {
+			std::unique_ptr<Poco::Thread>	t(new Poco::Thread("ds_render_text"));
+			t->setPriority(Poco::Thread::PRIO_LOW);
+			t->start(*(mRunner.get()));
+			mThreads.push_back(std::move(t));
 		}
+	} catch (std::exception const& ex) {
+		DS_LOG_WARNING_M("RenderTextService can't start threads (" << ex.what() << ")", RENDER_TEXT_LOG_M);
+	}
+}
 
-		boost::lock_guard<boost::mutex> lock(mLock);
-		mOutput.push_back(std::move(*it));
+void RenderTextService::stopThreads()
+{
+	if (mThreads.empty()) return;
+	{
+		Poco::Mutex::ScopedLock			l(mLock);
+		mStopping = true;
+		mInput.clear();
+	}
+	try {
+		for (size_t k=0; k<mThreads.size(); ++k) mInputAvailable.set();
+		for (auto it=mThreads.begin(), end=mThreads.end(); it!=end; ++it) (*it)->join();
+	} catch (std::exception const&) {
 	}
-	mWorkerThreadTmp.clear();
-
-#if 0
-	// Load them all
-	DS_REPORT_GL_ERRORS();
-	for (int k=0; k<mTmp.size(); k++) {
-		op&						           top = mTmp[k];
-    try {
-//      DS_LOG_INFO_M("LoadImageService::_load() on file (" << top.mFilename << ")", LOAD_IMAGE_LOG_M);
-      top.mSurface = ci::Surface8u(ci::loadImage(top.mFilename));
-      DS_REPORT_GL_ERRORS();
-      if (top.mSurface) {
-        // This is to immediately place operations on the out put...
-        Poco::Mutex::ScopedLock		l(mMutex);
-        mOutput.push_back(op(top));
-      }
-    } catch (std::exception const& ex) {
-      DS_LOG_WARNING_M("LoadImageService::_load() failed ex=" << ex.what() << " (file=" << top.mFilename << ")", LOAD_IMAGE_LOG_M);
-    }
-    top.clear();
-		DS_REPORT_GL_ERRORS();
+	mThreads.clear();
+}
+
+/**
+ * \class ds::ui::RenderTextService::Runner
+ */
+RenderTextService::Runner::Runner(RenderTextService& owner)
+	: mOwner(owner)
+{
+}
+
+void RenderTextService::Runner::run()
+{
+	while (true) {
+		// One set() per input, so there might be nothing left when I wake up.
+		mOwner.mInputAvailable.wait();
+		{
+			Poco::Mutex::ScopedLock		l(mOwner.mLock);
+			if (mOwner.mStopping) return;
+		}
+		while (mOwner.renderNext()) {
+		}
 	}
-	mTmp.clear();
-#endif
 }
 
 } // namespace ui
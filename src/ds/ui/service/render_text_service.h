@@ -2,16 +2,22 @@
 #ifndef DS_UI_SERVICE_RENDERTEXTSERVICE_H_
 #define DS_UI_SERVICE_RENDERTEXTSERVICE_H_
 
+#include <functional>
 #include <memory>
 #include <vector>
 #include <unordered_map>
-#include <cinder/Thread.h>
+#include <Poco/Mutex.h>
+#include <Poco/Runnable.h>
+#include <Poco/Semaphore.h>
+#include <Poco/Thread.h>
+#include <cinder/Surface.h>
 #include <cinder/gl/Texture.h>
-#include "ds/thread/gl_thread.h"
+#include "ds/ui/sprite/text_layout.h"
 
 namespace ds {
 
 namespace ui {
+class GlyphAtlas;
 class RenderTextService;
 
 /**
@@ -26,7 +32,7 @@ public:
 	int				getLatestRequestId();
 
 private:
-	std::mutex		mLock;
+	Poco::Mutex		mLock;
 	// This stores the most recent ID that a client has requested
 	// be created. It is used in case a lot of requests are made,
 	// so we can toss all but the latest.
@@ -42,7 +48,10 @@ public:
 	RenderTextFinished();
 
 	ci::gl::Texture	mTexture;
-	int mCode;
+	int				mRequestId;
+	// True if the font couldn't be rasterized, in which case the
+	// client should draw the text itself.
+	bool			mError;
 };
 
 /**
@@ -53,8 +62,19 @@ public:
 	RenderTextClient(RenderTextService&, const std::function<void(RenderTextFinished&)>& finishedFn);
 	~RenderTextClient();
 
+	bool				isEnabled() const;
+	/**
+	 * \brief Rasterize laid out lines into a texture, off the main thread.
+	 * \param lines are drawn with the left edge of the ink at their x, and
+	 * their baseline a point size below their y, then moved by offset.
+	 * \param width and height are the size of the texture.
+	 * \param requestId is handed back with the result. Anything older than
+	 * the latest id in shared is dropped.
+	 */
 	void				start(	const std::string& fontFilename, const float fontSize,
-								std::weak_ptr<RenderTextShared> shared, int code);
+								const std::vector<TextLayout::Line>& lines, const ci::Vec2f& offset,
+								const int width, const int height,
+								std::weak_ptr<RenderTextShared> shared, const int requestId);
 
 private:
 	RenderTextService&	mService;
@@ -70,17 +90,26 @@ public:
 						std::weak_ptr<RenderTextShared>,
 						const std::string& fontFilename,
 						const float fontSize,
-						int code);
+						const int requestId);
 
 	void				clear();
+	// Answer true if the client has asked for something newer, or is gone.
+	bool				isStale();
 
-	int mCode;
 	const void*			mClientId;
 	// A reference to the current
 	std::weak_ptr<RenderTextShared>
 						mShared;
 	const std::string	mFontFilename;
 	const float			mFontSize;
+	const int			mRequestId;
+	std::vector<TextLayout::Line>
+						mLines;
+	ci::Vec2f			mOffset;
+	int					mWidth,
+						mHeight;
+	// Filled on the worker thread, turned into the texture on the main thread.
+	ci::Surface8u		mSurface;
 	RenderTextFinished	mFinished;
 
 private:
@@ -89,10 +118,19 @@ private:
 
 /**
  * \class ds::ui::RenderTextService
+ * \brief Rasterize text on threads of my own, with FreeType, and hand the
+ * textures back to the clients in update(). Each thread borrows a GlyphAtlas,
+ * so text is rasterized the same way the atlas and the OGLFT fonts draw it.
  */
-class RenderTextService : public ds::GlThreadClient<RenderTextService> {
+class RenderTextService {
 public:
-	RenderTextService(GlThread&);
+	RenderTextService();
+	~RenderTextService();
+
+	// Rasterize on this many threads. 0 turns the service off, and
+	// text draws itself on the main thread. Only applies before the first request.
+	void					setThreadCount(const int);
+	bool					isEnabled() const;
 
 	void					registerClient(	const void*,
 											const std::function<void(RenderTextFinished&)>&);
@@ -100,19 +138,45 @@ public:
 
 	void					start(std::unique_ptr<RenderTextWorker>& worker);
 
+	// Make the textures for finished work and hand them to the clients. Call once per frame.
 	void					update();
 
 private:
+	// Rasterize thread entry
+	class Runner : public Poco::Runnable {
+	public:
+		Runner(RenderTextService&);
+		virtual void		run();
+
+	private:
+		RenderTextService&	mOwner;
+	};
+
+	// Answer false if there was nothing waiting.
+	bool					renderNext();
+	bool					render(RenderTextWorker&, GlyphAtlas&);
+	void					startThreads();
+	void					stopThreads();
+
 	std::unordered_map<const void*, std::function<void(RenderTextFinished&)>>
 							mClientRegistry;
 
-	std::mutex				mLock;
+	Poco::Mutex				mLock;
 	std::vector<std::unique_ptr<RenderTextWorker>>
 							mInput, mOutput,
-							mMainThreadTmp,
-							mWorkerThreadTmp;
-
-	void					_run();
+							mMainThreadTmp;
+	// Atlases not in use by a thread. Use the lock.
+	std::vector<std::unique_ptr<GlyphAtlas>>
+							mAtlases;
+
+	int						mThreadCount;
+	bool					mStarted,
+							mStopping;
+	std::unique_ptr<Runner>	mRunner;
+	std::vector<std::unique_ptr<Poco::Thread>>
+							mThreads;
+	// Set once per input, so it's never less than the number waiting.
+	Poco::Semaphore			mInputAvailable;
 };
 
 } // namespace ui
@@ -0,0 +1,266 @@
+#include "ds/ui/service/surface_disk_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <Poco/DirectoryIterator.h>
+#include <Poco/File.h>
+#include <Poco/Path.h>
+#include <Poco/SharedMemory.h>
+#include <Poco/Timestamp.h>
+#include "ds/debug/logger.h"
+#include "ds/ui/service/load_image_service.h"
+
+namespace ds {
+namespace ui {
+
+namespace {
+const ds::BitMask			DISK_CACHE_LOG_M = ds::Logger::newModule("surface_disk_cache");
+const char					MAGIC[4] = { 'D', 'S', 'S', 'F' };
+const uint32_t				VERSION = 1;
+const std::string			EXTENSION("dssurf");
+
+// Every field is 4 bytes, so there's no padding.
+class Header {
+public:
+	char					mMagic[4];
+	uint32_t				mVersion;
+	int32_t					mWidth,
+							mHeight,
+							mAlpha,
+							mChannelOrder;
+	uint32_t				mRowBytes,
+							mKeySize;
+};
+
+// 64-bit FNV-1a
+uint64_t					hash_key(const std::string& key) {
+	uint64_t				h = 14695981039346656037ULL;
+	for (auto it=key.begin(), end=key.end(); it!=end; ++it) {
+		h ^= static_cast<uint8_t>(*it);
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+}
+
+/**
+ * \class ds::ui::SurfaceDiskCache
+ */
+SurfaceDiskCache::SurfaceDiskCache()
+		: mMaxBytes(0)
+		, mBytes(0)
+		, mTmpCount(0) {
+}
+
+void SurfaceDiskCache::setTo(const std::string& path, const size_t max_bytes) {
+	Poco::FastMutex::ScopedLock		l(mMutex);
+	mEntries.clear();
+	mBytes = 0;
+	mPath.clear();
+	mMaxBytes = max_bytes;
+	if (path.empty() || max_bytes < 1) return;
+
+	try {
+		Poco::File(path).createDirectories();
+		mPath = Poco::Path(path).makeDirectory().toString();
+		scanLocked();
+		trimLocked();
+	} catch (std::exception const& ex) {
+		DS_LOG_WARNING_M("SurfaceDiskCache can't use folder " << path << " (" << ex.what() << ")", DISK_CACHE_LOG_M);
+		mPath.clear();
+		mEntries.clear();
+		mBytes = 0;
+	}
+}
+
+bool SurfaceDiskCache::isEnabled() const {
+	Poco::FastMutex::ScopedLock		l(mMutex);
+	return !mPath.empty();
+}
+
+bool SurfaceDiskCache::load(const ImageKey& key, const std::string& filename, ci::Surface8u& out) {
+	std::string						path;
+	const std::string				k = makeKey(key, filename);
+	const std::string				name = makeName(k);
+	{
+		Poco::FastMutex::ScopedLock	l(mMutex);
+		if (mPath.empty() || k.empty()) return false;
+		if (mEntries.find(name) == mEntries.end()) return false;
+		path = mPath + name;
+	}
+
+	bool							loaded = false;
+	try {
+		Poco::File					file(path);
+		Poco::SharedMemory			mem(file, Poco::SharedMemory::AM_READ);
+		const char*					data = mem.begin();
+		const size_t				size = static_cast<size_t>(mem.end() - mem.begin());
+
+		Header						h;
+		if (size >= sizeof(h)) {
+			memcpy(&h, data, sizeof(h));
+			const size_t			pixel_inc = (h.mAlpha ? 4 : 3);
+			const size_t			pixels = sizeof(h) + h.mKeySize;
+			if (memcmp(h.mMagic, MAGIC, sizeof(MAGIC)) == 0 && h.mVersion == VERSION
+					&& h.mWidth > 0 && h.mHeight > 0 && h.mRowBytes >= static_cast<size_t>(h.mWidth) * pixel_inc
+					&& h.mKeySize == k.size() && size >= pixels
+					&& (size - pixels) / h.mRowBytes >= static_cast<size_t>(h.mHeight)
+					&& memcmp(data + sizeof(h), k.data(), k.size()) == 0) {
+				ci::Surface8u		s(h.mWidth, h.mHeight, h.mAlpha != 0, ci::SurfaceChannelOrder(h.mChannelOrder));
+				const size_t		row_bytes = std::min<size_t>(h.mRowBytes, s.getRowBytes());
+				for (int32_t y=0; y<h.mHeight; ++y) {
+					memcpy(s.getData() + y * s.getRowBytes(), data + pixels + y * h.mRowBytes, row_bytes);
+				}
+				out = s;
+				loaded = true;
+			}
+		}
+		if (loaded) file.setLastModified(Poco::Timestamp());
+	} catch (std::exception const&) {
+		// Another thread may be replacing or trimming it.
+	}
+
+	Poco::FastMutex::ScopedLock		l(mMutex);
+	auto							found = mEntries.find(name);
+	if (found != mEntries.end()) {
+		if (loaded) found->second.mLastUse = Poco::Timestamp().epochMicroseconds();
+		else removeLocked(name);
+	}
+	return loaded;
+}
+
+void SurfaceDiskCache::save(const ImageKey& key, const std::string& filename, const ci::Surface8u& s) {
+	if (!s) return;
+	const std::string				k = makeKey(key, filename);
+	const std::string				name = makeName(k);
+	std::string						path, tmp;
+	{
+		Poco::FastMutex::ScopedLock	l(mMutex);
+		if (mPath.empty() || k.empty()) return;
+		path = mPath + name;
+		std::stringstream			buf;
+		buf << path << "." << (mTmpCount++) << ".tmp";
+		tmp = buf.str();
+	}
+
+	Header							h;
+	memcpy(h.mMagic, MAGIC, sizeof(MAGIC));
+	h.mVersion = VERSION;
+	h.mWidth = s.getWidth();
+	h.mHeight = s.getHeight();
+	h.mAlpha = (s.hasAlpha() ? 1 : 0);
+	h.mChannelOrder = s.getChannelOrder().getCode();
+	h.mRowBytes = static_cast<uint32_t>(s.getWidth() * s.getPixelInc());
+	h.mKeySize = static_cast<uint32_t>(k.size());
+	const size_t					bytes = sizeof(h) + k.size() + static_cast<size_t>(h.mRowBytes) * h.mHeight;
+
+	// Write somewhere private, then move it into place, so readers never see half a file.
+	try {
+		{
+			std::ofstream			out(tmp.c_str(), std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+			if (!out) return;
+			out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+			out.write(k.data(), k.size());
+			for (int32_t y=0; y<h.mHeight; ++y) {
+				out.write(reinterpret_cast<const char*>(s.getData() + y * s.getRowBytes()), h.mRowBytes);
+			}
+			if (!out) throw std::runtime_error("write failed");
+		}
+		Poco::File(tmp).renameTo(path);
+	} catch (std::exception const& ex) {
+		DS_LOG_WARNING_M("SurfaceDiskCache::save() failed on " << filename << " (" << ex.what() << ")", DISK_CACHE_LOG_M);
+		try {
+			Poco::File(tmp).remove();
+		} catch (std::exception const&) {
+		}
+		return;
+	}
+
+	Poco::FastMutex::ScopedLock		l(mMutex);
+	auto							found = mEntries.find(name);
+	if (found != mEntries.end()) mBytes -= found->second.mBytes;
+	mEntries[name] = Entry(bytes, Poco::Timestamp().epochMicroseconds());
+	mBytes += bytes;
+	trimLocked();
+}
+
+std::string SurfaceDiskCache::makeKey(const ImageKey& key, const std::string& filename) const {
+	std::stringstream				buf;
+	try {
+		Poco::File					file(filename);
+		if (!file.exists()) return std::string();
+		buf << key.mFilename << "\n" << key.mIpKey << "\n" << key.mIpParams << "\n" << key.mFlags << "\n" << key.mMaxSize
+			<< "\n" << file.getSize() << "\n" << file.getLastModified().epochMicroseconds();
+	} catch (std::exception const&) {
+		return std::string();
+	}
+	return buf.str();
+}
+
+std::string SurfaceDiskCache::makeName(const std::string& key) const {
+	std::stringstream				buf;
+	buf << std::hex << std::setfill('0') << std::setw(16) << hash_key(key) << "." << EXTENSION;
+	return buf.str();
+}
+
+void SurfaceDiskCache::scanLocked() {
+	Poco::DirectoryIterator			end;
+	for (Poco::DirectoryIterator it(mPath); it!=end; ++it) {
+		try {
+			if (!it->isFile()) continue;
+			const std::string		name = it.name();
+			if (Poco::Path(name).getExtension() == EXTENSION) {
+				const size_t		bytes = static_cast<size_t>(it->getSize());
+				mEntries[name] = Entry(bytes, it->getLastModified().epochMicroseconds());
+				mBytes += bytes;
+			} else if (Poco::Path(name).getExtension() == "tmp") {
+				// Left behind by a save that didn't finish.
+				Poco::File(it.path()).remove();
+			}
+		} catch (std::exception const&) {
+		}
+	}
+}
+
+void SurfaceDiskCache::trimLocked() {
+	if (mBytes <= mMaxBytes) return;
+
+	std::vector<std::pair<int64_t, std::string>>	lru;
+	lru.reserve(mEntries.size());
+	for (auto it=mEntries.begin(), end=mEntries.end(); it!=end; ++it) {
+		lru.push_back(std::pair<int64_t, std::string>(it->second.mLastUse, it->first));
+	}
+	std::sort(lru.begin(), lru.end());
+	for (auto it=lru.begin(), end=lru.end(); it!=end && mBytes > mMaxBytes; ++it) {
+		removeLocked(it->second);
+	}
+}
+
+void SurfaceDiskCache::removeLocked(const std::string& name) {
+	auto							found = mEntries.find(name);
+	if (found == mEntries.end()) return;
+	mBytes -= found->second.mBytes;
+	mEntries.erase(found);
+	try {
+		Poco::File(mPath + name).remove();
+	} catch (std::exception const&) {
+		// Probably mapped by a reader. It's no longer indexed, so it'll be
+		// picked up again on the next launch and trimmed then if need be.
+	}
+}
+
+/**
+ * \class ds::ui::SurfaceDiskCache::Entry
+ */
+SurfaceDiskCache::Entry::Entry(const size_t bytes, const int64_t last_use)
+		: mBytes(bytes)
+		, mLastUse(last_use) {
+}
+
+} // namespace ui
+} // namespace ds
@@ -0,0 +1,71 @@
+#pragma once
+#ifndef DS_UI_SERVICE_SURFACEDISKCACHE_H_
+#define DS_UI_SERVICE_SURFACEDISKCACHE_H_
+
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+#include <Poco/Mutex.h>
+#include <cinder/Surface.h>
+
+namespace ds {
+namespace ui {
+class ImageKey;
+
+/**
+ * \class ds::ui::SurfaceDiskCache
+ * \brief A folder of finished image surfaces (decoded, shrunk and run
+ * through their ip function), so a later load is a file map and a copy
+ * instead of a decode. Each entry is one file: a small header, the full
+ * key, then the pixel rows. Entries are keyed on the ImageKey plus the
+ * source file's size and modification time, so an edited source is
+ * never served stale. The folder is kept under a size cap by deleting
+ * the least recently used entries. Safe to use from any thread.
+ */
+class SurfaceDiskCache {
+public:
+	SurfaceDiskCache();
+
+	// An empty path or a cap of 0 bytes turns the cache off. The folder
+	// is created if it doesn't exist, and trimmed to the cap.
+	void						setTo(const std::string& path, const size_t max_bytes);
+	bool						isEnabled() const;
+
+	// filename is the expanded path to the source image.
+	bool						load(const ImageKey&, const std::string& filename, ci::Surface8u&);
+	void						save(const ImageKey&, const std::string& filename, const ci::Surface8u&);
+
+private:
+	SurfaceDiskCache(const SurfaceDiskCache&);
+	SurfaceDiskCache&			operator=(const SurfaceDiskCache&);
+
+	class Entry {
+	public:
+		Entry(const size_t bytes = 0, const int64_t last_use = 0);
+
+		size_t					mBytes;
+		int64_t					mLastUse;
+	};
+
+	// Answer an empty string if the source can't be found.
+	std::string					makeKey(const ImageKey&, const std::string& filename) const;
+	// Answer the entry file name for a key.
+	std::string					makeName(const std::string& key) const;
+	void						scanLocked();
+	void						trimLocked();
+	void						removeLocked(const std::string& name);
+
+	mutable Poco::FastMutex		mMutex;
+	std::string					mPath;
+	size_t						mMaxBytes,
+								mBytes;
+	int							mTmpCount;
+	// By entry file name
+	std::unordered_map<std::string, Entry>
+								mEntries;
+};
+
+} // namespace ui
+} // namespace ds
+
+#endif // DS_UI_SERVICE_SURFACEDISKCACHE_H_
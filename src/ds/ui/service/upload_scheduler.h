@@ -0,0 +1,214 @@
+#pragma once
+#ifndef DS_UI_SERVICE_UPLOADSCHEDULER_H_
+#define DS_UI_SERVICE_UPLOADSCHEDULER_H_
+
+#include <cstddef>
+#include <deque>
+#include <cinder/Timer.h>
+
+namespace ds {
+namespace ui {
+
+/**
+ * \class ds::ui::UploadStats
+ * \brief What an UploadScheduler did on its last run, plus a histogram of
+ * how long every run that uploaded something took.
+ */
+class UploadStats {
+public:
+	// Buckets are under 1 ms, under 2 ms, under 4 ms ... under 128 ms, and the rest.
+	static const int			HISTOGRAM_SIZE = 9;
+
+	UploadStats();
+
+	// Answer the histogram bucket for a run that took this long.
+	static int					getBucket(const double seconds);
+
+	int							mUploaded;
+	size_t						mBytes;
+	int							mPending;
+	double						mSeconds;
+	int							mHistogram[HISTOGRAM_SIZE];
+};
+
+/**
+ * \class ds::ui::UploadScheduler
+ * \brief Spread texture uploads across frames. Items wait in priority
+ * order, oldest first, and each run() uploads until the frame's byte or
+ * time budget is spent. At least one item is uploaded per run, so a
+ * single huge texture can't stall the queue. The upload itself is done
+ * by an Uploader, so there's no GL in here.
+ */
+template <typename T>
+class UploadScheduler {
+public:
+	static const int			PRIORITY_COUNT = 3;
+
+	class Uploader {
+	public:
+		virtual ~Uploader()		{ }
+		// Answer the bytes uploaded, 0 if the item was dropped.
+		virtual size_t			upload(T&) = 0;
+	};
+
+public:
+	UploadScheduler();
+
+	// A budget of 0 is unlimited.
+	void						setBudget(const size_t bytes, const double seconds);
+
+	// Priority is 0 to PRIORITY_COUNT-1, highest is uploaded first.
+	void						push(const T&, const int priority);
+	// Raise every waiting item where match(item) is true. Fn is bool(const T&).
+	template <typename Fn>
+	void						prioritize(const Fn& match, const int priority);
+
+	bool						empty() const;
+	size_t						size() const;
+
+	// Upload one frame's worth.
+	void						run(Uploader&);
+	void						clear();
+
+	const UploadStats&			getStats() const;
+	void						clearHistogram();
+
+private:
+	static int					clampPriority(const int);
+	// Answer false if nothing's waiting.
+	bool						popNext(T&);
+
+	size_t						mBudgetBytes;
+	double						mBudgetSeconds;
+	std::deque<T>				mQueue[PRIORITY_COUNT];
+	UploadStats					mStats;
+};
+
+/**
+ * implementation
+ */
+inline UploadStats::UploadStats()
+		: mUploaded(0)
+		, mBytes(0)
+		, mPending(0)
+		, mSeconds(0.0) {
+	for (int k=0; k<HISTOGRAM_SIZE; ++k) mHistogram[k] = 0;
+}
+
+inline int UploadStats::getBucket(const double seconds) {
+	double						limit = 0.001;
+	for (int k=0; k<HISTOGRAM_SIZE-1; ++k) {
+		if (seconds < limit) return k;
+		limit *= 2.0;
+	}
+	return HISTOGRAM_SIZE-1;
+}
+
+template <typename T>
+UploadScheduler<T>::UploadScheduler()
+		: mBudgetBytes(0)
+		, mBudgetSeconds(0.0) {
+}
+
+template <typename T>
+void UploadScheduler<T>::setBudget(const size_t bytes, const double seconds) {
+	mBudgetBytes = bytes;
+	mBudgetSeconds = (seconds > 0.0 ? seconds : 0.0);
+}
+
+template <typename T>
+void UploadScheduler<T>::push(const T& item, const int priority) {
+	mQueue[clampPriority(priority)].push_back(item);
+}
+
+template <typename T>
+template <typename Fn>
+void UploadScheduler<T>::prioritize(const Fn& match, const int priority) {
+	const int					to = clampPriority(priority);
+	for (int p=0; p<to; ++p) {
+		std::deque<T>&			q = mQueue[p];
+		for (auto it=q.begin(); it!=q.end(); ) {
+			if (match(*it)) {
+				mQueue[to].push_back(*it);
+				it = q.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+}
+
+template <typename T>
+bool UploadScheduler<T>::empty() const {
+	return size() < 1;
+}
+
+template <typename T>
+size_t UploadScheduler<T>::size() const {
+	size_t						ans = 0;
+	for (int p=0; p<PRIORITY_COUNT; ++p) ans += mQueue[p].size();
+	return ans;
+}
+
+template <typename T>
+void UploadScheduler<T>::run(Uploader& uploader) {
+	mStats.mUploaded = 0;
+	mStats.mBytes = 0;
+	mStats.mSeconds = 0.0;
+	if (empty()) {
+		mStats.mPending = 0;
+		return;
+	}
+
+	ci::Timer					timer(true);
+	T							item;
+	while (popNext(item)) {
+		mStats.mBytes += uploader.upload(item);
+		++mStats.mUploaded;
+		if (mBudgetBytes > 0 && mStats.mBytes >= mBudgetBytes) break;
+		if (mBudgetSeconds > 0.0 && timer.getSeconds() >= mBudgetSeconds) break;
+	}
+	item = T();
+	mStats.mSeconds = timer.getSeconds();
+	mStats.mPending = static_cast<int>(size());
+	++mStats.mHistogram[UploadStats::getBucket(mStats.mSeconds)];
+}
+
+template <typename T>
+void UploadScheduler<T>::clear() {
+	for (int p=0; p<PRIORITY_COUNT; ++p) mQueue[p].clear();
+	mStats.mPending = 0;
+}
+
+template <typename T>
+const UploadStats& UploadScheduler<T>::getStats() const {
+	return mStats;
+}
+
+template <typename T>
+void UploadScheduler<T>::clearHistogram() {
+	for (int k=0; k<UploadStats::HISTOGRAM_SIZE; ++k) mStats.mHistogram[k] = 0;
+}
+
+template <typename T>
+int UploadScheduler<T>::clampPriority(const int p) {
+	if (p < 0) return 0;
+	if (p >= PRIORITY_COUNT) return PRIORITY_COUNT-1;
+	return p;
+}
+
+template <typename T>
+bool UploadScheduler<T>::popNext(T& out) {
+	for (int p=PRIORITY_COUNT-1; p>=0; --p) {
+		if (mQueue[p].empty()) continue;
+		out = mQueue[p].front();
+		mQueue[p].pop_front();
+		return true;
+	}
+	return false;
+}
+
+} // namespace ui
+} // namespace ds
+
+#endif // DS_UI_SERVICE_UPLOADSCHEDULER_H_
@@ -1,4 +1,6 @@
 #include "sprite.h"
+#include <algorithm>
+#include <cmath>
 #include <cinder/Camera.h>
 #include <cinder/gl/gl.h>
 #include "gl/GL.h"
@@ -6,6 +8,7 @@
 #include "ds/app/blob_registry.h"
 #include "ds/app/camera_utils.h"
 #include "ds/app/environment.h"
+#include "ds/data/compact_floats.h"
 #include "ds/data/data_buffer.h"
 #include "ds/debug/logger.h"
 #include "ds/math/math_defs.h"
@@ -25,6 +28,7 @@ namespace ds {
 namespace ui {
 
 const char          SPRITE_ID_ATTRIBUTE = 1;
+const char          SPRITE_ID_COMPACT_ATTRIBUTE = 2;
 
 namespace {
 char                BLOB_TYPE         = 0;
@@ -42,6 +46,10 @@ const DirtyState	OPACITY_DIRTY		= newUniqueDirtyState();
 const DirtyState	BLEND_MODE			= newUniqueDirtyState();
 const DirtyState	CLIPPING_BOUNDS		= newUniqueDirtyState();
 const DirtyState	SORTORDER_DIRTY		= newUniqueDirtyState();
+// Not an attribute: the next write can't be a delta against the last one,
+// because the receiver might be starting from scratch (i.e. the world is
+// being sent). Set by markTreeAsDirty(), since that fills every state.
+const DirtyState	ABSOLUTE_DIRTY		= newUniqueDirtyState();
 
 const char			PARENT_ATT			= 2;
 const char			SIZE_ATT			= 3;
@@ -54,6 +62,17 @@ const char			OPACITY_ATT			= 9;
 const char			BLEND_ATT			= 10;
 const char			CLIP_BOUNDS_ATT		= 11;
 const char			SORTORDER_ATT		= 12;
+// Compact encodings of the above. Readers accept both.
+const char			PARENT_COMPACT_ATT		= 13;
+const char			SIZE_COMPACT_ATT		= 14;
+const char			FLAGS_COMPACT_ATT		= 15;
+const char			POSITION_COMPACT_ATT	= 16;
+const char			CENTER_COMPACT_ATT		= 17;
+const char			SCALE_COMPACT_ATT		= 18;
+const char			COLOR_COMPACT_ATT		= 19;
+const char			OPACITY_COMPACT_ATT		= 20;
+const char			CLIP_BOUNDS_COMPACT_ATT	= 21;
+const char			SORTORDER_COMPACT_ATT	= 22;
 
 // flags
 const int           VISIBLE_F			= (1<<0);
@@ -64,8 +83,24 @@ const int           CLIP_F				= (1<<4);
 const int           SHADER_CHILDREN_F	= (1<<5);
 const int           NO_REPLICATION_F	= (1<<6);
 const int           ROTATE_TOUCHES_F	= (1<<7);
+const int           LOW_PRECISION_F		= (1<<8);
 
 const ds::BitMask   SPRITE_LOG        = ds::Logger::newModule("sprite");
+
+// Bumped whenever any sprite's transform or parent changes. A global
+// transform checked at the current generation is still good.
+uint64_t			TRANSFORM_GENERATION = 1;
+// Every global transform that gets built is stamped with a new value, so
+// children can tell when their parent's global transform has changed.
+uint64_t			GLOBAL_TRANSFORM_STAMP = 0;
+}
+
+void* Sprite::operator new(size_t size) {
+	return SpritePool::get().allocate(size);
+}
+
+void Sprite::operator delete(void* p, size_t size) {
+	SpritePool::get().deallocate(p, size);
 }
 
 Sprite& Sprite::makeSprite(SpriteEngine &e, Sprite *parent) {
@@ -82,12 +117,26 @@ void Sprite::installAsClient(ds::BlobRegistry& registry) {
 
 void Sprite::handleBlobFromClient(ds::BlobReader& r) {
 	ds::DataBuffer&       buf(r.mDataBuffer);
-	if (buf.read<char>() != SPRITE_ID_ATTRIBUTE) return;
-	ds::sprite_id_t       id = buf.read<ds::sprite_id_t>();
+	ds::sprite_id_t       id;
+	if (!readSpriteId(buf, id)) return;
 	Sprite*               s = r.mSpriteEngine.findSprite(id);
 	if (s) s->readFrom(r);
 }
 
+bool Sprite::readSpriteId(ds::DataBuffer& buf, ds::sprite_id_t& id) {
+	if (!buf.canRead<char>()) return false;
+	const char            att = buf.read<char>();
+	if (att == SPRITE_ID_COMPACT_ATTRIBUTE) {
+		id = static_cast<ds::sprite_id_t>(buf.readVarint());
+		return true;
+	}
+	if (att == SPRITE_ID_ATTRIBUTE && buf.canRead<ds::sprite_id_t>()) {
+		id = buf.read<ds::sprite_id_t>();
+		return true;
+	}
+	return false;
+}
+
 Sprite::Sprite( SpriteEngine& engine, float width /*= 0.0f*/, float height /*= 0.0f*/ )
     : SpriteAnimatable(*this, engine)
 	, mEngine(engine)
@@ -129,8 +178,18 @@ void Sprite::init(const ds::sprite_id_t id) {
 	mRotation = ci::Vec3f(0.0f, 0.0f, 0.0f);
 	mZLevel = 0.0f;
 	mScale = ci::Vec3f(1.0f, 1.0f, 1.0f);
-	mUpdateTransform = true;
 	mParent = nullptr;
+	mHitBoundsDirty = true;
+	mHitBoundsMoved = true;
+	mSortedChildrenDirty = true;
+	mZLevelChildrenDirty = true;
+	invalidateTransform();
+	mGlobalCheckedAt = 0;
+	mGlobalStamp = 0;
+	mGlobalParentStamp = 0;
+	mGlobalParent = nullptr;
+	mGlobalTransformDirty = true;
+	mInverseGlobalDirty = true;
 	mOpacity = 1.0f;
 	mColor = ci::Color(1.0f, 1.0f, 1.0f);
 	mMultiTouchEnabled = false;
@@ -149,6 +208,7 @@ void Sprite::init(const ds::sprite_id_t id) {
 	mDelayedCallCueRef = nullptr;
 
 	setSpriteId(id);
+	markAsDirty(ABSOLUTE_DIRTY);
 
 	mServerColor = ci::ColorA(static_cast<float>(math::random()*0.5 + 0.5),
 		static_cast<float>(math::random()*0.5 + 0.5),
@@ -168,6 +228,7 @@ Sprite::~Sprite() {
 	const sprite_id_t	id = mId;
     setSpriteId(ds::EMPTY_SPRITE_ID);
 
+	if (!mChildren.empty()) ++TRANSFORM_GENERATION;
 	for (auto it=mChildren.begin(), end=mChildren.end(); it!=end; ++it) {
 		(*it)->mParent = nullptr;
 		// Make sure the destructor doesn't ask the engine to delete
@@ -267,7 +328,7 @@ void Sprite::drawClient( const ci::Matrix44f &trans, const DrawParams &drawParam
 		}
 	} else {
 		makeSortedChildren();
-		for ( auto it = mSortedTmp.begin(), it2 = mSortedTmp.end(); it != it2; ++it ) {
+		for ( auto it = mSortedChildren.begin(), it2 = mSortedChildren.end(); it != it2; ++it ) {
 			(*it)->drawClient(totalTransformation, dParams);
 		}
 	}
@@ -315,12 +376,8 @@ void Sprite::drawServer( const ci::Matrix44f &trans, const DrawParams &drawParam
 			(*it)->drawServer(totalTransformation, drawParams);
 		}
 	} else {
-		std::vector<Sprite *> mCopy = mChildren;
-		std::sort( mCopy.begin(), mCopy.end(), [](Sprite *i, Sprite *j) {
-			return i->getZLevel() < j->getZLevel();
-		});
-
-		for ( auto it = mCopy.begin(), it2 = mCopy.end(); it != it2; ++it ) {
+		makeZLevelChildren();
+		for ( auto it = mZLevelChildren.begin(), it2 = mZLevelChildren.end(); it != it2; ++it ) {
 			(*it)->drawServer(totalTransformation, drawParams);
 		}
 	}
@@ -341,12 +398,17 @@ void Sprite::setPosition(const ci::Vec3f &pos) {
 bool Sprite::getInnerHit(const ci::Vec3f&) const {
 	return true;
 }
+
+bool Sprite::hasFrameHitBounds() const {
+	return true;
+}
 
 void Sprite::doSetPosition(const ci::Vec3f& pos) {
 	if (mPosition == pos) return;
 
+	if (mParent && mPosition.z != pos.z) mParent->mSortedChildrenDirty = true;
 	mPosition = pos;
-	mUpdateTransform = true;
+	invalidateTransform();
 	mBoundsNeedChecking = true;
 	markAsDirty(POSITION_DIRTY);
 	dimensionalStateChanged();
@@ -357,7 +419,7 @@ void Sprite::doSetScale(const ci::Vec3f& scale) {
 	if (mScale == scale) return;
 
 	mScale = scale;
-	mUpdateTransform = true;
+	invalidateTransform();
 	mBoundsNeedChecking = true;
 	markAsDirty(SCALE_DIRTY);
 	dimensionalStateChanged();
@@ -399,7 +461,7 @@ void Sprite::setCenter(const ci::Vec3f& center)
 	if (mCenter == center) return;
 	
 	mCenter = center;
-	mUpdateTransform = true;
+	invalidateTransform();
 	mBoundsNeedChecking = true;
 	markAsDirty(CENTER_DIRTY);
 	dimensionalStateChanged();
@@ -424,7 +486,7 @@ void Sprite::doSetRotation(const ci::Vec3f& rot) {
 		return;
 
 	mRotation = rot;
-	mUpdateTransform = true;
+	invalidateTransform();
 	mBoundsNeedChecking = true;
 	dimensionalStateChanged();
 }
@@ -436,7 +498,9 @@ ci::Vec3f Sprite::getRotation() const
 
 void Sprite::setZLevel( float zlevel )
 {
+    if (mZLevel == zlevel) return;
     mZLevel = zlevel;
+    if (mParent) mParent->mZLevelChildrenDirty = true;
 }
 
 float Sprite::getZLevel() const
@@ -507,6 +571,7 @@ void Sprite::addChild( Sprite &child )
     }
 
     mChildren.push_back(&child);
+    childOrderChanged();
     child.setParent(this);
     child.setPerspective(mPerspective);
     child.setDrawSorted(getDrawSorted());
@@ -521,6 +586,8 @@ void Sprite::addChildHack( Sprite &child )
     return;
 
   mChildren.push_back(&child);
+  childOrderChanged();
+  child.hitBoundsChanged(true);
   child.setPerspective(mPerspective);
   child.setDrawSorted(getDrawSorted());
   child.setUseDepthBuffer(mUseDepthBuffer);
@@ -533,6 +600,7 @@ void Sprite::removeChild( Sprite &child )
 
     auto found = std::find(mChildren.begin(), mChildren.end(), &child);
     mChildren.erase(found);
+    childOrderChanged();
     if (child.getParent() == this) {
       child.setParent(nullptr);
       child.setPerspective(false);
@@ -542,15 +610,26 @@ void Sprite::removeChild( Sprite &child )
 void Sprite::setParent( Sprite *parent ) {
     removeParent();
     mParent = parent;
-    if (mParent)
+    ++TRANSFORM_GENERATION;
+    hitBoundsChanged(true);
+    if (mParent) {
         mParent->addChild(*this);
+        // If I was already dirty, hitBoundsChanged() stopped at me, so my
+        // new ancestors have to be flagged on their own.
+        mParent->hitBoundsChanged(false);
+    }
     markAsDirty(PARENT_DIRTY);
 }
 
 void Sprite::removeParent() {
 	if (mParent) {
-		mParent->removeChild(*this);
+		// removeChild() can come back through setParent(nullptr) and clear mParent.
+		Sprite*		old_parent = mParent;
+		old_parent->removeChild(*this);
+		old_parent->hitBoundsChanged(false);
 		mParent = nullptr;
+		++TRANSFORM_GENERATION;
+		hitBoundsChanged(true);
 		markAsDirty(PARENT_DIRTY);
 	}
 }
@@ -578,6 +657,7 @@ void Sprite::clearChildren() {
 	if (mChildren.empty()) return;
     auto tempList = mChildren;
     mChildren.clear();
+    childOrderChanged();
 
     for ( auto it = tempList.begin(), it2 = tempList.end(); it != it2; ++it )
     {
@@ -607,6 +687,7 @@ void Sprite::buildTransform() const
     return;
 
     mUpdateTransform = false;
+    mGlobalTransformDirty = true;
 
     mTransformation = ci::Matrix44f::identity();
 
@@ -628,6 +709,13 @@ void Sprite::buildTransform() const
     mInverseTransform = mTransformation.inverted();
 }
 
+void Sprite::invalidateTransform()
+{
+	mUpdateTransform = true;
+	++TRANSFORM_GENERATION;
+	hitBoundsChanged(true);
+}
+
 void Sprite::setSizeAll( float width, float height, float depth )
 {
   if (mWidth == width && mHeight == height && mDepth == depth) return;
@@ -635,7 +723,7 @@ void Sprite::setSizeAll( float width, float height, float depth )
   mWidth = width;
   mHeight = height;
   mDepth = depth;
-  mUpdateTransform = true;
+  invalidateTransform();
   markAsDirty(SIZE_DIRTY);
   dimensionalStateChanged();
 }
@@ -762,17 +850,27 @@ bool Sprite::isEnabled() const {
 
 void Sprite::buildGlobalTransform() const
 {
-    buildTransform();
+	// Nothing anywhere has moved since I was last checked
+	if (mGlobalCheckedAt == TRANSFORM_GENERATION) return;
 
-    mGlobalTransform = mTransformation;
-
-    for ( Sprite *parent = mParent; parent; parent = parent->getParent() )
-    {
-      parent->buildTransform();
-      mGlobalTransform = parent->mTransformation * mGlobalTransform;
-    }
+	uint64_t			parentStamp = 0;
+	if (mParent) {
+		mParent->buildGlobalTransform();
+		parentStamp = mParent->mGlobalStamp;
+	}
+	buildTransform();
 
-    mInverseGlobalTransform = mGlobalTransform.inverted();
+	// Only rebuild if something in my own chain changed
+	if (mGlobalTransformDirty || mGlobalParent != mParent || mGlobalParentStamp != parentStamp) {
+		if (mParent) mGlobalTransform = mParent->mGlobalTransform * mTransformation;
+		else mGlobalTransform = mTransformation;
+		mGlobalTransformDirty = false;
+		mInverseGlobalDirty = true;
+		mGlobalParent = mParent;
+		mGlobalParentStamp = parentStamp;
+		mGlobalStamp = ++GLOBAL_TRANSFORM_STAMP;
+	}
+	mGlobalCheckedAt = TRANSFORM_GENERATION;
 }
 
 void Sprite::eventReceived(const ds::Event&) {
@@ -799,9 +897,7 @@ const ci::Matrix44f &Sprite::getGlobalTransform() const
 
 ci::Vec3f Sprite::globalToLocal( const ci::Vec3f &globalPoint )
 {
-    buildGlobalTransform();
-
-    ci::Vec4f point = mInverseGlobalTransform * ci::Vec4f(globalPoint.x, globalPoint.y, globalPoint.z, 1.0f);
+    ci::Vec4f point = getInverseGlobalTransform() * ci::Vec4f(globalPoint.x, globalPoint.y, globalPoint.z, 1.0f);
     return ci::Vec3f(point.x, point.y, point.z);
 }
 
@@ -845,6 +941,19 @@ bool Sprite::contains(const ci::Vec3f& point, const float pad) const {
 }
 
 Sprite* Sprite::getHit(const ci::Vec3f &point) {
+	return findHit(point, false);
+}
+
+Sprite* Sprite::getHitBounded(const ci::Vec3f &point) {
+	Sprite*		top = this;
+	while (top->mParent) top = top->mParent;
+	top->updateHitBounds(false);
+
+	if (!mHitSubtreeBounds.contains(point)) return nullptr;
+	return findHit(point, true);
+}
+
+Sprite* Sprite::findHit(const ci::Vec3f &point, const bool bounded) {
     // EH:  Not sure what bigworld was doing, but I don't see why we'd want to
     // select children of an invisible sprite.
     if (!visible()) {
@@ -864,7 +973,9 @@ Sprite* Sprite::getHit(const ci::Vec3f &point) {
         for ( auto it = mChildren.rbegin(), it2 = mChildren.rend(); it != it2; ++it )
         {
             Sprite *child = *it;
-            Sprite *hitChild = child->getHit(point);
+            if ( bounded && !child->mHitSubtreeBounds.contains(point) )
+                continue;
+            Sprite *hitChild = child->findHit(point, bounded);
             if ( hitChild )
                 return hitChild;
             if ( child->visible() && child->isEnabled() && child->contains(point) && child->getInnerHit(point) )
@@ -873,18 +984,15 @@ Sprite* Sprite::getHit(const ci::Vec3f &point) {
     }
     else
     {
-      mSortedTmp = mChildren;
-      std::sort( mSortedTmp.begin(), mSortedTmp.end(), [](Sprite *i, Sprite *j)
-      {
-        return i->getZLevel() < j->getZLevel();
-      });
-
-        for ( auto it = mSortedTmp.begin(), it2 = mSortedTmp.end(); it != it2; ++it )
+        makeZLevelChildren();
+        for ( auto it = mZLevelChildren.begin(), it2 = mZLevelChildren.end(); it != it2; ++it )
         {
             Sprite *child = *it;
+            if ( bounded && !child->mHitSubtreeBounds.contains(point) )
+                continue;
             if ( child->visible() && child->isEnabled() && child->contains(point) && child->getInnerHit(point) )
                 return child;
-            Sprite *hitChild = child->getHit(point);
+            Sprite *hitChild = child->findHit(point, bounded);
             if ( hitChild )
                 return hitChild;
         }
@@ -896,13 +1004,75 @@ Sprite* Sprite::getHit(const ci::Vec3f &point) {
     return nullptr;
 }
 
+void Sprite::hitBoundsChanged(const bool moved) {
+	if (moved) mHitBoundsMoved = true;
+	Sprite*		s = this;
+	while (s && !s->mHitBoundsDirty) {
+		s->mHitBoundsDirty = true;
+		s = s->mParent;
+	}
+}
+
+const Sprite::HitBounds& Sprite::updateHitBounds(bool force) {
+	force |= mHitBoundsMoved;
+	if (!force && !mHitBoundsDirty) return mHitSubtreeBounds;
+
+	if (force) buildOwnHitBounds();
+	mHitSubtreeBounds = mHitBounds;
+	for (auto it=mChildren.begin(), end=mChildren.end(); it!=end; ++it) {
+		mHitSubtreeBounds.add((*it)->updateHitBounds(force));
+	}
+	mHitBoundsDirty = false;
+	mHitBoundsMoved = false;
+	return mHitSubtreeBounds;
+}
+
+void Sprite::buildOwnHitBounds() {
+	mHitBounds.clear();
+	// Mirror the early outs in contains()
+	if (mWidth < 0.001f || mHeight < 0.001f) return;
+	if (mScale.x <= 0.0f || mScale.y <= 0.0f) return;
+	if (!hasFrameHitBounds()) {
+		mHitBounds.setUnbounded();
+		return;
+	}
+
+	buildGlobalTransform();
+	const ci::Vec4f		cA = mGlobalTransform * ci::Vec4f(0.0f,		0.0f,		0.0f, 1.0f);
+	const ci::Vec4f		cB = mGlobalTransform * ci::Vec4f(mWidth,	0.0f,		0.0f, 1.0f);
+	const ci::Vec4f		cC = mGlobalTransform * ci::Vec4f(mWidth,	mHeight,	0.0f, 1.0f);
+	const ci::Vec4f		v1 = cA - cB;
+	const ci::Vec4f		v2 = cC - cB;
+	const float			dot3 = v1.dot(v1);
+	const float			dot4 = v2.dot(v2);
+	const float			det = v1.x*v2.y - v1.y*v2.x;
+	// Tilted out of the screen plane, or degenerate. Don't try to be clever.
+	if (std::abs(v1.z) > 0.0001f || std::abs(v2.z) > 0.0001f || std::abs(det) < 0.000001f) {
+		mHitBounds.setUnbounded();
+		return;
+	}
+
+	// contains() accepts points where v.v1 is in [0, dot3] and v.v2 is in
+	// [0, dot4]. Solve for the four points at the extremes of those ranges.
+	for (int k=0; k<4; ++k) {
+		const float		s = ((k&1) ? dot3 : 0.0f);
+		const float		t = ((k&2) ? dot4 : 0.0f);
+		mHitBounds.add(	cB.x + (s*v2.y - t*v1.y) / det,
+						cB.y + (t*v1.x - s*v2.x) / det);
+	}
+	// Leave room for rounding differences against contains()
+	const float			ext = std::max(	std::max(std::abs(mHitBounds.mX1), std::abs(mHitBounds.mX2)),
+										std::max(std::abs(mHitBounds.mY1), std::abs(mHitBounds.mY2)));
+	mHitBounds.pad(0.01f + ext*0.0001f);
+}
+
 Sprite* Sprite::getPerspectiveHit(CameraPick& pick)
 {
 	if (!visible())
 		return nullptr;
 
 	makeSortedChildren();
-	for ( auto it = mSortedTmp.begin(), it2 = mSortedTmp.end(); it != it2; ++it ) {
+	for ( auto it = mSortedChildren.begin(), it2 = mSortedChildren.end(); it != it2; ++it ) {
 		Sprite*		hit = (*it)->getPerspectiveHit(pick);
 		if (hit) {
 			return hit;
@@ -942,8 +1112,9 @@ void Sprite::processTouchInfo(const TouchInfo &touchInfo) {
 }
 
 void Sprite::move(const ci::Vec3f &delta) {
+	if (mParent && delta.z != 0.0f) mParent->mSortedChildrenDirty = true;
 	mPosition += delta;
-	mUpdateTransform = true;
+	invalidateTransform();
 	mBoundsNeedChecking = true;
 	// XXX This REALLY should be going through doSetPosition().
 	// Don't know what the original thought was, but now I'm
@@ -953,8 +1124,9 @@ void Sprite::move(const ci::Vec3f &delta) {
 }
 
 void Sprite::move( float deltaX, float deltaY, float deltaZ ) {
+	if (mParent && deltaZ != 0.0f) mParent->mSortedChildrenDirty = true;
 	mPosition += ci::Vec3f(deltaX, deltaY, deltaZ);
-	mUpdateTransform = true;
+	invalidateTransform();
 	mBoundsNeedChecking = true;
 	// XXX This REALLY should be going through doSetPosition().
 	// Don't know what the original thought was, but now I'm
@@ -968,6 +1140,11 @@ bool Sprite::multiTouchEnabled() const {
 }
 
 const ci::Matrix44f& Sprite::getInverseGlobalTransform() const {
+	buildGlobalTransform();
+	if (mInverseGlobalDirty) {
+		mInverseGlobalTransform = mGlobalTransform.inverted();
+		mInverseGlobalDirty = false;
+	}
 	return mInverseGlobalTransform;
 }
 
@@ -1237,27 +1414,48 @@ bool Sprite::isDirty() const
   return !mDirty.isEmpty();
 }
 
-void Sprite::writeTo(ds::DataBuffer& buf) {
+void Sprite::prepareToWrite() {
 	if ((mSpriteFlags&NO_REPLICATION_F) != 0) return;
 	if (mDirty.isEmpty()) return;
+
+	prepareAttributesToWrite();
+	for (auto it=mChildren.begin(), end=mChildren.end(); it != end; ++it) {
+		if (*it) (*it)->prepareToWrite();
+	}
+}
+
+void Sprite::writeTo(ds::DataBuffer& buf) {
+	if (!writeSelfTo(buf)) return;
+
+	for (auto it=mChildren.begin(), end=mChildren.end(); it != end; ++it) {
+		(*it)->writeTo(buf);
+	}
+}
+
+bool Sprite::writeSelfTo(ds::DataBuffer& buf) {
+	if ((mSpriteFlags&NO_REPLICATION_F) != 0) return false;
+	if (mDirty.isEmpty()) return false;
 	if (mId == ds::EMPTY_SPRITE_ID) {
 		// This shouldn't be possible
 		DS_LOG_WARNING_M("Sprite::writeTo() on empty sprite ID", SPRITE_LOG);
-		return;
+		return false;
 	}
 
 	buf.add(mBlobType);
-	buf.add(SPRITE_ID_ATTRIBUTE);
-	buf.add(mId);
+	buf.add(SPRITE_ID_COMPACT_ATTRIBUTE);
+	buf.addVarint(mId);
 
 	writeAttributesTo(buf);
 	// Terminate the sprite and attribute list
 	buf.add(ds::TERMINATOR_CHAR);
 	// If I wrote any attributes then make sure to terminate the block
 	mDirty.clear();
+	return true;
+}
 
+void Sprite::getDirtyChildren(std::vector<Sprite*>& out) const {
 	for (auto it=mChildren.begin(), end=mChildren.end(); it != end; ++it) {
-		(*it)->writeTo(buf);
+		if (*it && !(*it)->mDirty.isEmpty()) out.push_back(*it);
 	}
 }
 
@@ -1269,66 +1467,68 @@ void Sprite::writeClientTo(ds::DataBuffer &buf) const {
 }
 
 void Sprite::writeAttributesTo(ds::DataBuffer &buf) {
+	// Transform and color are written as deltas against the last values sent,
+	// unless the receiver might be starting over.
+	const bool				delta = !mDirty.has(ABSOLUTE_DIRTY);
+	const bool				low = (mSpriteFlags&LOW_PRECISION_F) != 0;
+	const CompactFloatMode	pixel_mode = (low ? COMPACT_FIXED : COMPACT_FLOAT);
+	const CompactFloatMode	unit_mode = (low ? COMPACT_HALF : COMPACT_FLOAT);
+
 	if (mDirty.has(PARENT_DIRTY)) {
-		buf.add(PARENT_ATT);
-		if (mParent) buf.add(mParent->getId());
-		else buf.add(ds::EMPTY_SPRITE_ID);
+		buf.add(PARENT_COMPACT_ATT);
+		if (mParent) buf.addVarint(mParent->getId());
+		else buf.addVarint(ds::EMPTY_SPRITE_ID);
 	}
 	if (mDirty.has(SIZE_DIRTY)) {
-		buf.add(SIZE_ATT);
-		buf.add(mWidth);
-		buf.add(mHeight);
-		buf.add(mDepth);
+		const float			size[3] = { mWidth, mHeight, mDepth };
+		buf.add(SIZE_COMPACT_ATT);
+		add_compact_floats(buf, size, &mWire.mSize.x, 3, pixel_mode, delta);
 	}
 	if (mDirty.has(FLAGS_DIRTY)) {
-		buf.add(FLAGS_ATT);
-		buf.add(mSpriteFlags);
+		buf.add(FLAGS_COMPACT_ATT);
+		buf.addVarint(mSpriteFlags);
 	}
 	if (mDirty.has(POSITION_DIRTY)) {
-		buf.add(POSITION_ATT);
-		buf.add(mPosition.x);
-		buf.add(mPosition.y);
-		buf.add(mPosition.z);
+		buf.add(POSITION_COMPACT_ATT);
+		add_compact_floats(buf, &mPosition.x, &mWire.mPosition.x, 3, pixel_mode, delta);
 	}
 	if (mDirty.has(CENTER_DIRTY)) {
-		buf.add(CENTER_ATT);
-		buf.add(mCenter.x);
-		buf.add(mCenter.y);
-		buf.add(mCenter.z);
+		buf.add(CENTER_COMPACT_ATT);
+		add_compact_floats(buf, &mCenter.x, &mWire.mCenter.x, 3, pixel_mode, delta);
 	}
 	if (mDirty.has(SCALE_DIRTY)) {
-		buf.add(SCALE_ATT);
-		buf.add(mScale.x);
-		buf.add(mScale.y);
-		buf.add(mScale.z);
+		buf.add(SCALE_COMPACT_ATT);
+		add_compact_floats(buf, &mScale.x, &mWire.mScale.x, 3, unit_mode, delta);
 	}
 	if (mDirty.has(COLOR_DIRTY)) {
-		buf.add(COLOR_ATT);
-		buf.add(mColor.r);
-		buf.add(mColor.g);
-		buf.add(mColor.b);
+		buf.add(COLOR_COMPACT_ATT);
+		add_compact_floats(buf, &mColor.r, &mWire.mColor.r, 3, unit_mode, delta);
 	}
 	if (mDirty.has(OPACITY_DIRTY)) {
-		buf.add(OPACITY_ATT);
-		buf.add(mOpacity);
+		buf.add(OPACITY_COMPACT_ATT);
+		add_compact_floats(buf, &mOpacity, &mWire.mOpacity, 1, unit_mode, delta);
 	}
 	if (mDirty.has(BLEND_MODE)) {
 		buf.add(BLEND_ATT);
 		buf.add(mBlendMode);
 	}
 	if (mDirty.has(CLIPPING_BOUNDS)) {
-		buf.add(CLIP_BOUNDS_ATT);
-		buf.add(mClippingBounds.getX1());
-		buf.add(mClippingBounds.getY1());
-		buf.add(mClippingBounds.getX2());
-		buf.add(mClippingBounds.getY2());
+		const float			bounds[4] = {	mClippingBounds.getX1(), mClippingBounds.getY1(),
+											mClippingBounds.getX2(), mClippingBounds.getY2() };
+		float				ref[4];
+		buf.add(CLIP_BOUNDS_COMPACT_ATT);
+		add_compact_floats(buf, bounds, ref, 4, pixel_mode, false);
 	}
 	if (mDirty.has(SORTORDER_DIRTY)) {
-		// A flat list of ints, the first value is the number of ints
-		buf.add(SORTORDER_ATT);
-		buf.add<int32_t>(mChildren.size());
+		// The count, then each ID as the difference from the previous one.
+		// Siblings are usually created together, so that's typically 1 byte each.
+		buf.add(SORTORDER_COMPACT_ATT);
+		buf.addVarint(static_cast<uint32_t>(mChildren.size()));
+		sprite_id_t			prev = 0;
 		for (auto it=mChildren.begin(), end=mChildren.end(); it != end; ++it) {
-			buf.add<sprite_id_t>((*it) ? (*it)->getId() : 0);
+			const sprite_id_t	id = (*it) ? (*it)->getId() : 0;
+			buf.addZigzag(id - prev);
+			prev = id;
 		}
 	}
 }
@@ -1354,6 +1554,7 @@ void Sprite::readAttributesFrom(ds::DataBuffer& buf) {
 		} else if (id == FLAGS_ATT) {
 			mSpriteFlags = buf.read<int>();
 		} else if (id == POSITION_ATT) {
+			if (mParent) mParent->mSortedChildrenDirty = true;
 			mPosition.x = buf.read<float>();
 			mPosition.y = buf.read<float>();
 			mPosition.z = buf.read<float>();
@@ -1396,12 +1597,62 @@ void Sprite::readAttributesFrom(ds::DataBuffer& buf) {
 				} catch (std::exception const&) {
 				}
 			}
+		} else if (id == PARENT_COMPACT_ATT) {
+			const sprite_id_t     parentId = static_cast<sprite_id_t>(buf.readVarint());
+			Sprite*               parent = mEngine.findSprite(parentId);
+			if (parent) parent->addChild(*this);
+		} else if (id == SIZE_COMPACT_ATT) {
+			float				size[3];
+			if (read_compact_floats(buf, size, &mWire.mSize.x, 3)) {
+				mWidth = size[0];
+				mHeight = size[1];
+				mDepth = size[2];
+			}
+			transformChanged = true;
+		} else if (id == FLAGS_COMPACT_ATT) {
+			mSpriteFlags = static_cast<int>(buf.readVarint());
+		} else if (id == POSITION_COMPACT_ATT) {
+			if (mParent) mParent->mSortedChildrenDirty = true;
+			read_compact_floats(buf, &mPosition.x, &mWire.mPosition.x, 3);
+			transformChanged = true;
+		} else if (id == CENTER_COMPACT_ATT) {
+			read_compact_floats(buf, &mCenter.x, &mWire.mCenter.x, 3);
+			transformChanged = true;
+		} else if (id == SCALE_COMPACT_ATT) {
+			read_compact_floats(buf, &mScale.x, &mWire.mScale.x, 3);
+			transformChanged = true;
+		} else if (id == COLOR_COMPACT_ATT) {
+			read_compact_floats(buf, &mColor.r, &mWire.mColor.r, 3);
+		} else if (id == OPACITY_COMPACT_ATT) {
+			read_compact_floats(buf, &mOpacity, &mWire.mOpacity, 1);
+		} else if (id == CLIP_BOUNDS_COMPACT_ATT) {
+			float				bounds[4];
+			if (read_compact_floats(buf, bounds, bounds, 4)) {
+				mClippingBounds.set(bounds[0], bounds[1], bounds[2], bounds[3]);
+				markClippingDirty();
+			}
+		} else if (id == SORTORDER_COMPACT_ATT) {
+			const uint32_t				size = buf.readVarint();
+			// I'll assume anything beyond a certain size is a broken packet.
+			if (size > 0 && size < 10000) {
+				try {
+					std::vector<sprite_id_t>	order;
+					order.reserve(size);
+					sprite_id_t					prev = 0;
+					for (uint32_t k=0; k<size; ++k) {
+						prev += buf.readZigzag();
+						order.push_back(prev);
+					}
+					setSpriteOrder(order);
+				} catch (std::exception const&) {
+				}
+			}
 		} else {
 			readAttributeFrom(id, buf);
 		}
 	}
 	if (transformChanged) {
-		mUpdateTransform = true;
+		invalidateTransform();
 		mBoundsNeedChecking = true;
 		dimensionalStateChanged();
 	}
@@ -1612,10 +1863,27 @@ void Sprite::markClippingDirty()
 }
 
 void Sprite::makeSortedChildren() {
-	mSortedTmp = mChildren;
-	std::sort( mSortedTmp.begin(), mSortedTmp.end(), [](Sprite *i, Sprite *j) {
-		return i->getPosition().z < j->getPosition().z;
-	});
+	if (!mSortedChildrenDirty) return;
+	mSortedChildrenDirty = false;
+	// Assigning into the existing vector reuses its capacity
+	mSortedChildren.assign(mChildren.begin(), mChildren.end());
+	std::sort( mSortedChildren.begin(), mSortedChildren.end(), [](Sprite *i, Sprite *j) {
+		return i->getPosition().z < j->getPosition().z;
+	});
+}
+
+void Sprite::makeZLevelChildren() {
+	if (!mZLevelChildrenDirty) return;
+	mZLevelChildrenDirty = false;
+	mZLevelChildren.assign(mChildren.begin(), mChildren.end());
+	std::sort( mZLevelChildren.begin(), mZLevelChildren.end(), [](Sprite *i, Sprite *j) {
+		return i->getZLevel() < j->getZLevel();
+	});
+}
+
+void Sprite::childOrderChanged() {
+	mSortedChildrenDirty = true;
+	mZLevelChildrenDirty = true;
 }
 
 void Sprite::setSecondBeforeIdle( const double idleTime ) {
@@ -1662,6 +1930,16 @@ void Sprite::setRotateTouches(const bool on) {
 bool Sprite::isRotateTouches() const {
 	return ((mSpriteFlags&ROTATE_TOUCHES_F) != 0);
 }
+
+void Sprite::setLowPrecisionReplication(const bool on) {
+	// Only the server needs to know, the encoding is self-describing.
+	if (on) mSpriteFlags |= LOW_PRECISION_F;
+	else mSpriteFlags &= ~LOW_PRECISION_F;
+}
+
+bool Sprite::isLowPrecisionReplication() const {
+	return ((mSpriteFlags&LOW_PRECISION_F) != 0);
+}
 
 void Sprite::userInputReceived() {
 	if (mParent) {
@@ -1677,6 +1955,7 @@ void Sprite::sendSpriteToFront(Sprite &sprite) {
 
 	mChildren.erase(found);
 	mChildren.push_back(&sprite);
+	childOrderChanged();
 
 	markAsDirty(SORTORDER_DIRTY);
 }
@@ -1688,6 +1967,7 @@ void Sprite::sendSpriteToBack(Sprite &sprite) {
 
 	mChildren.erase(found);
 	mChildren.insert(mChildren.begin(), &sprite);
+	childOrderChanged();
 
 	markAsDirty(SORTORDER_DIRTY);
 }
@@ -1714,6 +1994,7 @@ void Sprite::setSpriteOrder(const std::vector<sprite_id_t> &order) {
 			mChildren.push_back(s);
 		}
 	}
+	childOrderChanged();
 }
 
 ds::ui::SpriteShader &Sprite::getBaseShader() {
@@ -1861,7 +2142,7 @@ Sprite::LockScale::LockScale(Sprite& s, const ci::Vec3f& temporaryScale)
 		, mScale(s.mScale) {
 	mSprite.mScale = temporaryScale;
 
-	mSprite.mUpdateTransform = true;
+	mSprite.invalidateTransform();
 	mSprite.buildTransform();
 	mSprite.computeClippingBounds();
 }
@@ -1869,10 +2150,78 @@ Sprite::LockScale::LockScale(Sprite& s, const ci::Vec3f& temporaryScale)
 Sprite::LockScale::~LockScale() {
 	mSprite.mScale = mScale;
 
-	mSprite.mUpdateTransform = true;
+	mSprite.invalidateTransform();
 	mSprite.buildTransform();
 	mSprite.computeClippingBounds();
 }
+
+/**
+ * \class ds::ui::Sprite::HitBounds
+ */
+Sprite::HitBounds::HitBounds() {
+	clear();
+}
+
+void Sprite::HitBounds::clear() {
+	mX1 = mY1 = mX2 = mY2 = 0.0f;
+	mEmpty = true;
+	mUnbounded = false;
+}
+
+void Sprite::HitBounds::setUnbounded() {
+	mEmpty = false;
+	mUnbounded = true;
+}
+
+void Sprite::HitBounds::add(const float x, const float y) {
+	if (mEmpty) {
+		mX1 = mX2 = x;
+		mY1 = mY2 = y;
+		mEmpty = false;
+		return;
+	}
+	if (x < mX1) mX1 = x;
+	if (x > mX2) mX2 = x;
+	if (y < mY1) mY1 = y;
+	if (y > mY2) mY2 = y;
+}
+
+void Sprite::HitBounds::add(const HitBounds& o) {
+	if (o.mEmpty) return;
+	if (o.mUnbounded) {
+		setUnbounded();
+		return;
+	}
+	if (mUnbounded) return;
+	add(o.mX1, o.mY1);
+	add(o.mX2, o.mY2);
+}
+
+void Sprite::HitBounds::pad(const float p) {
+	if (mEmpty || mUnbounded) return;
+	mX1 -= p;
+	mY1 -= p;
+	mX2 += p;
+	mY2 += p;
+}
+
+bool Sprite::HitBounds::contains(const ci::Vec3f& pt) const {
+	if (mEmpty) return false;
+	if (mUnbounded) return true;
+	return pt.x >= mX1 && pt.x <= mX2 && pt.y >= mY1 && pt.y <= mY2;
+}
+
+/**
+ * \class ds::ui::Sprite::WireState
+ */
+Sprite::WireState::WireState()
+		: mPosition(0.0f, 0.0f, 0.0f)
+		, mCenter(0.0f, 0.0f, 0.0f)
+		, mScale(0.0f, 0.0f, 0.0f)
+		, mSize(0.0f, 0.0f, 0.0f)
+		, mColor(0.0f, 0.0f, 0.0f)
+		, mOpacity(0.0f) {
+}
 
 } // namespace ui
 } // namespace ds
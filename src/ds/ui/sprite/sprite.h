@@ -3,6 +3,7 @@
 #define DS_UI_SPRITE_SPRITE_H_
 
 #include <exception>
+#include <stdint.h>
 #include "cinder/Cinder.h"
 #include <list>
 #include "cinder/Color.h"
@@ -13,6 +14,7 @@
 #include "ds/gl/uniform.h"
 #include "ds/util/bit_mask.h"
 #include "ds/ui/sprite/dirty_state.h"
+#include "ds/ui/sprite/sprite_pool.h"
 #include "ds/ui/touch/touch_process.h"
 #include "ds/ui/touch/multi_touch_constraints.h"
 #include "ds/ui/tween/sprite_anim.h"
@@ -40,6 +42,8 @@ struct TouchInfo;
 
 // Attribute access
 extern const char     SPRITE_ID_ATTRIBUTE;
+// The sprite ID written as a varint
+extern const char     SPRITE_ID_COMPACT_ATTRIBUTE;
 
 /*!
  * brief Base Class for App Entities
@@ -60,6 +64,17 @@ public:
 
 	template <typename T>
 	static void				removeAndDelete(T *&sprite);
+	// Fill the sprite pool so count sprites of type T can be created
+	// without it going to the heap.
+	template <typename T>
+	static void				prewarm(const size_t count);
+
+	// All sprites are allocated from ds::ui::SpritePool, so deleted
+	// sprites are recycled instead of fragmenting the heap.
+	static void*			operator new(size_t);
+	static void				operator delete(void*, size_t);
+	static void*			operator new(size_t, void* p)		{ return p; }
+	static void				operator delete(void*, void*)		{ }
 
 	Sprite(SpriteEngine&, float width = 0.0f, float height = 0.0f);
 	virtual ~Sprite();
@@ -214,6 +229,10 @@ public:
 
 	// finds Sprite at position
 	Sprite*					getHit( const ci::Vec3f &point );
+	// Same answer as getHit(), but skips any subtree whose cached global
+	// bounds don't contain the point. The bounds are kept for the whole
+	// tree I'm in, and only rebuilt for the parts that have moved.
+	Sprite*					getHitBounded( const ci::Vec3f &point );
 	Sprite*					getPerspectiveHit(CameraPick&);
 
 	void					setProcessTouchCallback( const std::function<void (Sprite *, const TouchInfo &)> &func );
@@ -250,7 +269,15 @@ public:
 	Sprite*					getDragDestination() const;
 
 	bool					isDirty() const;
+	// Main thread, before writeTo(): prepare every dirty sprite that will be
+	// written, parents before children. See prepareAttributesToWrite().
+	void					prepareToWrite();
 	void					writeTo(ds::DataBuffer&);
+	// The two halves of writeTo(), for writers that split up the tree. Write only
+	// my own blob, answering false if there was nothing to write, in which case my
+	// children have nothing to write either. Then write each of my dirty children.
+	bool					writeSelfTo(ds::DataBuffer&);
+	void					getDirtyChildren(std::vector<Sprite*>&) const;
 	void					readFrom(ds::BlobReader&);
 	// Only used when running in client mode
 	void					writeClientTo(ds::DataBuffer&) const;
@@ -286,6 +313,12 @@ public:
 	void					setRotateTouches(const bool = false);
 	bool					isRotateTouches() const;
 
+	// When true, my transform and color are replicated with reduced precision:
+	// position, center, size and clipping to 1/16th of a pixel, and scale, color
+	// and opacity as half floats. Worth it for sprites that animate constantly.
+	void					setLowPrecisionReplication(const bool = false);
+	bool					isLowPrecisionReplication() const;
+
 	bool					getPerspective() const;
 	// Total hack resulting from my unfamiliarity with 3D systems. This can sometimes be necessary for
 	// views that are inside of perspective cameras, but are expressed in screen coordinates.
@@ -322,7 +355,11 @@ protected:
 	void				processTouchInfoCallback( const TouchInfo &touchInfo );
 
 	void				buildTransform() const;
+	// Cheap to call repeatedly: the global transform is cached, and only
+	// rebuilt when my transform or an ancestor's has changed.
 	void				buildGlobalTransform() const;
+	// Call whenever anything affecting my local transform changes.
+	void				invalidateTransform();
 	virtual void		drawLocalClient();
 	virtual void		drawLocalServer();
 	bool				hasDoubleTap() const;
@@ -335,6 +372,9 @@ protected:
 	// stage that allows the sprite itself to determine if the point is interior,
 	// in the case that the sprite has transparency or other special rules.
 	virtual bool		getInnerHit(const ci::Vec3f&) const;
+	// Answer false if contains() can answer true for points outside my frame,
+	// so getHitBounded() never skips me.
+	virtual bool		hasFrameHitBounds() const;
 
 	virtual void		doSetPosition(const ci::Vec3f&);
 	virtual void		doSetScale(const ci::Vec3f&);
@@ -357,6 +397,11 @@ protected:
 	virtual void		markAsDirty(const DirtyState&);
 	// Special function that marks all children as dirty, without sending anything up the hierarchy.
 	virtual void		markChildrenAsDirty(const DirtyState&);
+	// Do anything writeAttributesTo() needs that touches more than this sprite,
+	// like resizing or laying out. Always called on the main thread.
+	virtual void		prepareAttributesToWrite() { }
+	// NOTE: When the server writes with multiple threads (server:write_threads),
+	// this is called on a worker thread, so it should only touch this sprite.
 	virtual void		writeAttributesTo(ds::DataBuffer&);
 	// Used during client mode, to let clients get info back to the server. Use the
 	// engine_io.defs::ScopedClientAtts at the top of the function to do all the boilerplate.
@@ -404,14 +449,42 @@ protected:
 
 	mutable ci::Matrix44f	mGlobalTransform;
 	mutable ci::Matrix44f	mInverseGlobalTransform;
+	// Global transform cache. mGlobalCheckedAt is the generation the global
+	// transform was last verified at, mGlobalStamp identifies the current
+	// global transform, and the parent values are what it was built from.
+	mutable uint64_t		mGlobalCheckedAt;
+	mutable uint64_t		mGlobalStamp;
+	mutable uint64_t		mGlobalParentStamp;
+	mutable const Sprite*	mGlobalParent;
+	mutable bool			mGlobalTransformDirty;
+	mutable bool			mInverseGlobalDirty;
 
 	ds::UserData			mUserData;
 
+	// The last values replicated for the attributes that change constantly.
+	// The compact encoding writes deltas against these, so the server and
+	// client each keep their own copy, updated in stream order.
+	class WireState {
+	public:
+		WireState();
+
+		ci::Vec3f			mPosition,
+							mCenter,
+							mScale,
+							mSize;
+		ci::Color			mColor;
+		float				mOpacity;
+	};
+	WireState				mWire;
+
 	Sprite*					mParent;
 	std::vector<Sprite *>	mChildren; 
-	// A cache for when I need to sort my children. This could be
-	// a lot more efficient, only running the sort when Z changes.
-	std::vector<Sprite*>	mSortedTmp;
+	// My children sorted by position z (client draw, perspective picking)
+	// and by z level (server draw, picking). Only rebuilt when marked dirty.
+	std::vector<Sprite*>	mSortedChildren,
+							mZLevelChildren;
+	bool					mSortedChildrenDirty,
+							mZLevelChildrenDirty;
 
 	// Class-unique key for this type.  Subclasses can replace.
 	char				mBlobType;
@@ -461,11 +534,38 @@ private:
 	void				readAttributesFrom(ds::DataBuffer&);
 
 	void				dimensionalStateChanged();
+	// Flag my hit bounds (and my ancestors') for an update. moved means my
+	// global transform changed, so everything below me needs recomputing.
+	void				hitBoundsChanged(const bool moved);
+	Sprite*				findHit(const ci::Vec3f& point, const bool bounded);
+
+	// An axis-aligned box in global space.
+	class HitBounds {
+	public:
+		HitBounds();
+
+		void			clear();
+		void			setUnbounded();
+		void			add(const float x, const float y);
+		void			add(const HitBounds&);
+		void			pad(const float);
+		bool			contains(const ci::Vec3f&) const;
+
+		float			mX1, mY1, mX2, mY2;
+		bool			mEmpty,
+						mUnbounded;
+	};
+	// Answer the bounds of my whole subtree. force recomputes everything,
+	// otherwise only the parts flagged by hitBoundsChanged() are.
+	const HitBounds&	updateHitBounds(bool force);
+	void				buildOwnHitBounds();
 	// Applies to all children, too.
 	void				markClippingDirty();
-	// Store all children in mSortedTmp by z order.
-	// XXX Need to optimize this so only built when needed.
+	// Rebuild mSortedChildren / mZLevelChildren if they're dirty.
 	void				makeSortedChildren();
+	void				makeZLevelChildren();
+	// My children were added, removed or reordered.
+	void				childOrderChanged();
 
 	ci::gl::Texture		mRenderTarget;
 	BlendMode			mBlendMode;
@@ -478,6 +578,11 @@ private:
 	bool				mUseShaderTexture; 
 
 	ci::ColorA			mServerColor;
+	// Cached for getHitBounded(). Whenever I'm dirty, so are my ancestors.
+	HitBounds			mHitBounds,
+						mHitSubtreeBounds;
+	bool				mHitBoundsDirty,
+						mHitBoundsMoved;
 	// This to make onSizeChanged() more efficient -- it can get
 	// triggered as a result of position changes, which shouldn't affect it.
 	float				mLastWidth, mLastHeight;
@@ -515,6 +620,8 @@ public:
 public:
 	static void			installAsServer(ds::BlobRegistry&);
 	static void			installAsClient(ds::BlobRegistry&);
+	// Read the sprite ID at the start of a blob, in either encoding.
+	static bool			readSpriteId(ds::DataBuffer&, ds::sprite_id_t&);
 
 	template <typename T>
 	static void			handleBlobFromServer(ds::BlobReader&);
@@ -539,6 +646,12 @@ static T& Sprite:: makeAlloc(const std::function<T*(void)>& allocFn, Sprite* par
   return *s;
 }
 
+template <typename T>
+void Sprite::prewarm(const size_t count)
+{
+  SpritePool::get().reserve(sizeof(T), count);
+}
+
 template <typename T>
 void Sprite::removeAndDelete( T *&sprite )
 {
@@ -554,8 +667,8 @@ template <typename T>
 static void Sprite::handleBlobFromServer(ds::BlobReader& r)
 {
   ds::DataBuffer&       buf(r.mDataBuffer);
-  if (buf.read<char>() != SPRITE_ID_ATTRIBUTE) return;
-  ds::sprite_id_t       id = buf.read<ds::sprite_id_t>();
+  ds::sprite_id_t       id;
+  if (!readSpriteId(buf, id)) return;
   Sprite*               s = r.mSpriteEngine.findSprite(id);
   if (s) {
     s->readFrom(r);
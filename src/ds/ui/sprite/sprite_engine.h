@@ -27,6 +27,7 @@ class Settings;
 }
 
 namespace ui {
+class FontService;
 class LoadImageService;
 class RenderTextService;
 class Sprite;
@@ -49,6 +50,8 @@ public:
 	virtual ds::WorkManager&		getWorkManager() = 0;
 	virtual ds::ResourceList&		getResources() = 0;
 	virtual const ds::FontList&		getFonts() const = 0;
+	// Every font that's been loaded, by file and size.
+	virtual FontService&			getFontService() = 0;
 	virtual ds::AutoUpdateList&		getAutoUpdateList(const int = AutoUpdateType::SERVER) = 0;
 	virtual LoadImageService&		getLoadImageService() = 0;
 	virtual RenderTextService&		getRenderTextService() = 0;
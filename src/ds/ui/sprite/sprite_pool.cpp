@@ -0,0 +1,129 @@
+#include "ds/ui/sprite/sprite_pool.h"
+
+#include <new>
+
+namespace ds {
+namespace ui {
+
+namespace {
+// Block sizes are rounded up to this, which also keeps them aligned.
+const size_t			GRANULARITY = 16;
+// Anything bigger goes straight to the heap.
+const size_t			MAX_BLOCK_SIZE = 8192;
+const size_t			SLAB_SIZE = 64 * 1024;
+
+size_t					bucket_index(const size_t size) {
+	return (size + GRANULARITY - 1) / GRANULARITY;
+}
+}
+
+/**
+ * \class ds::ui::SpritePool
+ */
+SpritePool& SpritePool::get() {
+	// Never destroyed. Sprites can outlive static destruction order.
+	static SpritePool*	POOL = new SpritePool();
+	return *POOL;
+}
+
+SpritePool::SpritePool()
+		: mBuckets(bucket_index(MAX_BLOCK_SIZE) + 1) {
+}
+
+void* SpritePool::allocate(const size_t size) {
+	const size_t			index = bucket_index(size);
+	if (size < 1 || index >= mBuckets.size()) {
+		void*				ans = ::operator new(size);
+		Poco::FastMutex::ScopedLock		l(mMutex);
+		++mStats.mAllocations;
+		++mStats.mInUse;
+		++mStats.mHeapAllocations;
+		return ans;
+	}
+
+	Poco::FastMutex::ScopedLock		l(mMutex);
+	Bucket&					b = mBuckets[index];
+	if (!b.mFree) grow(index);
+
+	void*					ans = b.mFree;
+	b.mFree = *static_cast<void**>(ans);
+	--b.mFreeCount;
+	++mStats.mAllocations;
+	++mStats.mInUse;
+	--mStats.mFree;
+	return ans;
+}
+
+void SpritePool::deallocate(void* p, const size_t size) {
+	if (!p) return;
+
+	const size_t			index = bucket_index(size);
+	if (size < 1 || index >= mBuckets.size()) {
+		::operator delete(p);
+		Poco::FastMutex::ScopedLock		l(mMutex);
+		--mStats.mInUse;
+		return;
+	}
+
+	Poco::FastMutex::ScopedLock		l(mMutex);
+	Bucket&					b = mBuckets[index];
+	*static_cast<void**>(p) = b.mFree;
+	b.mFree = p;
+	++b.mFreeCount;
+	--mStats.mInUse;
+	++mStats.mFree;
+}
+
+void SpritePool::reserve(const size_t size, const size_t count) {
+	const size_t			index = bucket_index(size);
+	if (size < 1 || index >= mBuckets.size()) return;
+
+	Poco::FastMutex::ScopedLock		l(mMutex);
+	while (mBuckets[index].mFreeCount < count) grow(index);
+}
+
+SpritePool::Stats SpritePool::getStats() const {
+	Poco::FastMutex::ScopedLock		l(mMutex);
+	return mStats;
+}
+
+void SpritePool::grow(const size_t index) {
+	const size_t			block_size = index * GRANULARITY;
+	size_t					count = SLAB_SIZE / block_size;
+	if (count < 1) count = 1;
+
+	// Throws std::bad_alloc, which is what operator new should do anyway.
+	char*					slab = static_cast<char*>(::operator new(block_size * count));
+	++mStats.mHeapAllocations;
+
+	Bucket&					b = mBuckets[index];
+	// Push in reverse so blocks are handed out in address order
+	for (size_t k=count; k>0; --k) {
+		void*				p = slab + (k-1) * block_size;
+		*static_cast<void**>(p) = b.mFree;
+		b.mFree = p;
+	}
+	b.mFreeCount += count;
+	mStats.mFree += count;
+}
+
+/**
+ * \class ds::ui::SpritePool::Stats
+ */
+SpritePool::Stats::Stats()
+		: mAllocations(0)
+		, mInUse(0)
+		, mFree(0)
+		, mHeapAllocations(0) {
+}
+
+/**
+ * \class ds::ui::SpritePool::Bucket
+ */
+SpritePool::Bucket::Bucket()
+		: mFree(nullptr)
+		, mFreeCount(0) {
+}
+
+} // namespace ui
+} // namespace ds
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef DS_UI_SPRITE_SPRITEPOOL_H_
+#define DS_UI_SPRITE_SPRITEPOOL_H_
+
+#include <vector>
+#include <Poco/Mutex.h>
+
+namespace ds {
+namespace ui {
+
+/**
+ * \class ds::ui::SpritePool
+ * \brief Recycling allocator behind Sprite::operator new / delete. Memory
+ * is handed out in fixed-size blocks carved from large slabs, with one free
+ * list per block size. Since every sprite class has its own size, this is
+ * effectively a pool per type, and a deleted sprite's memory goes straight
+ * to the next sprite of that type instead of back to the heap. Slabs are
+ * never released, so the pool only grows to the peak number of sprites.
+ */
+class SpritePool {
+public:
+	static SpritePool&		get();
+
+	void*					allocate(const size_t size);
+	void					deallocate(void*, const size_t size);
+	// Make sure at least count blocks that fit size are free.
+	void					reserve(const size_t size, const size_t count);
+
+	class Stats {
+	public:
+		Stats();
+
+		// Calls to allocate()
+		size_t				mAllocations;
+		// Blocks currently handed out
+		size_t				mInUse;
+		// Blocks waiting to be reused
+		size_t				mFree;
+		// Heap allocations made by the pool, slabs and oversize blocks
+		size_t				mHeapAllocations;
+	};
+	Stats					getStats() const;
+
+private:
+	SpritePool();
+	SpritePool(const SpritePool&);
+	SpritePool&				operator=(const SpritePool&);
+
+	class Bucket {
+	public:
+		Bucket();
+
+		// Intrusive list, each free block starts with the next pointer
+		void*				mFree;
+		size_t				mFreeCount;
+	};
+
+	// Add a slab of blocks to the bucket's free list.
+	void					grow(const size_t index);
+
+	mutable Poco::FastMutex	mMutex;
+	std::vector<Bucket>		mBuckets;
+	Stats					mStats;
+};
+
+} // namespace ui
+} // namespace ds
+
+#endif // DS_UI_SPRITE_SPRITEPOOL_H_
@@ -1,4 +1,5 @@
 #include "text.h"
+#include <algorithm>
 #include <map>
 #include <cinder/Vector.h>
 #include <cinder/app/App.h>
@@ -12,6 +13,8 @@
 #include "ds/cfg/settings.h"
 #include "ds/data/data_buffer.h"
 #include <ds/gl/save_camera.h>
+#include "ds/ui/service/font_service.h"
+#include "ds/ui/service/glyph_atlas_service.h"
 #include "ds/ui/sprite/sprite_engine.h"
 #include "cinder/Camera.h"
 #include <stdexcept>
@@ -28,24 +31,14 @@ namespace {
 //
 //std::map<std::string, std::map<float, ci::gl::TextureFontRef>>
 //                                  mTextureFonts;
-
-std::map<std::string, std::map<float, FontPtr>> mFontCache;
 }
 
 static const ds::BitMask   SPRITE_LOG        = ds::Logger::newModule("text sprite");
 //static ci::gl::TextureFontRef get_font(const std::string& filename, const float size);
 
-FontPtr get_font(const std::string& filename, const float size);
-
 namespace ds {
 namespace ui {
 
-
-void clearFontCache()
-{
-	mFontCache.clear();
-}
-
 namespace {
 char				BLOB_TYPE			= 0;
 
@@ -85,10 +78,12 @@ Text::Text(SpriteEngine& engine)
 	, mResizeLimitWidth(0)
 	, mResizeLimitHeight(0)
 	, mDebugShowFrame(engine.getDebugSettings().getBool("text:show_frame", 0, false))
-#ifdef TEXT_RENDER_ASYNC
+	, mGlyphAtlas(nullptr)
+	, mGlyphAtlasChecked(false)
 	, mShared(new RenderTextShared())
 	, mRenderClient(engine.getRenderTextService(), [this](RenderTextFinished& f) { this->onRenderFinished(f); })
-#endif
+	, mRenderRequest(0)
+	, mRenderAsyncFailed(false)
 {
 	mBlobType = BLOB_TYPE;
 	setTransparent(false);
@@ -150,7 +145,7 @@ Text& Text::setResizeLimit(const float width, const float height)
 
 Text& Text::setFont(const std::string& name, const float fontSize)
 {
-	mFont = get_font(mEngine.getFonts().getFileNameFromName(name), fontSize);
+	mFont = mEngine.getFontService().get(mEngine.getFonts().getFileNameFromName(name), fontSize);
 	mFontFileName = name;
 	mFontSize = fontSize;
 	markAsDirty(FONT_DIRTY);
@@ -170,7 +165,7 @@ void Text::updateServer(const UpdateParams& p)
 	// the texture to be created only in client or clientserver mode;
 	// this also drags in server mode.
 	if (mNeedRedrawing) {
-		drawIntoFbo();
+		redraw();
 	}
 }
 
@@ -181,7 +176,7 @@ void Text::updateClient(const UpdateParams& p)
 	// NOTE: Needs to be here. If this is called in drawLocalClient(),
 	// then the font won't render.
 	if (mNeedRedrawing) {
-		drawIntoFbo();
+		redraw();
 	}
 }
 
@@ -207,46 +202,9 @@ void Text::drawLocalClient()
 
   //if (!mTextureFont) return;
 
-#ifdef TEXT_RENDER_ASYNC
-	if (mTestTexture) {
-
-#if 0
-//if (mTextString == L"FCC Approval") {
-//if (mTextString == L"01.") {
-if (mTextString == L"D. Encore") {
-	int		fd = 32;
-	static int	C400 = 0;
-	std::cout << "w=" << mTestTexture.getWidth() << " h=" << mTestTexture.getHeight() << " C400=" << (++C400) << std::endl;
-}
-#endif
-#if 0
-if (mTextString == L"2010") {
-	int		fd = 32;
-	static int	C2010 = 0;
-//	std::cout << "w=" << mTestTexture.getWidth() << " h=" << mTestTexture.getHeight() << " C2010=" << (++C2010) << std::endl;
-	if (C2010 < 2) {
-		ci::Surface8u	s(mTestTexture);
-		ci::writeImage("C:\\Users\\erich\\Documents\\downstream\\wtf2010.png", s);
-	}
-}
-if (mTextString == L"2012") {
-	int		fd = 32;
-	static int	C2012 = 0;
-	std::cout << "w=" << mTestTexture.getWidth() << " h=" << mTestTexture.getHeight() << " C2012=" << (++C2012) << std::endl;
-	if (C2012 < 2) {
-		ci::Surface8u	s(mTestTexture);
-		ci::writeImage("C:\\Users\\erich\\Documents\\downstream\\wtf2012.png", s);
+	if (!mGlyphQuads.empty()) {
+		drawGlyphQuads();
 	}
-}
-#endif
-		mTestTexture.bind();
-		if (getPerspective())
-			ci::gl::drawSolidRect(ci::Rectf(0.0f, 0.0f, static_cast<float>(mTestTexture.getWidth()), static_cast<float>(mTestTexture.getHeight())));
-		else
-			ci::gl::drawSolidRect(ci::Rectf(0.0f, static_cast<float>(mTestTexture.getHeight()), static_cast<float>(mTestTexture.getWidth()), 0.0f));
-		mTestTexture.unbind();
-	}
-#endif
 
 	if (mTexture) {
 		mTexture.bind();
@@ -396,6 +354,13 @@ void Text::debugPrint()
 	mLayout.debugPrint();
 }
 
+void Text::prepareAttributesToWrite()
+{
+	// Laying out can resize me and measures through the shared font,
+	// so it can't wait for writeAttributesTo().
+	makeLayout();
+}
+
 void Text::writeAttributesTo(ds::DataBuffer& buf)
 {
 	inherited::writeAttributesTo(buf);
@@ -413,7 +378,6 @@ void Text::writeAttributesTo(ds::DataBuffer& buf)
 		buf.add(mFontSize);
 	}
 	if (mDirty.has(LAYOUT_DIRTY)) {
-		makeLayout();
 		buf.add(LAYOUT_ATT);
 		mLayout.writeTo(buf);
 	}
@@ -523,6 +487,98 @@ void Text::calculateFrame(const int flags)
   inherited::setSizeAll(w, h, mDepth);
 }
 
+void Text::redraw() {
+	if (!mGlyphAtlasChecked) {
+		mGlyphAtlasChecked = true;
+		try {
+			GlyphAtlasService&	s = mEngine.getService<GlyphAtlasService>(GLYPH_ATLAS_SERVICE);
+			if (s.isEnabled()) mGlyphAtlas = &s;
+		} catch (std::exception const&) {
+		}
+	}
+	mGlyphQuads.clear();
+	if (mGlyphAtlas && buildGlyphQuads()) return;
+	if (startRenderAsync()) return;
+	drawIntoFbo();
+}
+
+bool Text::startRenderAsync() {
+	if (mRenderAsyncFailed || !mRenderClient.isEnabled()) return false;
+
+	mNeedRedrawing = false;
+	// A new request makes anything still in flight out of date.
+	mShared->setLatestRequestId(++mRenderRequest);
+	const std::vector<TextLayout::Line>	lines(mLayout.getLines());
+	// Same size as drawIntoFbo()
+	const int					w = (int)ceilf(getWidth()) + 1;
+	const int					h = (int)ceilf(getHeight()) + 1;
+	if (!mFont || lines.empty() || w < 1 || h < 1) {
+		mTexture.reset();
+		return true;
+	}
+	// My current texture is drawn until the new one is ready.
+	mRenderClient.start(mEngine.getFonts().getFileNameFromName(mFontFileName), mFontSize,
+						lines, ci::Vec2f(mBorder.x1, mBorder.y1), w, h, mShared, mRenderRequest);
+	return true;
+}
+
+bool Text::buildGlyphQuads() {
+	mTexture.reset();
+	if (!mFont) return true;
+
+	auto& lines = mLayout.getLines();
+	if (lines.empty()) return true;
+
+	GlyphAtlas&					atlas = mGlyphAtlas->getAtlas();
+	const int					font = atlas.getFont(mEngine.getFonts().getFileNameFromName(mFontFileName), mFontSize);
+	if (font < 0) return false;
+
+	mNeedRedrawing = false;
+	// Same placement as drawIntoFbo(): the ink starts at the line position, and
+	// the baseline is a point size below it.
+	const float					height = mFont->pointSize();
+	for (auto it=lines.begin(), end=lines.end(); it!=end; ++it) {
+		const TextLayout::Line&	line(*it);
+		atlas.layout(font, line.mText, line.mPos.x+mBorder.x1, line.mPos.y+mBorder.y1 + height, mGlyphQuads);
+	}
+	// Group by page, so each page is bound once.
+	std::stable_sort(mGlyphQuads.begin(), mGlyphQuads.end(), [](const GlyphQuad& a, const GlyphQuad& b) { return a.mPage < b.mPage; });
+	return true;
+}
+
+void Text::drawGlyphQuads() {
+	// The FBO textures are drawn flipped in perspective, so the quads are too.
+	const bool					flip = getPerspective();
+	const float					h = mHeight;
+	int							page = -1;
+	ci::gl::Texture				tex;
+	for (auto it=mGlyphQuads.begin(), end=mGlyphQuads.end(); it!=end; ++it) {
+		const GlyphQuad&		q(*it);
+		if (q.mPage != page) {
+			if (tex) {
+				glEnd();
+				tex.unbind();
+			}
+			page = q.mPage;
+			tex = mGlyphAtlas->getTexture(page);
+			if (!tex) continue;
+			tex.bind();
+			glBegin(GL_QUADS);
+		}
+		if (!tex) continue;
+		const float				y1 = (flip ? h - q.mRect.y1 : q.mRect.y1),
+								y2 = (flip ? h - q.mRect.y2 : q.mRect.y2);
+		glTexCoord2f(q.mUv.x1, q.mUv.y1);	glVertex2f(q.mRect.x1, y1);
+		glTexCoord2f(q.mUv.x2, q.mUv.y1);	glVertex2f(q.mRect.x2, y1);
+		glTexCoord2f(q.mUv.x2, q.mUv.y2);	glVertex2f(q.mRect.x2, y2);
+		glTexCoord2f(q.mUv.x1, q.mUv.y2);	glVertex2f(q.mRect.x1, y2);
+	}
+	if (tex) {
+		glEnd();
+		tex.unbind();
+	}
+}
+
 void Text::drawIntoFbo() {
 	mTexture.reset();
 	if (!mFont) return;
@@ -532,19 +588,6 @@ void Text::drawIntoFbo() {
 
 	if (mNeedRedrawing) {
 		ds::gl::SaveCamera		save_camera;
-#ifdef TEXT_RENDER_ASYNC
-	int		code = 0;
-	if (mTextString == L"2010") code = 2010;
-	else if (mTextString == L"2012") code = 2012;
-	else if (mTextString == L"FCC Approval") {
-		code = 900;
-	} else if (mTextString == L"D. Encore") {
-		std::cout << "HERE" << std::endl;
-		code = 400;
-	}
-std::cout << "START=" << ds::utf8_from_wstr(mTextString) << std::endl;
-	mRenderClient.start(mEngine.getFonts().getFileNameFromName(mFontFileName), mFontSize, mShared, code);
-#endif
 		mNeedRedrawing = false;
 		// XXX I noticed some fonts were getting the bottom right row of pixels
 		// chopped off, so I did this, although realistically, it probably means
@@ -610,16 +653,15 @@ float Text::getLeading() const
 
 void Text::onRenderFinished(RenderTextFinished& finished)
 {
-#ifdef TEXT_RENDER_ASYNC
-std::cout << "onFinished code=" << finished.mCode << " text='" << ds::utf8_from_wstr(mTextString) << "'" << std::endl;
-if (mTextString == L"2010") {
-	std::cout << "Got 2010" << std::endl;
-}
-if (mTextString == L"2012") {
-	std::cout << "Got 2012" << std::endl;
-}
-	mTestTexture = finished.mTexture;
-#endif
+	// Anything older than my latest request is already out of date.
+	if (finished.mRequestId != mRenderRequest) return;
+	if (finished.mError) {
+		// My font can't be rasterized on the threads, so go back to drawing it myself.
+		mRenderAsyncFailed = true;
+		mNeedRedrawing = true;
+		return;
+	}
+	mTexture = finished.mTexture;
 }
 
 } // namespace ui
@@ -651,27 +693,3 @@ if (mTextString == L"2012") {
 //    mTextureFonts[filename][size] = tf;
 //    return tf;
 //}
-
-/**
- * miscellaneous
- */
-static FontPtr get_font(const std::string& filename, const float size)
-{
-  auto found = mFontCache.find(filename);
-  if ( found != mFontCache.end() )
-  {
-    auto found2 = found->second.find(size);
-    if ( found2 != found->second.end() )
-      return found2->second;
-  }
-
-  FontPtr font = FontPtr(new OGLFT::Translucent(filename.c_str(), size));
-
-  if (!font->isValid())
-    throw std::runtime_error("Font: " + filename + " was unable to load.");
-
-  font->setCompileMode(OGLFT::Face::COMPILE);
-
-  mFontCache[filename][size] = font;
-  return font;
-}
@@ -5,16 +5,15 @@
 #include <cinder/gl/TextureFont.h>
 #include <cinder/Text.h>
 #include <cinder/Font.h>
+#include "ds/ui/service/glyph_atlas.h"
 #include "ds/ui/service/render_text_service.h"
 #include "ds/ui/sprite/sprite.h"
 #include "ds/ui/sprite/text_layout.h"
 #include "cinder/gl/Fbo.h"
 
-//#define TEXT_RENDER_ASYNC		(1)
-
 namespace ds {
 namespace ui {
-void clearFontCache();
+class GlyphAtlasService;
 
 /**
  * \class ds::ui::Text
@@ -87,6 +86,7 @@ class Text: public Sprite
         void                      debugPrint();
 
     protected:
+        virtual void              prepareAttributesToWrite();
         virtual void              writeAttributesTo(ds::DataBuffer&);
         virtual void              readAttributeFrom(const char attributeId, ds::DataBuffer&);
 
@@ -99,6 +99,14 @@ class Text: public Sprite
         typedef Sprite inherited;
 
         void                      makeLayout();
+        // Build the glyph quads if the glyph atlas is on, otherwise draw into my own
+        // texture, on the render text threads if there are any.
+        void                      redraw();
+        // Answer false if the atlas can't be used for my font.
+        bool                      buildGlyphQuads();
+        // Answer false if the engine doesn't render text on threads.
+        bool                      startRenderAsync();
+        void                      drawGlyphQuads();
         void                      drawIntoFbo();
         // Only used when ResizeToText is on
         void                      calculateFrame(const int flags);
@@ -126,13 +134,18 @@ class Text: public Sprite
         const bool                mDebugShowFrame;
 
         ci::gl::Texture           mTexture;
-
-#ifdef TEXT_RENDER_ASYNC
-		std::shared_ptr<RenderTextShared>
-									mShared;
-		RenderTextClient			mRenderClient;
-		ci::gl::Texture				mTestTexture;
-#endif
+        // When the engine has a glyph atlas, I draw these instead of a texture of my own.
+        GlyphAtlasService*        mGlyphAtlas;
+        bool                      mGlyphAtlasChecked;
+        std::vector<GlyphQuad>    mGlyphQuads;
+
+        // When the text is rendered on threads, I keep drawing my old texture
+        // until the latest request comes back.
+        std::shared_ptr<RenderTextShared>
+                                  mShared;
+        RenderTextClient          mRenderClient;
+        int                       mRenderRequest;
+        bool                      mRenderAsyncFailed;
 
         // Initialization
     public:
@@ -60,6 +60,67 @@ class LimitCheck {
     const float   mMaxY;
 };
 
+// The characters a line can break at.
+inline bool is_partition(const wchar_t c)
+{
+  return c == L' ' || c == L'-' || c == L'|' || c == L'\n' || c == L'\r' || c == L'\t';
+}
+
+// Measure a line a character at a time from the font's table. The result
+// is exactly what getSizeFromString() answers for the same text.
+class LineMeasure {
+  public:
+    LineMeasure(OGLFT::Face& f)
+      : mFace(&f)
+    {
+    }
+
+    void clear()
+    {
+      mBox = OGLFT::BBox();
+    }
+
+    inline void append(const wchar_t c)
+    {
+      if (mFace->measureRawChar(c, mChar)) mBox += mChar;
+    }
+
+    void append(const std::wstring& s)
+    {
+      append(s, 0, s.size());
+    }
+
+    void append(const std::wstring& s, const size_t begin, const size_t end)
+    {
+      for (size_t k=begin; k<end; ++k) append(s[k]);
+    }
+
+    inline float width() const
+    {
+      return mBox.x_max_ - mBox.x_min_;
+    }
+
+  private:
+    OGLFT::Face*  mFace;
+    OGLFT::BBox   mBox,
+                  mChar;
+};
+
+// A laid out line, waiting for alignment.
+class OutLine {
+  public:
+    OutLine(const float y, const std::wstring& text, const float width)
+      : mY(y)
+      , mText(text)
+      , mWidth(width)
+    {
+    }
+
+    float         mY;
+    std::wstring  mText;
+    float         mWidth;
+};
+
 }
 
 /**
@@ -200,179 +261,108 @@ void TextLayoutVertical::run(const TextLayout::Input& in, TextLayout& out)
 {
   if (in.mText.empty())
     return;
-  // Per line, find the word breaks, then create a line.
-  std::vector<std::wstring>    tokens;
-  //tokenize(in.mText, tokens);
-  static std::vector<std::wstring> partitioners;
-  if (partitioners.empty()) {
-    partitioners.push_back(L" ");
-    partitioners.push_back(L"-");
-    partitioners.push_back(L"|");
-    //partitioners.push_back(L"_");
-    partitioners.push_back(L"\n");
-    partitioners.push_back(L"\r");
-    partitioners.push_back(L"\t");
-    //partitioners.push_back(L",");
-  }
-
-  tokens = ds::partition(in.mText, partitioners);
-
   LimitCheck                  check(in);
   float                       y = ceilf((1.0f - getFontAscender(in.mFont)) * in.mFont->pointSize());
                                                                                        //address this
   const float                 lineH = in.mFont->pointSize()*mLeading + in.mFont->pointSize();//in.mFont->ascender() + in.mFont->descender() + (in.mFont->getFont().getLeading()*mLeading);
-  std::wstring                 lineText;
+  std::wstring                lineText;
 
   // Before we do anything, make sure we have room for the first line,
   // otherwise that will slip past.
   if (check.outOfBounds(y)) return;
 
   float maxWidth = 0.0f;
-  // spaces don't have a size so we make something up
-  const ci::Vec2f             spaceSize = getSizeFromString(in.mFont, L"o");
-  //const ci::Vec2f             spaceSize = in.mFont->measureString("o", in.mOptions);
-  const ci::Vec2f             tabSize(spaceSize.x*3.0f, spaceSize.y);
-  //for (auto it=tokens.begin(), end=tokens.end(); it != end; ++it) {
-  typedef std::pair<float,std::wstring> outPair;
-  std::vector<outPair> linesToWrite;
-
-  for (size_t i = 0; i < tokens.size(); ++i) {
-    // Test the new string to see if it's too long
-    std::wstring               newLine(lineText);
-    // If the new line is too large, then flush the previous and
-    // continue with the current token
-    const std::wstring &token = tokens[i];
-    if (token == L" ") {
+  // The current line is measured as it grows, so each character is only
+  // measured once, instead of measuring the whole line again for every token.
+  LineMeasure                 lineSize(*in.mFont),
+                              newSize(*in.mFont);
+  std::vector<OutLine>        linesToWrite;
+  auto                        flush = [&linesToWrite, &maxWidth](const float y, const std::wstring& text, const float width) {
+    if (width > maxWidth)
+      maxWidth = width;
+    linesToWrite.push_back(OutLine(y, text, width));
+  };
+
+  // Per line, find the word breaks, then create a line. Each partition
+  // character is a token of its own, and so is everything between them.
+  const std::wstring&         text = in.mText;
+  size_t                      next = 0;
+  while (next < text.size()) {
+    const size_t              pos = next;
+    const wchar_t             ch = text[next++];
+    if (!is_partition(ch)) {
+      while (next < text.size() && !is_partition(text[next])) ++next;
+    }
+
+    if (ch == L' ') {
       lineText.append(L" ");
+      lineSize.append(L' ');
       continue;
-    } else if (token == L"\n" ) {
+    } else if (ch == L'\n' ) {
       // Flush the current line
       if (!lineText.empty()) {
-        float inSize = getSizeFromString(in.mFont, lineText).x;
-        if (inSize > maxWidth)
-          maxWidth = inSize;
-        linesToWrite.push_back(outPair(y, lineText));
-        ////out.addLine(ci::Vec2f(0, y + getDifference(in.mFont, lineText, lineH, mLeading)), lineText);
-        //if (mAlignment == Left) {
-        //  //out.addLine(ci::Vec2f(0, y), lineText);
-        //  linesToWrite.push_back(outPair(y, lineText));
-        //} else if (mAlignment == Right) {
-        //  float size = getSizeFromString(in.mFont, lineText).x;//in.mFont->measureString(lineText, in.mOptions).x;
-        //  float x = in.mSize.x - size;
-        //  out.addLine(ci::Vec2f(x, y), lineText);
-        //} else {
-        //  float size = getSizeFromString(in.mFont, lineText).x;//in.mFont->measureString(lineText, in.mOptions).x;
-        //  float x = (in.mSize.x - size) / 2.0f;
-        //  out.addLine(ci::Vec2f(x, y), lineText);
-        //}
+        flush(y, lineText, lineSize.width());
       }
       lineText.clear();
-      //lineText.append(" ");
+      lineSize.clear();
       y += lineH;
       if (check.outOfBounds(y)) return;
       continue;
-    } else if (token == L"\t") {
-      lineText.append(L" ");
-      lineText.append(L" ");
-      lineText.append(L" ");
-      lineText.append(L" ");
+    } else if (ch == L'\t') {
+      lineText.append(L"    ");
+      lineSize.append(L"    ");
       continue;
-    } else if (token == L"\r") {
+    } else if (ch == L'\r') {
       continue;
     }
 
-    newLine.append(token);
-    ci::Vec2f           size = getSizeFromString(in.mFont, newLine);//in.mFont->measureString(newLine, in.mOptions);
-    if (size.x > in.mSize.x) {
-      // Flush the current line
+    // Test the new string to see if it's too long
+    newSize = lineSize;
+    newSize.append(text, pos, next);
+    if (newSize.width() > in.mSize.x) {
+      // Flush the current line and continue with the current token
       if (!lineText.empty()) {
-        float inSize = getSizeFromString(in.mFont, lineText).x;
-        if (inSize > maxWidth)
-          maxWidth = inSize;
-        linesToWrite.push_back(outPair(y, lineText));
-        //if (mAlignment == Left) {
-        //  out.addLine(ci::Vec2f(0, y), lineText);
-        //} else if (mAlignment == Right) {
-        //  float size = getSizeFromString(in.mFont, lineText).x;//in.mFont->measureString(lineText, in.mOptions).x;
-        //  float x = in.mSize.x - size;
-        //  out.addLine(ci::Vec2f(x, y), lineText);
-        //} else {
-        //  float size = getSizeFromString(in.mFont, lineText).x;//in.mFont->measureString(lineText, in.mOptions).x;
-        //  float x = (in.mSize.x - size) / 2.0f;
-        //  out.addLine(ci::Vec2f(x, y), lineText);
-        //}
+        flush(y, lineText, lineSize.width());
         y += lineH;
         if (check.outOfBounds(y)) return;
       }
 
-      lineText = token;
-
-      size = getSizeFromString(in.mFont, lineText);//in.mFont->measureString(lineText, in.mOptions);
-      while (size.x > in.mSize.x) {
-        for (unsigned i = 1; i <= lineText.size(); ++i) {
-        	float cSize = getSizeFromString(in.mFont, lineText.substr(0, i)).x;//in.mFont->measureString(lineText.substr(0, i), in.mOptions).x;
-          if (cSize > in.mSize.x && i > 0) {
-            // Eric, you said there was an infinite loop here with the code like this. The way you changed it wasn't the correct
-            // split and would cause lettings out of bounds. If you get the infinite loop again let me know how to reproduce it.
-            std::wstring sub = lineText.substr(0, i-1);
-            lineText = lineText.substr(i-1, lineText.size() - i + 1);
-            if (!sub.empty()) {
-              float inSize = getSizeFromString(in.mFont, sub).x;
-              if (inSize > maxWidth)
-                maxWidth = inSize;
-              linesToWrite.push_back(outPair(y, sub));
-              //if (mAlignment == Left) {
-              //  out.addLine(ci::Vec2f(0, y), sub);
-              //} else if (mAlignment == Right) {
-              //  float size = getSizeFromString(in.mFont, sub).x;//in.mFont->measureString(sub, in.mOptions).x;
-              //  float x = in.mSize.x - size;
-              //  out.addLine(ci::Vec2f(x, y), sub);
-              //} else {
-              //  float size = getSizeFromString(in.mFont, sub).x;//in.mFont->measureString(sub, in.mOptions).x;
-              //  float x = (in.mSize.x - size) / 2.0f;
-              //  out.addLine(ci::Vec2f(x, y), sub);
-              //}
-
-              y += lineH;
-              break;
-            } else {
-              return;
-            }
-          }
+      // Break the token wherever it goes past the width. A measure only
+      // grows as characters are added, so the first character that's over
+      // is the break, and the next line starts measuring from there.
+      size_t                  start = pos;
+      while (true) {
+        lineSize.clear();
+        float                 fits = 0.0f;
+        size_t                k = start;
+        for (; k < next; ++k) {
+          lineSize.append(text[k]);
+          const float         w = lineSize.width();
+          if (w > in.mSize.x) break;
+          fits = w;
         }
+        if (k >= next) break;
+        // Not even one character fits
+        if (k == start) return;
 
+        flush(y, text.substr(start, k - start), fits);
+        y += lineH;
+        start = k;
         if (check.outOfBounds(y)) return;
-
-        size = getSizeFromString(in.mFont, lineText);//in.mFont->measureString(lineText, in.mOptions);
       }
+      lineText.assign(text, start, next - start);
 
-      //lineText.append(" ");
-      //y += lineH;
       // If the sprite is not auto resizing, then don't go past its bounds
       if (check.outOfBounds(y)) return;
       // Otherwise maintain the new line.
     } else {
-      lineText.swap(newLine);
-      //lineText.append(" ");
+      lineText.append(text, pos, next - pos);
+      lineSize = newSize;
     }
   }
 
   if (!lineText.empty() && !check.outOfBounds(y)) {
-    float inSize = getSizeFromString(in.mFont, lineText).x;
-    if (inSize > maxWidth)
-      maxWidth = inSize;
-    linesToWrite.push_back(outPair(y, lineText));
-    //if (mAlignment == Left) {
-    //  out.addLine(ci::Vec2f(0, y), lineText);
-    //} else if (mAlignment == Right) {
-    //  float size = getSizeFromString(in.mFont, lineText).x;//in.mFont->measureString(lineText, in.mOptions).x;
-    //  float x = in.mSize.x - size;
-    //  out.addLine(ci::Vec2f(x, y), lineText);
-    //} else {
-    //  float size = getSizeFromString(in.mFont, lineText).x;//in.mFont->measureString(lineText, in.mOptions).x;
-    //  float x = (in.mSize.x - size) / 2.0f;
-    //  out.addLine(ci::Vec2f(x, y), lineText);
-    //}
+    flush(y, lineText, lineSize.width());
   }
 
   if (maxWidth > in.mSize.x)
@@ -380,18 +370,16 @@ void TextLayoutVertical::run(const TextLayout::Input& in, TextLayout& out)
 
   for (auto it = linesToWrite.begin(), it2 = linesToWrite.end(); it != it2; ++it)
   {
-  	float y = it->first;
-    std::wstring &str = it->second;
+    const float y = it->mY;
+    const std::wstring &str = it->mText;
 
     if (mAlignment == Alignment::kLeft) {
       out.addLine(ci::Vec2f(0, y), str);
     } else if (mAlignment == Alignment::kRight) {
-      float size = getSizeFromString(in.mFont, str).x;//in.mFont->measureString(lineText, in.mOptions).x;
-      float x = maxWidth - size;
+      float x = maxWidth - it->mWidth;
       out.addLine(ci::Vec2f(x, y), str);
     } else {
-      float size = getSizeFromString(in.mFont, str).x;//in.mFont->measureString(lineText, in.mOptions).x;
-      float x = (maxWidth - size) / 2.0f;
+      float x = (maxWidth - it->mWidth) / 2.0f;
       out.addLine(ci::Vec2f(x, y), str);
     }
   }
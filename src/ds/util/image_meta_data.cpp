@@ -1,15 +1,17 @@
 #include "image_meta_data.h"
 
-#include <intrin.h>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 #include <unordered_map>
 #include <cinder/ImageIo.h>
 #include <cinder/Surface.h>
 #include <Poco/File.h>
+#include <Poco/Mutex.h>
 #include <Poco/Path.h>
 #include <Poco/String.h>
 #include "ds/app/environment.h"
 #include "ds/debug/logger.h"
-#include "ds/storage/persistent_cache.h"
 #include "ds/util/file_meta_data.h"
 
 namespace ds {
@@ -19,54 +21,154 @@ namespace {
 // Should have universal formats somewhere
 const int					FORMAT_UNKNOWN = 0;
 const int					FORMAT_PNG = 1;
+const int					FORMAT_JPEG = 2;
+const int					FORMAT_GIF = 3;
+const int					FORMAT_BMP = 4;
+const int					FORMAT_TIFF = 5;
 
-// Storage object
-const std::string			PATH_SZ("q");
-const std::string			WIDTH_SZ("w");
-const std::string			HEIGHT_SZ("h");
-const std::string			TIMESTAMP_SZ("ts");
-//PersistentCache				DB("ds/imagemetadata", 1, PersistentCache::FieldList().addString(PATH_SZ).addInt(WIDTH_SZ).addInt(HEIGHT_SZ).addInt(TIMESTAMP_SZ));
+// The persistent index of sizes, one line per file: modified time, width, height, path.
+// Each app has its own, since it's only guarded against my own threads.
+const std::string			INDEX_PATH("%LOCAL%/cache/%PP%/imagemetadata/index.txt");
+const std::string			INDEX_HEADER("ds_image_meta_data 1");
 
 int							get_format(const std::string& filename) {
 	const Poco::Path		path(filename);
 	std::string				ext = path.getExtension();
 	Poco::toLowerInPlace(ext);
 	if (ext == "png") return FORMAT_PNG;
+	if (ext == "jpg" || ext == "jpeg" || ext == "jpe") return FORMAT_JPEG;
+	if (ext == "gif") return FORMAT_GIF;
+	if (ext == "bmp") return FORMAT_BMP;
+	if (ext == "tif" || ext == "tiff") return FORMAT_TIFF;
 	return FORMAT_UNKNOWN;
 }
 
-bool						is_little_endian() {
-	int n = 1;
-	return (*(char*)&n == 1);
+uint32_t					read_be16(const unsigned char* b) {
+	return (static_cast<uint32_t>(b[0]) << 8) | b[1];
 }
 
-bool						get_format_png(const std::string& filename, ci::Vec2f& outSize) {
-	std::ifstream file(filename, std::ios_base::binary | std::ios_base::in);
-	if (!file.is_open() || !file) return false;
+uint32_t					read_be32(const unsigned char* b) {
+	return (read_be16(b) << 16) | read_be16(b + 2);
+}
 
-	// Skip PNG file signature
-	file.seekg(8, std::ios_base::cur);
+uint32_t					read_le16(const unsigned char* b) {
+	return (static_cast<uint32_t>(b[1]) << 8) | b[0];
+}
 
-	// First chunk: IHDR image header
-	// Skip Chunk Length
-	file.seekg(4, std::ios_base::cur);
-	// Skip Chunk Type
-	file.seekg(4, std::ios_base::cur);
+uint32_t					read_le32(const unsigned char* b) {
+	return (read_le16(b + 2) << 16) | read_le16(b);
+}
 
-	__int32 width, height;
+bool						read_bytes(std::ifstream& file, unsigned char* b, const std::streamsize size) {
+	file.read(reinterpret_cast<char*>(b), size);
+	return file.gcount() == size;
+}
 
-	file.read((char*)&width, 4);
-	file.read((char*)&height, 4);
+bool						set_size(const uint32_t w, const uint32_t h, ci::Vec2f& outSize) {
+	if (w < 1 || h < 1) return false;
+	outSize.x = static_cast<float>(w);
+	outSize.y = static_cast<float>(h);
+	return true;
+}
+
+// Signature, then the IHDR chunk.
+bool						get_format_png(std::ifstream& file, ci::Vec2f& outSize) {
+	static const unsigned char	SIGNATURE[8] = { 0x89, 'P', 'N', 'G', 0x0d, 0x0a, 0x1a, 0x0a };
+	unsigned char			b[24];
+	if (!read_bytes(file, b, sizeof(b))) return false;
+	if (memcmp(b, SIGNATURE, sizeof(SIGNATURE)) != 0 || memcmp(b + 12, "IHDR", 4) != 0) return false;
+	return set_size(read_be32(b + 16), read_be32(b + 20), outSize);
+}
 
-	// PNG format stores as big endian, convert to little
-	if (is_little_endian()) {
-		width = _byteswap_ulong(width);
-		height = _byteswap_ulong(height);
+// Walk the markers to the first start of frame. Everything before it
+// (EXIF, ICC profiles, thumbnails) is skipped without being read.
+bool						get_format_jpeg(std::ifstream& file, ci::Vec2f& outSize) {
+	unsigned char			b[8];
+	if (!read_bytes(file, b, 2) || b[0] != 0xff || b[1] != 0xd8) return false;
+	while (true) {
+		if (!read_bytes(file, b, 1)) return false;
+		if (b[0] != 0xff) continue;
+		// Any number of fill bytes
+		do {
+			if (!read_bytes(file, b, 1)) return false;
+		} while (b[0] == 0xff);
+		const unsigned char	marker = b[0];
+		// Markers without a length
+		if (marker == 0x00 || marker == 0x01 || (marker >= 0xd0 && marker <= 0xd7)) continue;
+		if (marker == 0xd9 || marker == 0xda) return false;
+		if (!read_bytes(file, b, 2)) return false;
+		const uint32_t		length = read_be16(b);
+		if (length < 2) return false;
+		// SOF0 - SOF15, except DHT, JPG and DAC
+		if (marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc) {
+			if (length < 7 || !read_bytes(file, b, 5)) return false;
+			return set_size(read_be16(b + 3), read_be16(b + 1), outSize);
+		}
+		file.seekg(length - 2, std::ios_base::cur);
+		if (!file) return false;
 	}
+}
 
-	outSize.x = static_cast<float>(width);
-	outSize.y = static_cast<float>(height);
-	return true;
+// The logical screen descriptor follows the signature.
+bool						get_format_gif(std::ifstream& file, ci::Vec2f& outSize) {
+	unsigned char			b[10];
+	if (!read_bytes(file, b, sizeof(b))) return false;
+	if (memcmp(b, "GIF87a", 6) != 0 && memcmp(b, "GIF89a", 6) != 0) return false;
+	return set_size(read_le16(b + 6), read_le16(b + 8), outSize);
+}
+
+// The DIB header follows the 14 byte file header. Height is negative for top-down images.
+bool						get_format_bmp(std::ifstream& file, ci::Vec2f& outSize) {
+	unsigned char			b[26];
+	if (!read_bytes(file, b, sizeof(b)) || b[0] != 'B' || b[1] != 'M') return false;
+	const uint32_t			dib_size = read_le32(b + 14);
+	if (dib_size == 12) return set_size(read_le16(b + 18), read_le16(b + 20), outSize);
+	if (dib_size < 40) return false;
+	const int32_t			w = static_cast<int32_t>(read_le32(b + 18)),
+							h = static_cast<int32_t>(read_le32(b + 22));
+	return set_size(w > 0 ? w : 0, static_cast<uint32_t>(h < 0 ? -h : h), outSize);
+}
+
+// Find the width and length tags in the first IFD.
+bool						get_format_tiff(std::ifstream& file, ci::Vec2f& outSize) {
+	unsigned char			b[12];
+	if (!read_bytes(file, b, 8)) return false;
+	bool					le;
+	if (memcmp(b, "II*\0", 4) == 0) le = true;
+	else if (memcmp(b, "MM\0*", 4) == 0) le = false;
+	else return false;
+	auto					read16 = [le](const unsigned char* p) { return le ? read_le16(p) : read_be16(p); };
+	auto					read32 = [le](const unsigned char* p) { return le ? read_le32(p) : read_be32(p); };
+
+	file.seekg(read32(b + 4), std::ios_base::beg);
+	if (!file || !read_bytes(file, b, 2)) return false;
+	const uint32_t			count = read16(b);
+	uint32_t				w = 0, h = 0;
+	for (uint32_t k=0; k<count && (w < 1 || h < 1); ++k) {
+		if (!read_bytes(file, b, 12)) return false;
+		const uint32_t		tag = read16(b),
+							type = read16(b + 2);
+		// SHORT values sit in the first two bytes of the value field, LONG use all four
+		uint32_t			value = 0;
+		if (type == 3) value = read16(b + 8);
+		else if (type == 4) value = read32(b + 8);
+		else continue;
+		if (tag == 256) w = value;
+		else if (tag == 257) h = value;
+	}
+	return set_size(w, h, outSize);
+}
+
+bool						get_format_size(const int format, const std::string& filename, ci::Vec2f& outSize) {
+	if (format == FORMAT_UNKNOWN) return false;
+	std::ifstream			file(filename.c_str(), std::ios_base::binary | std::ios_base::in);
+	if (!file.is_open() || !file) return false;
+	if (format == FORMAT_PNG) return get_format_png(file, outSize);
+	if (format == FORMAT_JPEG) return get_format_jpeg(file, outSize);
+	if (format == FORMAT_GIF) return get_format_gif(file, outSize);
+	if (format == FORMAT_BMP) return get_format_bmp(file, outSize);
+	if (format == FORMAT_TIFF) return get_format_tiff(file, outSize);
+	return false;
 }
 
 // A horrible fallback when no meta info has been supplied about the image size.
@@ -88,8 +190,8 @@ void						super_slow_image_atts(const std::string& filename, ci::Vec2f& outSize)
 
 }
 
-// Store a cache of parsed files.  We should have this cache to a database, but for now, just have
-// it generate at each run.
+// Store a cache of parsed files, keyed on the expanded path. Anything that had to be
+// generated is appended to an index on disk, so the next run starts with it.
 namespace {
 class ImageAtts {
 public:
@@ -105,15 +207,22 @@ public:
 
 class ImageAttsCache {
 public:
-	ImageAttsCache() {
+	ImageAttsCache() : mIndexLoaded(false) {
 	}
 
 	void				add(const std::string& filePath, const ci::Vec2f size){
 		if(size.x> 0 && size.y > 0){
 			try{
+				const std::string	expanded_fn(ds::Environment::expand(filePath));
 				ImageAtts atts(size);
-				atts.mLastModified = Poco::File(filePath).getLastModified();
-				mCache[filePath] = atts;
+				atts.mLastModified = Poco::File(expanded_fn).getLastModified();
+				Poco::FastMutex::ScopedLock		l(mMutex);
+				loadIndex();
+				// Only new or changed entries go to the index, most calls are repeats.
+				auto f = mCache.find(expanded_fn);
+				if (f != mCache.end() && f->second.mLastModified == atts.mLastModified && f->second.mSize == atts.mSize) return;
+				mCache[expanded_fn] = atts;
+				appendIndex(expanded_fn, atts);
 			} catch(std::exception const&){
 				//HAHAHAHAHAHAHAHA
 			}
@@ -125,19 +234,24 @@ public:
 		// Note: for the actual path, use the expanded fn.
 		const std::string	expanded_fn(ds::Environment::expand(fn));
 		try {
-			auto f = mCache.find(fn);
-			if (f != mCache.end() && f->second.mLastModified == Poco::File(expanded_fn).getLastModified()) {
+			const Poco::Timestamp			modified = Poco::File(expanded_fn).getLastModified();
+			Poco::FastMutex::ScopedLock		l(mMutex);
+			loadIndex();
+			auto f = mCache.find(expanded_fn);
+			if (f != mCache.end() && f->second.mLastModified == modified) {
 				return f->second.mSize;
 			}
 		} catch (std::exception const&) {
 		}
 
 		try {
-			// Generate the cache:
+			// Generate the cache. This can be slow, so don't hold the lock.
 			ImageAtts		atts = generate(expanded_fn);
 			if (atts.mSize.x > 0.0f && atts.mSize.y > 0.0f) {
 				atts.mLastModified = Poco::File(expanded_fn).getLastModified();
-				mCache[fn] = atts;
+				Poco::FastMutex::ScopedLock	l(mMutex);
+				mCache[expanded_fn] = atts;
+				appendIndex(expanded_fn, atts);
 				return atts.mSize;
 			}
 		} catch (std::exception const&) {
@@ -161,8 +275,7 @@ private:
 		// 3. Probe known file formats
 		try {
 			ImageAtts			atts;
-			const int			format = get_format(fn);
-			if (format == FORMAT_PNG && get_format_png(fn, atts.mSize)) {
+			if (get_format_size(get_format(fn), fn, atts.mSize)) {
 				return atts;
 			}
 		} catch (std::exception const& e) {
@@ -175,7 +288,62 @@ private:
 		return atts;
 	}
 
+	// Read the index the first time I'm used. Later lines replace earlier
+	// ones, and if most of the lines are stale it's rewritten.
+	void				loadIndex() {
+		if (mIndexLoaded) return;
+		mIndexLoaded = true;
+		try {
+			mIndexPath = ds::Environment::expand(INDEX_PATH);
+			Poco::File(Poco::Path(mIndexPath).parent()).createDirectories();
+
+			std::ifstream	in(mIndexPath.c_str());
+			std::string		line;
+			size_t			lines = 0;
+			if (!in.is_open() || !std::getline(in, line) || line != INDEX_HEADER) {
+				rewriteIndex();
+				return;
+			}
+			while (std::getline(in, line)) {
+				std::istringstream	buf(line);
+				Poco::Timestamp::TimeVal	modified;
+				ImageAtts	atts;
+				std::string	path;
+				if (!(buf >> modified >> atts.mSize.x >> atts.mSize.y)) continue;
+				buf.get();
+				if (!std::getline(buf, path) || path.empty()) continue;
+				atts.mLastModified = Poco::Timestamp(modified);
+				mCache[path] = atts;
+				++lines;
+			}
+			in.close();
+			if (lines > 64 && lines > mCache.size() * 2) rewriteIndex();
+		} catch (std::exception const& ex) {
+			DS_LOG_WARNING_M("ImageMetaData can't read index " << mIndexPath << " (" << ex.what() << ")", GENERAL_LOG);
+		}
+	}
+
+	void				rewriteIndex() {
+		std::ofstream		out(mIndexPath.c_str(), std::ios_base::out | std::ios_base::trunc);
+		if (!out) return;
+		out << INDEX_HEADER << std::endl;
+		for (auto it=mCache.begin(), end=mCache.end(); it!=end; ++it) writeIndexLine(out, it->first, it->second);
+	}
+
+	void				appendIndex(const std::string& path, const ImageAtts& atts) {
+		if (mIndexPath.empty() || path.find('\n') != std::string::npos) return;
+		std::ofstream		out(mIndexPath.c_str(), std::ios_base::out | std::ios_base::app);
+		if (out) writeIndexLine(out, path, atts);
+	}
+
+	void				writeIndexLine(std::ostream& out, const std::string& path, const ImageAtts& atts) {
+		out << atts.mLastModified.epochMicroseconds() << "\t" << atts.mSize.x << "\t" << atts.mSize.y << "\t" << path << std::endl;
+	}
+
+	Poco::FastMutex		mMutex;
 	std::unordered_map<std::string, ImageAtts>	mCache;
+	bool				mIndexLoaded;
+	std::string			mIndexPath;
 };
 
 ImageAttsCache			CACHE;
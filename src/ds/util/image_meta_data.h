@@ -9,8 +9,9 @@ namespace ds {
 
 /**
  * \class ds::ImageMetaData
- * \brief Read meta data for image files.
- * NOTE: This can be VERY slow, if the image needs to be loaded.
+ * \brief Read meta data for image files. PNG, JPEG, GIF, BMP and TIFF sizes
+ * are read from the file header, and remembered across runs.
+ * NOTE: This can be VERY slow for any other format, since the image needs to be loaded.
  */
 class ImageMetaData {
 public:
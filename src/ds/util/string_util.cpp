@@ -2,144 +2,21 @@
 
 #include <sstream>
 #include <fstream>
+#include "ds/util/utf8.h"
 
 using namespace std;
 using namespace ds;
 
-/* WIN32
- ******************************************************************/
-#ifdef WIN32
-#include <windows.h>
-#include <time.h>
-#include <iostream>
-
-std::wstring wstr_from_str(const std::string& str, const UINT cp)
-{
-	if (str.empty()) return wstring();
-
-	const int len = MultiByteToWideChar(cp, 0, str.c_str(), str.length(), 0, 0);
-	if (!len) throw conversion_error();
-
-	std::vector<wchar_t> wbuff(len + 1);
-	// NOTE: this does not NULL terminate the string in wbuff, but this is ok
-	//       since it was zero-initialized in the vector constructor
-	if (!MultiByteToWideChar(cp, 0, str.c_str(), str.length(), &wbuff[0], len)) throw conversion_error();
-
-	return &wbuff[0];
-}
-
-std::string str_from_wstr(const std::wstring& wstr, const UINT cp)
-{
-	if (wstr.empty()) return string();
-
-	const int len = WideCharToMultiByte(cp, 0, wstr.c_str(), wstr.length(), 0, 0, 0, 0);
-	if (!len) throw conversion_error();
-
-	std::vector<char> abuff(len + 1);
-
-	// NOTE: this does not NULL terminate the string in abuff, but this is ok
-	//       since it was zero-initialized in the vector constructor
-	if (!WideCharToMultiByte(cp, 0, wstr.c_str(), wstr.length(), &abuff[0], len, 0, 0)) throw conversion_error();
-
-	return &abuff[0];
-}
-
 std::wstring		ds::wstr_from_utf8(const std::string& str)
 {
-	return wstr_from_str(str, CP_UTF8);
+	return ds::utf8::decode(str);
 }
 
 std::string			ds::utf8_from_wstr(const std::wstring& wstr)
 {
-	return str_from_wstr(wstr, CP_UTF8);
+	return ds::utf8::encode(wstr);
 }
 
-#else
-/* Linux equivalent?
- ******************************************************************/
-std::wstring		ds::wstr_from_utf8(const std::string& src) {
-	std::wstring dest;
-
-	wchar_t w = 0;
-	int bytes = 0;
-	wchar_t err = L'?';
-	for ( size_t i = 0; i < src.size(); i++ ) {
-		unsigned char c = ( unsigned char )src[i];
-		if ( c <= 0x7f ) { //first byte
-			if ( bytes ) {
-				dest.push_back( err );
-				bytes = 0;
-			}
-			dest.push_back( ( wchar_t )c );
-		}
-		else if ( c <= 0xbf ) { //second/third/etc byte
-			if ( bytes ) {
-				w = ( ( w << 6 ) | ( c & 0x3f ) );
-				bytes--;
-				if ( bytes == 0 )
-					dest.push_back( w );
-			}
-			else
-				dest.push_back( err );
-		}
-		else if ( c <= 0xdf ) { //2byte sequence start
-			bytes = 1;
-			w = c & 0x1f;
-		}
-		else if ( c <= 0xef ) { //3byte sequence start
-			bytes = 2;
-			w = c & 0x0f;
-		}
-		else if ( c <= 0xf7 ) { //3byte sequence start
-			bytes = 3;
-			w = c & 0x07;
-		}
-		else {
-			dest.push_back( err );
-			bytes = 0;
-		}
-	}
-	if ( bytes )
-		dest.push_back( err );
-
-
-	return dest;
-}
-
-
-std::string		ds::utf8_from_wstr(const std::wstring& src) {
-	std::string dest;
-
-	for ( size_t i = 0; i < src.size(); i++ ) {
-		wchar_t w = src[i];
-		if ( w <= 0x7f )
-			dest.push_back( ( char )w );
-		else if ( w <= 0x7ff ) {
-			dest.push_back( 0xc0 | ( ( w >> 6 ) & 0x1f ) );
-			dest.push_back( 0x80 | ( w & 0x3f ) );
-		}
-		else if ( w <= 0xffff ) {
-			dest.push_back( 0xe0 | ( ( w >> 12 ) & 0x0f ) );
-			dest.push_back( 0x80 | ( ( w >> 6 ) & 0x3f ) );
-			dest.push_back( 0x80 | ( w & 0x3f ) );
-		}
-		else if ( w <= 0x10ffff ) {
-			dest.push_back( 0xf0 | ( ( w >> 18 ) & 0x07 ) );
-			dest.push_back( 0x80 | ( ( w >> 12 ) & 0x3f ) );
-			dest.push_back( 0x80 | ( ( w >> 6 ) & 0x3f ) );
-			dest.push_back( 0x80 | ( w & 0x3f ) );
-		}
-		else
-			dest.push_back( '?' );
-	}
-
-	return dest;
-}
-
-
-
-#endif
-
 //variation on a function found on stackoverflow
 std::vector<std::string> ds::split( const std::string &str, const std::string &delimiters, bool dropEmpty )
 {
@@ -12,9 +12,9 @@ namespace ds {
 
 class conversion_error : public std::exception { };
 
-// Format conversions
-std::wstring		wstr_from_utf8(const std::string&);		// throws conversion_error
-std::string			utf8_from_wstr(const std::wstring&);	// throws conversion_error
+// Format conversions. Invalid input comes out as U+FFFD, see ds/util/utf8.h
+std::wstring		wstr_from_utf8(const std::string&);
+std::string			utf8_from_wstr(const std::wstring&);
 
 // Number conversions
 template <typename T>
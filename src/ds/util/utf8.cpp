@@ -0,0 +1,315 @@
+#include "ds/util/utf8.h"
+
+#include <vector>
+#include <stdint.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define DS_UTF8_SSE2
+#endif
+
+namespace {
+const uint32_t		REPLACEMENT = 0xfffd;
+// ASCII is encoded this many characters at a time...
+const size_t		ENCODE_BLOCK = 8;
+// ...and decoded this many bytes at a time.
+const size_t		DECODE_BLOCK = 16;
+
+/**
+ * Ascii
+ * Convert a block of ASCII, or answer false if any of it isn't.
+ */
+template <typename Unit, size_t Size = sizeof(Unit)>
+struct Ascii {
+	static bool		test(const Unit* src) {
+		uint32_t	bits = 0;
+		for (size_t k=0; k<ENCODE_BLOCK; ++k) bits |= static_cast<uint32_t>(src[k]);
+		return bits < 0x80;
+	}
+
+	static bool		encode(const Unit* src, char* dst) {
+		if (!test(src)) return false;
+		for (size_t k=0; k<ENCODE_BLOCK; ++k) dst[k] = static_cast<char>(src[k]);
+		return true;
+	}
+
+	static bool		decode(const unsigned char* src, Unit* dst) {
+		unsigned char	bits = 0;
+		for (size_t k=0; k<DECODE_BLOCK; ++k) bits |= src[k];
+		if (bits >= 0x80) return false;
+		for (size_t k=0; k<DECODE_BLOCK; ++k) dst[k] = static_cast<Unit>(src[k]);
+		return true;
+	}
+};
+
+#ifdef DS_UTF8_SSE2
+template <typename Unit>
+struct Ascii<Unit, 2> {
+	static bool		test(const Unit* src) {
+		const __m128i	v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		const __m128i	high = _mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xff80)));
+		return _mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) == 0xffff;
+	}
+
+	static bool		encode(const Unit* src, char* dst) {
+		const __m128i	v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		const __m128i	high = _mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xff80)));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) != 0xffff) return false;
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(v, v));
+		return true;
+	}
+
+	static bool		decode(const unsigned char* src, Unit* dst) {
+		const __m128i	v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		if (_mm_movemask_epi8(v) != 0) return false;
+		const __m128i	zero = _mm_setzero_si128();
+		__m128i*		out = reinterpret_cast<__m128i*>(dst);
+		_mm_storeu_si128(out, _mm_unpacklo_epi8(v, zero));
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi8(v, zero));
+		return true;
+	}
+};
+
+template <typename Unit>
+struct Ascii<Unit, 4> {
+	static bool		test(const Unit* src) {
+		const __m128i*	in = reinterpret_cast<const __m128i*>(src);
+		const __m128i	bits = _mm_or_si128(_mm_loadu_si128(in), _mm_loadu_si128(in + 1));
+		const __m128i	high = _mm_and_si128(bits, _mm_set1_epi32(static_cast<int>(0xffffff80)));
+		return _mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) == 0xffff;
+	}
+
+	static bool		encode(const Unit* src, char* dst) {
+		const __m128i*	in = reinterpret_cast<const __m128i*>(src);
+		const __m128i	a = _mm_loadu_si128(in),
+						b = _mm_loadu_si128(in + 1);
+		const __m128i	high = _mm_and_si128(_mm_or_si128(a, b), _mm_set1_epi32(static_cast<int>(0xffffff80)));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(high, _mm_setzero_si128())) != 0xffff) return false;
+		const __m128i	w = _mm_packs_epi32(a, b);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(w, w));
+		return true;
+	}
+
+	static bool		decode(const unsigned char* src, Unit* dst) {
+		const __m128i	v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		if (_mm_movemask_epi8(v) != 0) return false;
+		const __m128i	zero = _mm_setzero_si128();
+		const __m128i	lo = _mm_unpacklo_epi8(v, zero),
+						hi = _mm_unpackhi_epi8(v, zero);
+		__m128i*		out = reinterpret_cast<__m128i*>(dst);
+		_mm_storeu_si128(out, _mm_unpacklo_epi16(lo, zero));
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo, zero));
+		_mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi, zero));
+		_mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi, zero));
+		return true;
+	}
+};
+#endif
+
+// Answer the code point at src[i] and move past it, pairing up surrogates
+// for UTF-16.
+template <typename Unit>
+inline uint32_t		next_char(const Unit* src, const size_t len, size_t& i) {
+	const uint32_t	c = static_cast<uint32_t>(src[i++]);
+	if (c < 0xd800) return c;
+	if (sizeof(Unit) == 2 && c <= 0xdbff && i < len) {
+		const uint32_t	low = static_cast<uint32_t>(src[i]);
+		if (low >= 0xdc00 && low <= 0xdfff) {
+			++i;
+			return 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+		}
+	}
+	if (c <= 0xdfff || c > 0x10ffff) return REPLACEMENT;
+	return c;
+}
+
+inline size_t		char_size(const uint32_t c) {
+	if (c < 0x80) return 1;
+	if (c < 0x800) return 2;
+	if (c < 0x10000) return 3;
+	return 4;
+}
+
+inline char*		put_char(const uint32_t c, char* out) {
+	if (c < 0x80) {
+		*out++ = static_cast<char>(c);
+	} else if (c < 0x800) {
+		*out++ = static_cast<char>(0xc0 | (c >> 6));
+		*out++ = static_cast<char>(0x80 | (c & 0x3f));
+	} else if (c < 0x10000) {
+		*out++ = static_cast<char>(0xe0 | (c >> 12));
+		*out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+		*out++ = static_cast<char>(0x80 | (c & 0x3f));
+	} else {
+		*out++ = static_cast<char>(0xf0 | (c >> 18));
+		*out++ = static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+		*out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+		*out++ = static_cast<char>(0x80 | (c & 0x3f));
+	}
+	return out;
+}
+
+template <typename Unit>
+inline Unit*		put_unit(const uint32_t c, Unit* out) {
+	if (sizeof(Unit) == 2 && c >= 0x10000) {
+		*out++ = static_cast<Unit>(0xd800 + ((c - 0x10000) >> 10));
+		*out++ = static_cast<Unit>(0xdc00 + ((c - 0x10000) & 0x3ff));
+	} else {
+		*out++ = static_cast<Unit>(c);
+	}
+	return out;
+}
+
+inline bool			is_continuation(const unsigned char c) {
+	return (c & 0xc0) == 0x80;
+}
+
+template <typename Unit>
+size_t				encoded_size(const Unit* src, const size_t len) {
+	size_t			bytes = 0,
+					i = 0;
+	while (i < len) {
+		if (static_cast<uint32_t>(src[i]) < 0x80) {
+			if (i + ENCODE_BLOCK <= len && Ascii<Unit>::test(src + i)) {
+				i += ENCODE_BLOCK;
+				bytes += ENCODE_BLOCK;
+			} else {
+				++i;
+				++bytes;
+			}
+			continue;
+		}
+		bytes += char_size(next_char(src, len, i));
+	}
+	return bytes;
+}
+
+template <typename Unit>
+size_t				encode_units(const Unit* src, const size_t len, char* dst) {
+	char*			out = dst;
+	size_t			i = 0;
+	while (i < len) {
+		if (static_cast<uint32_t>(src[i]) < 0x80) {
+			if (i + ENCODE_BLOCK <= len && Ascii<Unit>::encode(src + i, out)) {
+				i += ENCODE_BLOCK;
+				out += ENCODE_BLOCK;
+			} else {
+				*out++ = static_cast<char>(src[i++]);
+			}
+			continue;
+		}
+		out = put_char(next_char(src, len, i), out);
+	}
+	return out - dst;
+}
+
+// Every byte of a bad sequence becomes a U+FFFD, so the output is never
+// longer than the input.
+template <typename Unit>
+size_t				decode_units(const unsigned char* src, const size_t len, Unit* dst) {
+	Unit*			out = dst;
+	size_t			i = 0;
+	while (i < len) {
+		const uint32_t	c = src[i];
+		if (c < 0x80) {
+			if (i + DECODE_BLOCK <= len && Ascii<Unit>::decode(src + i, out)) {
+				i += DECODE_BLOCK;
+				out += DECODE_BLOCK;
+			} else {
+				*out++ = static_cast<Unit>(c);
+				++i;
+			}
+			continue;
+		}
+
+		uint32_t		cp = REPLACEMENT;
+		size_t			n = 1;
+		if (c >= 0xc2 && c <= 0xdf) {
+			if (i + 1 < len && is_continuation(src[i+1])) {
+				cp = ((c & 0x1f) << 6) | (src[i+1] & 0x3f);
+				n = 2;
+			}
+		} else if (c >= 0xe0 && c <= 0xef) {
+			if (i + 2 < len && is_continuation(src[i+1]) && is_continuation(src[i+2])) {
+				const uint32_t	v = ((c & 0x0f) << 12) | ((src[i+1] & 0x3f) << 6) | (src[i+2] & 0x3f);
+				// No overlongs or surrogates
+				if (v >= 0x800 && (v < 0xd800 || v > 0xdfff)) {
+					cp = v;
+					n = 3;
+				}
+			}
+		} else if (c >= 0xf0 && c <= 0xf4) {
+			if (i + 3 < len && is_continuation(src[i+1]) && is_continuation(src[i+2]) && is_continuation(src[i+3])) {
+				const uint32_t	v = ((c & 0x07) << 18) | ((src[i+1] & 0x3f) << 12) | ((src[i+2] & 0x3f) << 6) | (src[i+3] & 0x3f);
+				if (v >= 0x10000 && v <= 0x10ffff) {
+					cp = v;
+					n = 4;
+				}
+			}
+		}
+		i += n;
+		out = put_unit(cp, out);
+	}
+	return out - dst;
+}
+
+}
+
+namespace ds {
+namespace utf8 {
+
+size_t encodedSize(const wchar_t* src, const size_t len) {
+	if (!src) return 0;
+	return encoded_size(src, len);
+}
+
+size_t encode(const wchar_t* src, const size_t len, char* dst) {
+	if (!src || !dst) return 0;
+	return encode_units(src, len, dst);
+}
+
+size_t decode(const char* src, const size_t len, wchar_t* dst) {
+	if (!src || !dst) return 0;
+	return decode_units(reinterpret_cast<const unsigned char*>(src), len, dst);
+}
+
+std::string encode(const std::wstring& src) {
+	const size_t	size = encodedSize(src.data(), src.size());
+	if (size < 1) return std::string();
+	std::string		ans(size, 0);
+	encode(src.data(), src.size(), &ans[0]);
+	return ans;
+}
+
+std::wstring decode(const char* src, const size_t len) {
+	if (!src || len < 1) return std::wstring();
+	std::wstring	ans(len, 0);
+	ans.resize(decode(src, len, &ans[0]));
+	return ans;
+}
+
+std::wstring decode(const std::string& src) {
+	return decode(src.data(), src.size());
+}
+
+std::wstring decodeUtf16(const char* src, const size_t bytes) {
+	const size_t	len = bytes / 2;
+	if (!src || len < 1) return std::wstring();
+
+	const unsigned char*	in = reinterpret_cast<const unsigned char*>(src);
+	std::vector<uint16_t>	units(len);
+	for (size_t k=0; k<len; ++k) units[k] = static_cast<uint16_t>(in[k*2] | (in[k*2+1] << 8));
+
+	std::wstring	ans(len, 0);
+	size_t			i = 0,
+					count = 0;
+	while (i < len) {
+		if (sizeof(wchar_t) == 2) ans[count++] = static_cast<wchar_t>(units[i++]);
+		else ans[count++] = static_cast<wchar_t>(next_char(&units[0], len, i));
+	}
+	ans.resize(count);
+	return ans;
+}
+
+} // namespace utf8
+} // namespace ds
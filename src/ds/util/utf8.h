@@ -0,0 +1,37 @@
+#pragma once
+#ifndef DS_UTIL_UTF8_H_
+#define DS_UTIL_UTF8_H_
+
+#include <cstddef>
+#include <string>
+
+namespace ds {
+namespace utf8 {
+
+/**
+ * UTF-8 <-> wchar_t transcoding. wchar_t is UTF-16 where it's 2 bytes
+ * (Windows) and UTF-32 where it's 4. Runs of ASCII are converted a block
+ * at a time (with SSE2 where it's available), everything else a character
+ * at a time. Nothing throws: invalid input, including unpaired surrogates,
+ * comes out as U+FFFD.
+ */
+
+// Answer the bytes needed to encode src.
+size_t			encodedSize(const wchar_t* src, const size_t len);
+// dst must have room for encodedSize() bytes. Answer the bytes written.
+size_t			encode(const wchar_t* src, const size_t len, char* dst);
+// dst must have room for len characters, which is always enough.
+// Answer the characters written.
+size_t			decode(const char* src, const size_t len, wchar_t* dst);
+
+std::string		encode(const std::wstring&);
+std::wstring	decode(const char* src, const size_t len);
+std::wstring	decode(const std::string&);
+
+// Little-endian UTF-16, the old wire format for wide strings.
+std::wstring	decodeUtf16(const char* src, const size_t bytes);
+
+} // namespace utf8
+} // namespace ds
+
+#endif // DS_UTIL_UTF8_H_